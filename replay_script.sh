@@ -0,0 +1,27 @@
+# Capture the LLC stream of each mix once with CMP$im, then replay it
+# against every replacement policy in one llcsim pass. Only the first
+# step pays for Pin and the L1/L2 model.
+
+# The kit's top directory: the first argument, else the directory of this
+# script
+CRC=${1:-$(cd "$(dirname "$0")" && pwd)}
+
+WORKLOADS=(mcf bwaves bzip2 zeusmp cactus gems sphinx various1 various2 various3)
+WORKLOADS_L=${#WORKLOADS[@]}
+
+# llcsim names the per-policy outputs lru, random, drrip, ship, eaf, eaf_rrip
+POLICIES=0,1,2,3,4,5
+
+iCount=200
+
+printf "Run on $(date +%F)\n\n" > output.txt 
+
+for ((i=0;i<$WORKLOADS_L;i++)); do
+	STREAM=${CRC}/runs/mix_${WORKLOADS[${i}]}.llc
+
+	if [ ! -f ${STREAM} ]; then
+		CRC_CAPTURE=${STREAM} ${CRC}/bin/CMPsim.usetrace.64 -threads 4 -mix ${CRC}/CRC_traces/mix_${WORKLOADS[${i}]}.mix -cache UL3:4096:64:16 -autorewind 1 -icount ${iCount} -o ${CRC}/runs/mix_${WORKLOADS[${i}]}_capture.stats -LLCrepl 0 >> output.txt
+	fi
+
+	${CRC}/bin/llcsim -t ${STREAM} -cache UL3:4096:64:16 -LLCrepl ${POLICIES} -o ${CRC}/runs/mix_${WORKLOADS[${i}]}_%p.llc.stats >> output.txt
+done
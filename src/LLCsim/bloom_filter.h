@@ -0,0 +1,181 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Bit-array Bloom filter used as the Evicted Address Filter (EAF).           //
+// Inserting and testing touch 'hashes' bits chosen by multiplicative         //
+// hashing, so there are no allocations and no false negatives; false         //
+// positives come from bit collisions as in hardware. After 'capacity'        //
+// insertions the filter clears itself, as the EAF paper prescribes.          //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include "utils.h"
+#include "crc_checkpoint.h"
+
+#define BLOOM_MAX_HASHES    8
+
+class BLOOM_FILTER
+{
+  private:
+
+    unsigned long long  *bits;
+    UINT32              numWords;
+    UINT32              indexBits;   // log2 of the number of bits
+    UINT32              hashes;
+
+    UINT32              capacity;    // insertions before the filter is cleared
+    UINT32              inserted;
+
+    COUNTER             insertedTotal;   // insertions ever made
+    COUNTER             insertedSynced;  // insertedTotal at the last Synchronize
+
+    // Odd 64-bit multipliers, one per hash function
+    static unsigned long long Multiplier( UINT32 h )
+    {
+        static const unsigned long long mult[ BLOOM_MAX_HASHES ] =
+        {
+            0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL,
+            0x165667b19e3779f9ULL, 0xd6e8feb86659fd93ULL,
+            0xff51afd7ed558ccdULL, 0xc4ceb9fe1a85ec53ULL,
+            0x87c37b91114253d5ULL, 0x4cf5ad432745937fULL
+        };
+        return mult[ h ];
+    }
+
+    UINT32 BitIndex( Addr_t key, UINT32 h )
+    {
+        return (UINT32) ((key * Multiplier( h )) >> (64 - indexBits));
+    }
+
+  public:
+
+    // The bit array holds at least capacity*bitsPerElement bits, rounded up
+    // to a power of two
+    BLOOM_FILTER( UINT32 _capacity, UINT32 bitsPerElement, UINT32 _hashes )
+    {
+        capacity  = _capacity;
+        hashes    = (_hashes > BLOOM_MAX_HASHES) ? BLOOM_MAX_HASHES : _hashes;
+        inserted  = 0;
+        insertedTotal  = 0;
+        insertedSynced = 0;
+        indexBits = CRC_CeilLog2( capacity * bitsPerElement );
+        if( indexBits < 6 ) indexBits = 6;
+        numWords  = (1U << indexBits) / 64;
+        bits      = new unsigned long long[ numWords ];
+
+        Clear();
+    }
+
+    ~BLOOM_FILTER() { delete [] bits; }
+
+    void Clear()
+    {
+        memset( bits, 0, numWords * sizeof(unsigned long long) );
+        inserted = 0;
+    }
+
+    void Insert( Addr_t key )
+    {
+        for(UINT32 h=0; h<hashes; h++)
+        {
+            UINT32 bit = BitIndex( key, h );
+            bits[ bit >> 6 ] |= 1ULL << (bit & 63);
+        }
+
+        insertedTotal++;
+
+        if( ++inserted == capacity )
+        {
+            Clear();
+        }
+    }
+
+    bool Test( Addr_t key )
+    {
+        for(UINT32 h=0; h<hashes; h++)
+        {
+            UINT32 bit = BitIndex( key, h );
+            if( !((bits[ bit >> 6 ] >> (bit & 63)) & 1) ) return false;
+        }
+
+        return true;
+    }
+
+    // Sharded replay: 'copies' started the epoch identical to this filter
+    // and took insertions independently. Folds their insertions into this
+    // filter (a union of the bits, or a clear if the combined count reached
+    // capacity) and makes every copy identical to the result.
+    void Synchronize( BLOOM_FILTER **copies, UINT32 n )
+    {
+        COUNTER count = inserted;
+
+        for(UINT32 c=0; c<n; c++)
+        {
+            count += copies[c]->insertedTotal - copies[c]->insertedSynced;
+        }
+
+        if( count >= capacity )
+        {
+            Clear();
+        }
+        else
+        {
+            for(UINT32 c=0; c<n; c++)
+            {
+                for(UINT32 w=0; w<numWords; w++) bits[w] |= copies[c]->bits[w];
+            }
+            inserted = (UINT32) count;
+        }
+
+        for(UINT32 c=0; c<n; c++)
+        {
+            memcpy( copies[c]->bits, bits, numWords * sizeof(unsigned long long) );
+            copies[c]->inserted       = inserted;
+            copies[c]->insertedSynced = copies[c]->insertedTotal;
+        }
+    }
+
+    // Checkpoints: the bit array behind a CRC_CHECKPOINT_BLOOM header.
+    // Load fails unless the filter has the same geometry.
+    void Save( CRC_CHECKPOINT_WRITER &writer, UINT32 id )
+    {
+        CRC_CHECKPOINT_BLOOM header;
+
+        header.capacity       = capacity;
+        header.indexBits      = indexBits;
+        header.hashes         = hashes;
+        header.inserted       = inserted;
+        header.insertedTotal  = insertedTotal;
+        header.insertedSynced = insertedSynced;
+
+        writer.Section( id, &header, sizeof(header), bits, numWords * sizeof(unsigned long long) );
+    }
+
+    bool Load( CRC_CHECKPOINT_READER &reader, UINT32 id )
+    {
+        size_t       bytes   = 0;
+        const UINT8 *payload = (const UINT8 *) reader.Find( id, &bytes );
+
+        if( payload == NULL || bytes != sizeof(CRC_CHECKPOINT_BLOOM) + numWords * sizeof(unsigned long long) )
+            return false;
+
+        CRC_CHECKPOINT_BLOOM header;
+        memcpy( &header, payload, sizeof(header) );
+
+        if( header.capacity != capacity || header.indexBits != indexBits || header.hashes != hashes )
+            return false;
+
+        inserted       = header.inserted;
+        insertedTotal  = header.insertedTotal;
+        insertedSynced = header.insertedSynced;
+        memcpy( bits, payload + sizeof(header), numWords * sizeof(unsigned long long) );
+
+        return true;
+    }
+};
+
+#endif
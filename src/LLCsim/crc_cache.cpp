@@ -1,3 +1,6 @@
+#include <cmath>
+#include <cstring>
+#include <sstream>
 #include "crc_cache.h"
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -42,8 +45,17 @@ CRC_CACHE::CRC_CACHE( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _lin
 {
 
     // Start off with empty cache and replacement state
-    cache          = NULL;
+    tags           = NULL;
     cacheReplState = NULL;
+    capture        = NULL;
+    captured       = 0;
+    checkpointFile = NULL;
+    checkpointAt   = 0;
+    warming        = false;
+    warmupEnd      = 0;
+    regionLength   = 0;
+    regionEnd      = 0;
+    nextEvent      = ~0ULL;
 
     // Initialize parameters to the cache
     numsets  = _cacheSize / (_linesize * _assoc);
@@ -51,7 +63,25 @@ CRC_CACHE::CRC_CACHE( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _lin
     threads  = _tpc;
     linesize = _linesize;
 
-    replPolicy = _pol;
+    // The front end only knows policy numbers: CRC_POLICY=<spec> selects
+    // any registered policy instead (see crc_policy.h)
+    policyId = _pol;
+
+    const char *policy = getenv( "CRC_POLICY" );
+    if( policy != NULL && policy[0] != '\0' )
+    {
+        policyId = CRC_RegisterPolicy( policy );
+        if( policyId == CRC_REPL_INVALID )
+        {
+            cerr << "CRC_CACHE: bad CRC_POLICY " << policy << endl;
+            exit( 1 );
+        }
+    }
+
+    replPolicy = CRC_PolicyBase( policyId );
+
+    // Pick the simulated sets (all unless CRC_SET_SAMPLE is set)
+    InitSampling();
 
     // Initialize the cache
     InitCache();
@@ -61,6 +91,311 @@ CRC_CACHE::CRC_CACHE( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _lin
 
     // Initialize the stats
     InitStats();
+
+    // Pick the access engine for this geometry and policy
+    SelectEngine();
+
+    // The CMP$im front end owns the constructor call, so capture is
+    // requested through the environment: CRC_CAPTURE=<stream file>. Every
+    // instance reads it, so it suits a process with one cache; llcsim
+    // rejects it when it builds several.
+    const char *captureFile = getenv( "CRC_CAPTURE" );
+    if( captureFile != NULL && captureFile[0] != '\0' )
+    {
+        EnableCapture( captureFile );
+    }
+
+    // Likewise for checkpoints: CRC_RESTORE=<file> starts from a saved
+    // state, CRC_CHECKPOINT=<file> with CRC_CHECKPOINT_AT=<N> saves the
+    // state after the Nth access (one cache only, as for capture)
+    const char *restoreFile = getenv( "CRC_RESTORE" );
+    if( restoreFile != NULL && restoreFile[0] != '\0' && !LoadCheckpoint( restoreFile ) )
+    {
+        cerr << "CRC_CACHE: cannot start from checkpoint " << restoreFile << endl;
+        exit( 1 );
+    }
+
+    const char *saveFile = getenv( "CRC_CHECKPOINT" );
+    const char *saveAt   = getenv( "CRC_CHECKPOINT_AT" );
+    if( saveFile != NULL && saveFile[0] != '\0' && saveAt != NULL )
+    {
+        CheckpointAt( saveFile, strtoull( saveAt, NULL, 0 ) );
+    }
+
+    // CRC_WARMUP=<N>: the first N accesses only warm the cache up.
+    // CRC_REGION=<N>: statistics per N accesses after that.
+    const char *warmup = getenv( "CRC_WARMUP" );
+    if( warmup != NULL && warmup[0] != '\0' )
+    {
+        SetWarmup( strtoull( warmup, NULL, 0 ) );
+    }
+
+    const char *region = getenv( "CRC_REGION" );
+    if( region != NULL && region[0] != '\0' )
+    {
+        SetRegionLength( strtoull( region, NULL, 0 ) );
+    }
+}
+
+// Flushes a capture still open and frees the tag store, the replacement
+// state and the counters of every region
+CRC_CACHE::~CRC_CACHE()
+{
+    DisableCapture();
+
+    free( tags );
+    delete [] validMask;
+    delete [] dirtyMask;
+    delete [] sharingDir;
+    delete [] lineView;
+    delete [] sampleMap;
+
+    delete cacheReplState;
+
+    FreeStats( &stats );
+    for(UINT32 r=0; r<numRegions; r++) FreeStats( &regions[r] );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Starts recording the LLC access stream. Each LookupAndFillCache call is    //
+// written as (tid, PC, paddr, accessType, sequence number) so the run can    //
+// be replayed exactly by llcsim against any replacement policy. With set     //
+// sampling only the accesses to simulated sets are written, numbered in      //
+// the order they are written.                                                //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool CRC_CACHE::EnableCapture( const char *filename )
+{
+    DisableCapture();
+
+    capture  = new LLC_TRACE_WRITER();
+    captured = 0;
+
+    if( !capture->Open( filename, threads ) )
+    {
+        delete capture;
+        capture = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void CRC_CACHE::DisableCapture()
+{
+    if( capture != NULL )
+    {
+        capture->Close();
+        delete capture;
+        capture = NULL;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Checkpoints. The tag store is saved as stored, so a checkpoint of a        //
+// set-sampled cache only restores into one sampling the same sets. The       //
+// replacement state goes in per component (see                               //
+// CACHE_REPLACEMENT_STATE::SaveState), which lets a cache warmed under       //
+// one policy start another from the same contents.                           //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool CRC_CACHE::SaveCheckpoint( const char *filename )
+{
+    CRC_CHECKPOINT_WRITER   writer;
+    CRC_CHECKPOINT_GEOMETRY geometry;
+
+    if( !writer.Open( filename ) ) return false;
+
+    geometry.numsets      = numsets;
+    geometry.storedSets   = storedSets;
+    geometry.assoc        = assoc;
+    geometry.threads      = threads;
+    geometry.linesize     = linesize;
+    geometry.replPolicy   = replPolicy;
+    geometry.sampleEvery  = sampleEvery;
+    geometry.sampleRandom = sampleRandom;
+
+    writer.Section( CKPT_CACHE_GEOMETRY, &geometry, sizeof(geometry) );
+
+    if( sampleMap != NULL )
+    {
+        writer.Section( CKPT_CACHE_SAMPLE_MAP, sampleMap, sizeof(INT32) * numsets );
+    }
+
+    writer.Section( CKPT_CACHE_TAGS, tags, sizeof(Addr_t) * storedSets * tagStride );
+    writer.Section( CKPT_CACHE_VALID, validMask, sizeof(BITVECTOR) * storedSets );
+    writer.Section( CKPT_CACHE_DIRTY, dirtyMask, sizeof(BITVECTOR) * storedSets );
+    writer.Section( CKPT_CACHE_SHARING, sharingDir, sizeof(BITVECTOR) * storedSets * tagStride );
+    writer.Section( CKPT_CACHE_TIMER, &mytimer, sizeof(mytimer) );
+
+    cacheReplState->SaveState( writer );
+
+    if( !writer.Close() )
+    {
+        cerr << "CRC_CACHE: failed writing checkpoint " << filename << endl;
+        return false;
+    }
+
+    cerr << "CRC_CACHE: checkpoint " << filename << " saved after " << mytimer << " accesses" << endl;
+
+    return true;
+}
+
+bool CRC_CACHE::LoadCheckpoint( const char *filename )
+{
+    CRC_CHECKPOINT_READER   reader;
+    CRC_CHECKPOINT_GEOMETRY geometry;
+
+    if( !reader.Open( filename ) ) return false;
+
+    if( !reader.Read( CKPT_CACHE_GEOMETRY, &geometry, sizeof(geometry) )
+        || geometry.numsets != numsets || geometry.storedSets != storedSets
+        || geometry.assoc != assoc || geometry.threads != threads || geometry.linesize != linesize
+        || geometry.sampleEvery != sampleEvery || geometry.sampleRandom != (UINT32) sampleRandom )
+    {
+        cerr << "CRC_CACHE: checkpoint " << filename << " is for another cache configuration" << endl;
+        return false;
+    }
+
+    if( sampleMap != NULL )
+    {
+        size_t      bytes = 0;
+        const void *map   = reader.Find( CKPT_CACHE_SAMPLE_MAP, &bytes );
+
+        if( map == NULL || bytes != sizeof(INT32) * numsets || memcmp( map, sampleMap, bytes ) != 0 )
+        {
+            cerr << "CRC_CACHE: checkpoint " << filename << " samples other sets" << endl;
+            return false;
+        }
+    }
+
+    // Check every tag store section before touching the cache
+    static const UINT32 ids[] = { CKPT_CACHE_TAGS, CKPT_CACHE_VALID, CKPT_CACHE_DIRTY, CKPT_CACHE_SHARING, CKPT_CACHE_TIMER };
+    void   *state[] = { tags, validMask, dirtyMask, sharingDir, &mytimer };
+    size_t  sizes[] = { sizeof(Addr_t) * storedSets * tagStride, sizeof(BITVECTOR) * storedSets,
+                        sizeof(BITVECTOR) * storedSets, sizeof(BITVECTOR) * storedSets * tagStride, sizeof(mytimer) };
+
+    for(UINT32 i=0; i<sizeof(ids)/sizeof(ids[0]); i++)
+    {
+        size_t bytes = 0;
+
+        if( reader.Find( ids[i], &bytes ) == NULL || bytes != sizes[i] )
+        {
+            cerr << "CRC_CACHE: checkpoint " << filename << " is incomplete" << endl;
+            return false;
+        }
+    }
+
+    for(UINT32 i=0; i<sizeof(ids)/sizeof(ids[0]); i++)
+    {
+        reader.Read( ids[i], state[i], sizes[i] );
+    }
+
+    if( geometry.replPolicy != replPolicy )
+    {
+        cerr << "CRC_CACHE: checkpoint " << filename << " was taken under policy " << geometry.replPolicy
+             << ", restoring its shared state into policy " << replPolicy << endl;
+    }
+
+    cacheReplState->LoadState( reader );
+
+    cerr << "CRC_CACHE: restored " << filename << " at " << mytimer << " accesses" << endl;
+
+    // Counting starts here; a warm-up or region end already passed moves
+    // up to this point
+    stats.beginAccess = mytimer;
+
+    if( warming && warmupEnd <= mytimer ) SetWarmup( warmupEnd );
+    if( regionLength != 0 && regionEnd <= mytimer ) SetRegionLength( regionLength );
+
+    ScheduleEvents();
+
+    return true;
+}
+
+void CRC_CACHE::CheckpointAt( const char *filename, COUNTER accesses )
+{
+    checkpointFile = filename;
+    checkpointAt   = accesses;
+
+    ScheduleEvents();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Set sampling for quick runs, requested like capture through the            //
+// environment: CRC_SET_SAMPLE=<N> simulates numsets/N sets drawn at random   //
+// (seeded by CRC_SEED), CRC_SET_SAMPLE=<N>:every every Nth set. N is a power //
+// of two. Only the simulated sets are stored, and the replacement state is   //
+// scaled down to match (see ScaleDown), so its leader sets are drawn among   //
+// them at the full cache's share.                                            //
+//                                                                            //
+// Every Nth set aliases with strided streams, whose lines fall in only some  //
+// of the sets, and the estimates are then biased. It is kept for comparison  //
+// and warns when used.                                                       //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_CACHE::InitSampling()
+{
+    sampleEvery  = 1;
+    sampleRandom = false;
+    sampleMap    = NULL;
+    storedSets   = numsets;
+    sampleGroups = 0;
+
+    const char *sample = getenv( "CRC_SET_SAMPLE" );
+    if( sample == NULL || sample[0] == '\0' ) return;
+
+    UINT32 every = atoi( sample );
+    if( every <= 1 || (every & (every - 1)) || every > numsets )
+    {
+        cerr << "CRC_CACHE: CRC_SET_SAMPLE must be a power of two up to the set count, set sampling off" << endl;
+        return;
+    }
+
+    sampleEvery  = every;
+    sampleRandom = (strstr( sample, ":every" ) == NULL);
+    if( !sampleRandom )
+    {
+        cerr << "CRC_CACHE: every Nth set sampling (1 in " << every << ") aliases with strided streams, the estimates may be biased" << endl;
+    }
+    storedSets   = numsets / sampleEvery;
+    sampleGroups = (storedSets < CRC_SAMPLE_GROUPS) ? storedSets : CRC_SAMPLE_GROUPS;
+    sampleMap    = new INT32[ numsets ];
+
+    for(UINT32 setIndex=0; setIndex<numsets; setIndex++)
+    {
+        sampleMap[ setIndex ] = (!sampleRandom && (setIndex % sampleEvery) == 0) ? 0 : -1;
+    }
+
+    if( sampleRandom )
+    {
+        CRC_RANDOM  rng;
+        const char *seed = getenv( "CRC_SEED" );
+
+        if( seed != NULL && seed[0] != '\0' ) rng.Seed( strtoull( seed, NULL, 0 ) );
+
+        for(UINT32 picked=0; picked<storedSets; )
+        {
+            UINT32 setIndex = rng.Below( numsets );
+
+            if( sampleMap[ setIndex ] < 0 )
+            {
+                sampleMap[ setIndex ] = 0;
+                picked++;
+            }
+        }
+    }
+
+    // Stored sets keep the order of the set indices
+    UINT32 stored = 0;
+
+    for(UINT32 setIndex=0; setIndex<numsets; setIndex++)
+    {
+        if( sampleMap[ setIndex ] == 0 ) sampleMap[ setIndex ] = stored++;
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -75,24 +410,39 @@ void CRC_CACHE::InitCache()
     indexShift = CRC_FloorLog2( numsets );    
     indexMask  = (1 << indexShift) - 1;
 
-    // Create the cache structure (first create the sets)
-    cache = new LINE_STATE* [ numsets ];
+    // The valid/dirty masks hold one bit per way
+    assert( assoc <= 64 );
+
+    tagStride = (assoc + 3) & ~3;
+    wayMask   = (assoc == 64) ? ~0ULL : ((1ULL << assoc) - 1);
+
+    // Create the cache structure: one contiguous, vector aligned tag array
+    // and per-set valid/dirty bit masks
+    void *mem = NULL;
+    int   err = posix_memalign( &mem, 64, sizeof(Addr_t) * storedSets * tagStride );
 
     // ensure that we were able to create cache
-    assert(cache);
+    assert( err == 0 && mem );
+    (void) err;
+
+    prefetch   = (2 * sizeof(Addr_t) * storedSets * tagStride > CRC_BATCH_PREFETCH_BYTES);
+
+    tags       = (Addr_t *) mem;
+    validMask  = new BITVECTOR[ storedSets ];
+    dirtyMask  = new BITVECTOR[ storedSets ];
+    sharingDir = new BITVECTOR[ storedSets * tagStride ];
+    lineView   = new LINE_STATE[ assoc ];
 
-    // If we were able to create the sets, now create the ways
-    for(UINT32 setIndex=0; setIndex<numsets; setIndex++) 
+    // Initialize the cache ways
+    for(UINT32 setIndex=0; setIndex<storedSets; setIndex++) 
     {
-        cache[ setIndex ] = new LINE_STATE[ assoc ];
+        validMask[ setIndex ] = 0;
+        dirtyMask[ setIndex ] = 0;
 
-        // Initialize the cache ways
-        for(UINT32 way=0; way<assoc; way++) 
+        for(UINT32 way=0; way<tagStride; way++) 
         {
-            cache[ setIndex ][ way ].tag   = 0xdeaddead;
-            cache[ setIndex ][ way ].valid = false;
-            cache[ setIndex ][ way ].dirty = false;
-            cache[ setIndex ][ way ].sharing_dir   = 0;
+            tags[ setIndex * tagStride + way ]       = 0xdeaddead;
+            sharingDir[ setIndex * tagStride + way ] = 0;
         }
     }
 
@@ -107,20 +457,246 @@ void CRC_CACHE::InitCache()
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 void CRC_CACHE::InitStats()
+{
+    AllocateStats( &stats );
+
+    numRegions = 0;
+}
+
+// Zeroed counters for a region starting now
+void CRC_CACHE::AllocateStats( CRC_CACHE_REGION *region )
+{
+    region->beginAccess = mytimer;
+    region->endAccess   = mytimer;
+
+    for(UINT32 i=0; i<ACCESS_MAX; i++) 
+    {
+        region->lookups[i] = new COUNTER[ threads ];
+        region->misses[i]  = new COUNTER[ threads ];
+        region->hits[i]    = new COUNTER[ threads ];
+
+        for(UINT32 t=0; t<threads; t++) 
+        {
+            region->lookups[i][t] = 0;
+            region->misses[i][t]  = 0;
+            region->hits[i][t]    = 0;
+        }
+
+        region->groupLookups[i] = NULL;
+        region->groupMisses[i]  = NULL;
+
+        if( sampleGroups )
+        {
+            region->groupLookups[i] = new COUNTER[ sampleGroups * threads ];
+            region->groupMisses[i]  = new COUNTER[ sampleGroups * threads ];
+
+            for(UINT32 g=0; g<sampleGroups * threads; g++)
+            {
+                region->groupLookups[i][g] = 0;
+                region->groupMisses[i][g]  = 0;
+            }
+        }
+    }
+}
+
+void CRC_CACHE::FreeStats( CRC_CACHE_REGION *region )
 {
     for(UINT32 i=0; i<ACCESS_MAX; i++) 
     {
-        lookups[i] = new COUNTER[ threads ];
-        misses[i]  = new COUNTER[ threads ];
-        hits[i]    = new COUNTER[ threads ];
+        delete [] region->lookups[i];
+        delete [] region->misses[i];
+        delete [] region->hits[i];
+        delete [] region->groupLookups[i];
+        delete [] region->groupMisses[i];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Adds the statistics of another cache with the same thread count, e.g. a    //
+// shard of a sharded replay, to this one.                                    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_CACHE::AddStats( const CRC_CACHE *other )
+{
+    assert( other->threads == threads );
+
+    for(UINT32 a=0; a<ACCESS_MAX; a++) 
+    {
+        for(UINT32 t=0; t<threads; t++) 
+        {
+            stats.lookups[a][t] += other->stats.lookups[a][t];
+            stats.misses[a][t]  += other->stats.misses[a][t];
+            stats.hits[a][t]    += other->stats.hits[a][t];
+        }
+
+        for(UINT32 g=0; g<sampleGroups * threads; g++) 
+        {
+            stats.groupLookups[a][g] += other->stats.groupLookups[a][g];
+            stats.groupMisses[a][g]  += other->stats.groupMisses[a][g];
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Warm-up and statistics regions. Their boundaries, and the checkpoint       //
+// access, are folded into nextEvent so that LookupAndFillCache pays a        //
+// single compare per access for all of them. The warm-up runs an engine      //
+// built without statistics (see SelectEngine), so its accesses count for     //
+// nothing and cost a little less.                                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_CACHE::SetWarmup( COUNTER accesses )
+{
+    warmupEnd = accesses;
+    warming   = (accesses > mytimer);
+
+    if( regionLength != 0 )
+    {
+        regionEnd = (warming ? warmupEnd : mytimer) + regionLength;
+    }
+
+    SelectEngine();
+    ScheduleEvents();
+}
+
+void CRC_CACHE::SetRegionLength( COUNTER accesses )
+{
+    regionLength = accesses;
+    regionEnd    = (warming ? warmupEnd : mytimer) + regionLength;
+
+    ScheduleEvents();
+}
 
+void CRC_CACHE::ResetStats()
+{
+    for(UINT32 a=0; a<ACCESS_MAX; a++) 
+    {
         for(UINT32 t=0; t<threads; t++) 
         {
-            lookups[i][t] = 0;
-            misses[i][t]  = 0;
-            hits[i][t]    = 0;
+            stats.lookups[a][t] = 0;
+            stats.misses[a][t]  = 0;
+            stats.hits[a][t]    = 0;
+        }
+
+        for(UINT32 g=0; g<sampleGroups * threads; g++) 
+        {
+            stats.groupLookups[a][g] = 0;
+            stats.groupMisses[a][g]  = 0;
         }
     }
+
+    stats.beginAccess = mytimer;
+
+    cacheReplState->ResetStats();
+}
+
+void CRC_CACHE::EndRegion()
+{
+    if( numRegions == CRC_MAX_REGIONS )
+    {
+        // The last region runs on to the end of the run
+        if( regionLength != 0 )
+        {
+            cerr << "CRC_CACHE: more than " << CRC_MAX_REGIONS << " regions, the last one runs to the end" << endl;
+            regionLength = 0;
+            ScheduleEvents();
+        }
+        return;
+    }
+
+    stats.endAccess        = mytimer;
+    regions[ numRegions ]  = stats;
+
+    // The policy's counters restart with the region's
+    ostringstream policy;
+    cacheReplState->PrintStats( policy );
+    regionPolicyStats[ numRegions++ ] = policy.str();
+    cacheReplState->ResetStats();
+
+    AllocateStats( &stats );
+}
+
+void CRC_CACHE::ScheduleEvents()
+{
+    nextEvent = ~0ULL;
+
+    if( warming && warmupEnd < nextEvent ) nextEvent = warmupEnd;
+    if( !warming && regionLength != 0 && regionEnd < nextEvent ) nextEvent = regionEnd;
+    if( checkpointAt > mytimer && checkpointAt < nextEvent ) nextEvent = checkpointAt;
+}
+
+void CRC_CACHE::AccessEvents()
+{
+    if( warming && mytimer == warmupEnd )
+    {
+        // Region of interest: counting starts from zero here
+        warming = false;
+        ResetStats();
+        SelectEngine();
+
+        regionEnd = mytimer + regionLength;
+    }
+    else if( !warming && regionLength != 0 && mytimer == regionEnd )
+    {
+        EndRegion();
+        regionEnd += regionLength;
+    }
+
+    if( mytimer == checkpointAt )
+    {
+        SaveCheckpoint( checkpointFile );
+    }
+
+    ScheduleEvents();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Half width of the 95% confidence interval, in percent, of the sampled      //
+// miss rate over the given access types and threads. The groups of           //
+// simulated sets are treated as clusters of a ratio estimator.               //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+double CRC_CACHE::SampledMissRateError( const CRC_CACHE_REGION &region, UINT32 firstType, UINT32 lastType, UINT32 firstTid, UINT32 lastTid )
+{
+    double groupLookup[ CRC_SAMPLE_GROUPS ];
+    double groupMiss[ CRC_SAMPLE_GROUPS ];
+    double totLookup = 0.0, totMiss = 0.0;
+
+    for(UINT32 g=0; g<sampleGroups; g++)
+    {
+        groupLookup[g] = 0.0;
+        groupMiss[g]   = 0.0;
+
+        for(UINT32 a=firstType; a<=lastType; a++)
+        {
+            for(UINT32 t=firstTid; t<=lastTid; t++)
+            {
+                groupLookup[g] += region.groupLookups[a][ g * threads + t ];
+                groupMiss[g]   += region.groupMisses[a][ g * threads + t ];
+            }
+        }
+
+        totLookup += groupLookup[g];
+        totMiss   += groupMiss[g];
+    }
+
+    if( sampleGroups < 2 || totLookup == 0.0 ) return 0.0;
+
+    double rate = totMiss / totLookup;
+    double var  = 0.0;
+
+    for(UINT32 g=0; g<sampleGroups; g++)
+    {
+        double residual = groupMiss[g] - rate * groupLookup[g];
+        var += residual * residual;
+    }
+
+    var *= (double) sampleGroups / (double) (sampleGroups - 1) / (totLookup * totLookup);
+
+    return CRC_SAMPLE_Z95 * sqrt( var ) * 100.0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -130,8 +706,6 @@ void CRC_CACHE::InitStats()
 ////////////////////////////////////////////////////////////////////////////////
 ostream & CRC_CACHE::PrintStats(ostream &out)
 {
-    COUNTER totLookups = 0, totMisses = 0, totHits = 0;
-
     out<<"=========================================================="<<endl;
     out<<"==== Cache Replacement Championship -- LLC Statistics ===="<<endl;
     out<<"=========================================================="<<endl;
@@ -143,6 +717,53 @@ ostream & CRC_CACHE::PrintStats(ostream &out)
     out<<"\tAssociativity:  "<<assoc<<endl;
     out<<"\tTot # Sets:     "<<numsets<<endl;
     out<<"\tTot # Threads:  "<<threads<<endl;
+
+    if( sampleMap != NULL )
+    {
+        out<<"\tSet Sampling:   1 in "<<sampleEvery<<(sampleRandom ? " (random)" : " (every Nth)")
+           <<", "<<storedSets<<" sets simulated, counts extrapolated"<<endl;
+    }
+
+    if( warmupEnd != 0 )
+    {
+        out<<"\tWarm-up:        "<<warmupEnd<<" accesses, not counted"<<(warming ? " (still warming up)" : "")<<endl;
+    }
+
+    // One block per finished region, then the current one
+    stats.endAccess = mytimer;
+
+    for(UINT32 r=0; r<numRegions; r++)
+    {
+        out<<endl;
+        out<<"Region "<<r<<": accesses "<<regions[r].beginAccess + 1<<" to "<<regions[r].endAccess<<endl;
+        PrintRegionStats( out, regions[r] );
+        out<<regionPolicyStats[r];
+    }
+
+    // ... unless the run ended right at a region boundary
+    if( numRegions == 0 )
+    {
+        PrintRegionStats( out, stats );
+        cacheReplState->PrintStats( out );
+    }
+    else if( stats.endAccess != stats.beginAccess )
+    {
+        out<<endl;
+        out<<"Region "<<numRegions<<": accesses "<<stats.beginAccess + 1<<" to "<<stats.endAccess<<endl;
+        PrintRegionStats( out, stats );
+        cacheReplState->PrintStats( out );
+    }
+     
+    return out;
+}
+
+void CRC_CACHE::PrintRegionStats( ostream &out, const CRC_CACHE_REGION &region )
+{
+    COUNTER totLookups = 0, totMisses = 0, totHits = 0;
+
+    // Sampled runs report counts scaled up to all sets, and the 95%
+    // confidence interval of each miss rate
+    COUNTER scale = numsets / storedSets;
     
     out<<endl;
     out<<"Cache Statistics: "<<endl;
@@ -157,17 +778,19 @@ ostream & CRC_CACHE::PrintStats(ostream &out)
 
         for(UINT32 t=0; t<threads; t++) 
         {
-            totLookups += lookups[a][t];
-            totMisses  += misses[a][t];
-            totHits    += hits[a][t];
+            totLookups += region.lookups[a][t];
+            totMisses  += region.misses[a][t];
+            totHits    += region.hits[a][t];
         }
 
         if( totLookups ) 
         {
-            out<<"\t"<<crc_access_names[a]<<" Accesses:   "<<totLookups<<endl;
-            out<<"\t"<<crc_access_names[a]<<" Misses:     "<<totMisses<<endl;
-            out<<"\t"<<crc_access_names[a]<<" Hits:       "<<totHits<<endl;
-            out<<"\t"<<crc_access_names[a]<<" Miss Rate:  "<<((double)totMisses/(double)totLookups)*100.0<<endl;
+            out<<"\t"<<crc_access_names[a]<<" Accesses:   "<<totLookups * scale<<endl;
+            out<<"\t"<<crc_access_names[a]<<" Misses:     "<<totMisses * scale<<endl;
+            out<<"\t"<<crc_access_names[a]<<" Hits:       "<<totHits * scale<<endl;
+            out<<"\t"<<crc_access_names[a]<<" Miss Rate:  "<<((double)totMisses/(double)totLookups)*100.0;
+            if( sampleMap != NULL ) out<<" +- "<<SampledMissRateError( region, a, a, 0, threads - 1 );
+            out<<endl;
 
             out<<endl;
         }
@@ -178,21 +801,24 @@ ostream & CRC_CACHE::PrintStats(ostream &out)
 
     for(UINT32 t=0; t<threads; t++) 
     {
-        totLookups = ThreadDemandLookupStats(t);
-        totMisses  = ThreadDemandMissStats(t);
-        totHits    = ThreadDemandHitStats(t);
+        totLookups = 0;
+        totMisses  = 0;
+
+        for(UINT32 a=0; a<=ACCESS_STORE; a++)
+        {
+            totLookups += region.lookups[a][t];
+            totMisses  += region.misses[a][t];
+        }
 
         if( totLookups )
         {
-            out<<"\tThread: "<<t<<" Lookups: "<<totLookups<<" Misses: "<<totMisses
-                <<" Miss Rate: "<<((double)totMisses/(double)totLookups)*100.0<<endl;
+            out<<"\tThread: "<<t<<" Lookups: "<<totLookups * scale<<" Misses: "<<totMisses * scale
+                <<" Miss Rate: "<<((double)totMisses/(double)totLookups)*100.0;
+            if( sampleMap != NULL ) out<<" +- "<<SampledMissRateError( region, 0, ACCESS_STORE, t, t );
+            out<<endl;
         }
     }
     out<<endl;
-
-    cacheReplState->PrintStats( out );
-     
-    return out;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -202,22 +828,33 @@ ostream & CRC_CACHE::PrintStats(ostream &out)
 // the replacement policy is consulted to find the victim                     //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-INT32 CRC_CACHE::GetVictimInSet( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
+template <UINT32 ASSOC, UINT32 POL>
+inline INT32 CRC_CACHE::GetVictimInSetT( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
 {
-    // Get pointer to replacement state of current set
-    LINE_STATE *vicSet = cache[ setIndex ];
+    const UINT32    ways     = (ASSOC != CRC_GEOM_DYNAMIC) ? ASSOC : assoc;
+    const BITVECTOR allWays  = (ASSOC != CRC_GEOM_DYNAMIC) ? ((ASSOC == 64) ? ~0ULL : ((1ULL << ASSOC) - 1)) : wayMask;
 
     // First find and fill invalid lines
-    for(UINT32 way=0; way<assoc; way++) 
+    BITVECTOR invalid = ~validMask[ setIndex ] & allWays;
+
+    if( invalid ) 
     {
-        if( vicSet[way].valid == false ) 
-        {
-            return way;
-        }
+        return CRC_Ctz( invalid );
+    }
+
+    // Build the view of the current set for the replacement policy
+    for(UINT32 way=0; way<ways; way++) 
+    {
+        GetLineState( setIndex, way, &lineView[ way ] );
     }
 
     // If no invalid lines, then replace based on replacement policy
-    return cacheReplState->GetVictimInSet( tid, setIndex, vicSet, assoc, PC, paddr, accessType );
+    return cacheReplState->GetVictimInSetT<POL>( tid, setIndex, lineView, ways, PC, paddr, accessType );
+}
+
+INT32 CRC_CACHE::GetVictimInSet( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
+{
+    return GetVictimInSetT<CRC_GEOM_DYNAMIC, CRC_REPL_DYNAMIC>( tid, setIndex, PC, paddr, accessType );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -226,22 +863,22 @@ INT32 CRC_CACHE::GetVictimInSet( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t
 // if the tag was a hit. Else returns -1 if it was a miss.                    //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-INT32 CRC_CACHE::LookupSet( UINT32 setIndex, Addr_t tag )
+template <UINT32 ASSOC>
+inline INT32 CRC_CACHE::LookupSetT( UINT32 setIndex, Addr_t tag )
 {
-    // Get pointer to current set
-    LINE_STATE *currSet = cache[ setIndex ];
+    const UINT32 stride = (ASSOC != CRC_GEOM_DYNAMIC) ? ((ASSOC + 3) & ~3) : tagStride;
 
-    // Find Tag
-    for(UINT32 way=0; way<assoc; way++) 
-    {
-        if( currSet[way].valid && (currSet[way].tag == tag) ) 
-        {
-            return way;
-        }
-    }
+    // Compare all ways of the set at once, then keep only the valid ones
+    BITVECTOR match = CRC_MatchTags( &tags[ setIndex * stride ], stride, tag )
+                      & validMask[ setIndex ];
 
     // If not found, return -1
-    return -1;
+    return match ? (INT32) CRC_Ctz( match ) : -1;
+}
+
+INT32 CRC_CACHE::LookupSet( UINT32 setIndex, Addr_t tag )
+{
+    return LookupSetT<CRC_GEOM_DYNAMIC>( setIndex, tag );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -256,6 +893,12 @@ bool CRC_CACHE::CacheInspect( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 access
     UINT32 setIndex = GetSetIndex( paddr );  // Get the set index
     Addr_t tag      = GetTag( paddr );       // Determine Cache Tag
 
+    if( sampleMap != NULL )
+    {
+        if( sampleMap[ setIndex ] < 0 ) return false;
+        setIndex = sampleMap[ setIndex ];
+    }
+
     INT32 wayID     = LookupSet( setIndex, tag );
 
     // if wayID = -1, miss, else it is a hit
@@ -272,73 +915,241 @@ bool CRC_CACHE::CacheInspect( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 access
 // to determine how to update the replacement state.                          //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-bool CRC_CACHE::LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
+template <UINT32 ASSOC, UINT32 LINE_SHIFT, UINT32 INDEX_SHIFT, UINT32 POL, bool STATS>
+bool CRC_CACHE::LookupAndFillCacheT( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
 {
+    const UINT32 stride = (ASSOC != CRC_GEOM_DYNAMIC) ? ((ASSOC + 3) & ~3) : tagStride;
+    const UINT32 lShift = (LINE_SHIFT != CRC_GEOM_DYNAMIC) ? LINE_SHIFT : lineShift;
+    const UINT32 iShift = (INDEX_SHIFT != CRC_GEOM_DYNAMIC) ? INDEX_SHIFT : indexShift;
+    const UINT32 iMask  = (INDEX_SHIFT != CRC_GEOM_DYNAMIC) ? ((1 << INDEX_SHIFT) - 1) : indexMask;
 
-    LINE_STATE *currLine = NULL;
+    LINE_STATE currLine;
+
+    // Process request
+    bool  hit       = true;
+    UINT32 setIndex = (paddr >> lShift) & iMask;      // Get the set index
+    Addr_t tag      = (paddr >> lShift) >> iShift;    // Determine Cache Tag
 
-    // for modeling LRU
     ++mytimer;     
+
+    // Set sampling: accesses to sets that are not simulated stop here (see
+    // LookupAndFillCache in crc_cache.h)
+    if( sampleMap != NULL )
+    {
+        if( sampleMap[ setIndex ] < 0 ) return false;
+        setIndex = sampleMap[ setIndex ];
+    }
+
+    // for modeling LRU
     cacheReplState->IncrementTimer();
 
-    // manage stats for cache
-    lookups[ accessType ][ tid ]++;
+    // record the access for offline replay
+    if( capture )
+    {
+        capture->Append( tid, PC, paddr, accessType, ++captured );
+    }
 
-    // Process request
-    bool  hit       = true;
-    UINT32 setIndex = GetSetIndex( paddr );  // Get the set index
-    Addr_t tag      = GetTag( paddr );       // Determine Cache Tag
+    // manage stats for cache
+    if( STATS ) stats.lookups[ accessType ][ tid ]++;
 
     // Lookup the cache set to determine whether line is already in cache or not
-    INT32 wayID     = LookupSet( setIndex, tag );
+    INT32 wayID     = LookupSetT<ASSOC>( setIndex, tag );
 
+    BITVECTOR storeBit = IS_STORE( accessType );
    
     if( wayID == -1 ) 
     {
         hit = false;
 
         // get victim line to replace (wayID = -1, then bypass)
-        wayID     = GetVictimInSet( tid, setIndex, PC, paddr, accessType );
+        wayID     = GetVictimInSetT<ASSOC, POL>( tid, setIndex, PC, paddr, accessType );
 
         if( wayID != -1 )
         {
-            currLine  = &cache[ setIndex ][ wayID ];
+            UINT32    index   = setIndex * stride + wayID;
+            BITVECTOR wayBit  = 1ULL << wayID;
 
             // Update the line state accordingly
-            currLine->valid          = true;
-            currLine->tag            = tag;
-            currLine->dirty          = IS_STORE( accessType );
-            currLine->sharing_dir    = (1<<tid);
+            tags[ index ]          = tag;
+            validMask[ setIndex ] |= wayBit;
+            dirtyMask[ setIndex ]  = (dirtyMask[ setIndex ] & ~wayBit) | (storeBit << wayID);
+            sharingDir[ index ]    = (1<<tid);
 
             // Update Replacement State
-            cacheReplState->UpdateReplacementState( setIndex, wayID, currLine, tid, PC, accessType, hit );
+            GetLineState( setIndex, wayID, &currLine );
+            cacheReplState->UpdateReplacementStateT<POL>( setIndex, wayID, &currLine, tid, PC, paddr, accessType, hit );
         }
         
         // Update Stats
-        misses[ accessType ][ tid ]++;
+        if( STATS ) stats.misses[ accessType ][ tid ]++;
     }
     else 
     {
-        // get pointer to cache line we hit
-        currLine         = &cache[ setIndex ][ wayID ];
+        UINT32 index = setIndex * stride + wayID;
 
         // Update the line state accordingly
-        currLine->dirty         |= IS_STORE( accessType );
-        currLine->sharing_dir   |= (1<<tid);
+        dirtyMask[ setIndex ] |= storeBit << wayID;
+        sharingDir[ index ]   |= (1<<tid);
 
         // Update Replacement State
         if( accessType != ACCESS_WRITEBACK ) 
         {
-            cacheReplState->UpdateReplacementState( setIndex, wayID, currLine, tid, PC, accessType, hit );
+            GetLineState( setIndex, wayID, &currLine );
+            cacheReplState->UpdateReplacementStateT<POL>( setIndex, wayID, &currLine, tid, PC, paddr, accessType, hit );
         }
 
         // Update Stats
-        hits[ accessType ][ tid ]++;
+        if( STATS ) stats.hits[ accessType ][ tid ]++;
     }        
 
+    if( STATS && sampleMap != NULL )
+    {
+        UINT32 group = (setIndex % sampleGroups) * threads + tid;
+
+        stats.groupLookups[ accessType ][ group ]++;
+        stats.groupMisses[ accessType ][ group ] += !hit;
+    }
+
+    return hit;
+}
+
+bool CRC_CACHE::LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType ) 
+{
+    bool hit = (this->*engine)( tid, PC, paddr, accessType );
+
+    if( mytimer == nextEvent )
+    {
+        AccessEvents();
+    }
+
     return hit;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Batched lookups. Accesses are simulated strictly in order, so the          //
+// results are those of one LookupAndFillCache call each; only the host       //
+// memory traffic of the sets further down the batch is started early.        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CRC_CACHE::LookupAndFillCacheBatch( const LLC_ACCESS *accesses, UINT32 count, bool *hit )
+{
+    UINT32 ahead = prefetch ? CRC_BATCH_PREFETCH : 0;
+
+    for(UINT32 i=0; i<count && i<ahead; i++)
+    {
+        PrefetchSet( accesses[i] );
+    }
+
+    for(UINT32 i=0; i<count; i++)
+    {
+        if( ahead != 0 && i + ahead < count )
+        {
+            PrefetchSet( accesses[ i + ahead ] );
+        }
+
+        const LLC_ACCESS &access = accesses[i];
+        bool              result = (this->*engine)( access.tid, access.PC, access.paddr, access.accessType );
+
+        if( mytimer == nextEvent )
+        {
+            AccessEvents();
+        }
+
+        if( hit != NULL ) hit[i] = result;
+    }
+}
+
+void CRC_CACHE::PrefetchSet( const LLC_ACCESS &access )
+{
+    UINT32 setIndex = GetSetIndex( access.paddr );
+
+    if( sampleMap != NULL )
+    {
+        if( sampleMap[ setIndex ] < 0 ) return;
+        setIndex = sampleMap[ setIndex ];
+    }
+
+    // The tags and sharing vectors of a 16-way set take two lines each
+    for(UINT32 way=0; way<tagStride; way+=8)
+    {
+        CRC_Prefetch( &tags[ setIndex * tagStride + way ] );
+        CRC_Prefetch( &sharingDir[ setIndex * tagStride + way ] );
+    }
+
+    CRC_Prefetch( &validMask[ setIndex ] );
+    CRC_Prefetch( &dirtyMask[ setIndex ] );
+
+    cacheReplState->Prefetch( setIndex, access.PC );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Engines compiled for the common LLC configurations. Each is the body of    //
+// LookupAndFillCacheT with the way count, shifts and replacement policy      //
+// known at compile time, so the way loops unroll and the policy dispatch     //
+// folds away. Anything else runs the fully dynamic instance. Each comes      //
+// with and without statistics, the latter for the warm-up.                   //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+    UINT32  assoc;
+    UINT32  lineShift;
+    UINT32  indexShift;
+    UINT32  policy;
+    bool    (CRC_CACHE::*func)( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType );
+    bool    (CRC_CACHE::*warmFunc)( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType );
+} CRC_CACHE_ENGINE;
+
+#define CRC_ENGINE(A, L, I, P) \
+    { A, L, I, P, &CRC_CACHE::LookupAndFillCacheT<A, L, I, P, true>, &CRC_CACHE::LookupAndFillCacheT<A, L, I, P, false> }
+
+#define CRC_ENGINES_ALL_POLICIES(A, L, I)       \
+    CRC_ENGINE( A, L, I, CRC_REPL_LRU ),        \
+    CRC_ENGINE( A, L, I, CRC_REPL_RANDOM ),     \
+    CRC_ENGINE( A, L, I, CRC_REPL_DRRIP ),      \
+    CRC_ENGINE( A, L, I, CRC_REPL_SHIP ),       \
+    CRC_ENGINE( A, L, I, CRC_REPL_EAF ),        \
+    CRC_ENGINE( A, L, I, CRC_REPL_EAF_RRIP ),   \
+    CRC_ENGINE( A, L, I, CRC_REPL_HAWKEYE ),    \
+    CRC_ENGINE( A, L, I, CRC_REPL_PERCEPTRON ), \
+    CRC_ENGINE( A, L, I, CRC_REPL_SDBP ),       \
+    CRC_ENGINE( A, L, I, CRC_REPL_PLUGIN )
+
+void CRC_CACHE::SelectEngine()
+{
+    static const CRC_CACHE_ENGINE engines[] =
+    {
+        CRC_ENGINES_ALL_POLICIES( 16, 6, 11 ),  // UL3:2048:64:16
+        CRC_ENGINES_ALL_POLICIES( 16, 6, 12 ),  // UL3:4096:64:16
+        CRC_ENGINES_ALL_POLICIES( 16, 6, 13 )   // UL3:8192:64:16
+    };
+
+    if( warming )
+        engine = &CRC_CACHE::LookupAndFillCacheT<CRC_GEOM_DYNAMIC, CRC_GEOM_DYNAMIC, CRC_GEOM_DYNAMIC, CRC_REPL_DYNAMIC, false>;
+    else
+        engine = &CRC_CACHE::LookupAndFillCacheT<CRC_GEOM_DYNAMIC, CRC_GEOM_DYNAMIC, CRC_GEOM_DYNAMIC, CRC_REPL_DYNAMIC, true>;
+
+    // CRC_GENERIC_ENGINE=1 forces the dynamic engine, e.g. to cross check
+    const char *generic = getenv( "CRC_GENERIC_ENGINE" );
+    if( generic != NULL && atoi( generic ) != 0 ) return;
+
+    // The index shift only describes the geometry for power of two set counts
+    if( numsets != (1U << indexShift) ) return;
+
+    for(UINT32 e=0; e<sizeof(engines)/sizeof(engines[0]); e++)
+    {
+        if( engines[e].assoc      == assoc      &&
+            engines[e].lineShift  == lineShift  &&
+            engines[e].indexShift == indexShift &&
+            engines[e].policy     == replPolicy )
+        {
+            engine = warming ? engines[e].warmFunc : engines[e].func;
+            return;
+        }
+    }
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
@@ -347,5 +1158,11 @@ bool CRC_CACHE::LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32
 ////////////////////////////////////////////////////////////////////////////////
 void CRC_CACHE::InitCacheReplacementState()
 {
-    cacheReplState = new CACHE_REPLACEMENT_STATE( numsets, assoc, replPolicy );
+    cacheReplState = new CACHE_REPLACEMENT_STATE( storedSets, assoc, policyId );
+    cacheReplState->SetLineSize( linesize );
+
+    if( sampleMap != NULL )
+    {
+        cacheReplState->ScaleDown( CRC_FloorLog2( sampleEvery ) );
+    }
 }
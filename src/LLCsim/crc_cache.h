@@ -27,6 +27,38 @@
 #include "utils.h"
 #include "replacement_state.h"
 #include "crc_cache_defs.h"
+#include "llc_trace.h"
+#include "crc_simd.h"
+#include "crc_checkpoint.h"
+
+// Geometry template argument meaning "use the run time value"
+#define CRC_GEOM_DYNAMIC    0
+
+// Set sampling: groups of simulated sets whose spread gives the confidence
+// intervals of the extrapolated statistics
+#define CRC_SAMPLE_GROUPS   16
+#define CRC_SAMPLE_Z95      1.96
+
+// Accesses ahead of the current one whose sets LookupAndFillCacheBatch
+// prefetches, if the tag store is larger than CRC_BATCH_PREFETCH_BYTES (a
+// smaller one stays in the host caches anyway)
+#define CRC_BATCH_PREFETCH          8
+#define CRC_BATCH_PREFETCH_BYTES    (2 << 20)
+
+// Statistics regions kept apart in PrintStats (see CRC_REGION)
+#define CRC_MAX_REGIONS     64
+
+// Counters of one region of the run; same layout as the live counters
+typedef struct
+{
+    COUNTER beginAccess;                    // mytimer before its first access
+    COUNTER endAccess;                      // mytimer after its last access
+    COUNTER *lookups[ ACCESS_MAX ];
+    COUNTER *misses[ ACCESS_MAX ];
+    COUNTER *hits[ ACCESS_MAX ];
+    COUNTER *groupLookups[ ACCESS_MAX ];    // set sampling, [group * threads + tid]
+    COUNTER *groupMisses[ ACCESS_MAX ];
+} CRC_CACHE_REGION;
 
 class CRC_CACHE
 {
@@ -37,15 +69,27 @@ class CRC_CACHE
     UINT32 assoc;
     UINT32 threads;
     UINT32 linesize;
-    UINT32 replPolicy;
+    UINT32 replPolicy;      // built-in policy, or CRC_REPL_PLUGIN
+    UINT32 policyId;        // as registered, see crc_policy.h
     
-    LINE_STATE               **cache;
+    // Tag store, kept as structure-of-arrays so a set lookup is a handful
+    // of vector compares over contiguous memory. Line (set, way) lives at
+    // index set*tagStride + way; tagStride is assoc rounded up to 4.
+    Addr_t                   *tags;
+    BITVECTOR                *validMask;     // per set, bit i = way i valid
+    BITVECTOR                *dirtyMask;     // per set, bit i = way i dirty
+    BITVECTOR                *sharingDir;    // per line, cores that accessed it
+    UINT32                   tagStride;
+    BITVECTOR                wayMask;        // bits of the ways that exist
+    bool                     prefetch;       // worth prefetching in batches
+
+    // LINE_STATE view of one set handed to the replacement policy
+    LINE_STATE               *lineView;
+
     CACHE_REPLACEMENT_STATE  *cacheReplState;
 
-    // statistics
-    COUNTER *lookups[ ACCESS_MAX ];
-    COUNTER *misses[ ACCESS_MAX ];
-    COUNTER *hits[ ACCESS_MAX ];
+    // statistics of the current region
+    CRC_CACHE_REGION stats;
 
     // Lookup Parameters
     UINT32 lineShift;
@@ -53,49 +97,167 @@ class CRC_CACHE
     UINT32 indexMask;
 
     COUNTER mytimer; 
+
+    // Set sampling (CRC_SET_SAMPLE): one in sampleEvery sets is simulated,
+    // the others are skipped once their index is known
+    UINT32  sampleEvery;             // 1 when off
+    bool    sampleRandom;            // random sets (the default) rather than every Nth
+    INT32   *sampleMap;              // set index -> stored set, -1 if skipped
+    UINT32  storedSets;              // sets held in the tag store
+    UINT32  sampleGroups;
+
+    // LLC stream capture (NULL when disabled) and the records written to it
+    LLC_TRACE_WRITER *capture;
+    COUNTER          captured;
+
+    // Checkpoint written once mytimer reaches checkpointAt (0 when off)
+    const char *checkpointFile;
+    COUNTER     checkpointAt;
+
+    // Warm-up and statistics regions. While warming the engine without
+    // statistics runs; at warmupEnd the counters start from zero. Every
+    // regionLength accesses after that the counters move to a new region.
+    bool        warming;
+    COUNTER     warmupEnd;
+    COUNTER     regionLength;
+    COUNTER     regionEnd;
+    CRC_CACHE_REGION regions[ CRC_MAX_REGIONS ];    // finished regions
+    string      regionPolicyStats[ CRC_MAX_REGIONS ];   // the policy's statistics of each
+    UINT32      numRegions;
+
+    // Earliest of the access counts above at which something happens
+    COUNTER     nextEvent;
+
+    // LookupAndFillCache implementation picked for this geometry and policy
+    typedef bool (CRC_CACHE::*ENGINE_FUNC)( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType );
+    ENGINE_FUNC engine;
     
   public:
 
     CRC_CACHE( UINT32 _cacheSize, UINT32 _assoc, UINT32 _tpc, UINT32 _linesize=64, UINT32 _pol=CRC_REPL_LRU );
+    ~CRC_CACHE();
+
+    // Record every LookupAndFillCache call to an LLC stream for offline replay
+    bool   EnableCapture( const char *filename );
+    void   DisableCapture();
+
+    // Warm-up snapshots (crc_checkpoint.h) of the tag store and replacement
+    // state; statistics are not part of them. A checkpoint restores into a
+    // cache of the same geometry and set sampling under any policy.
+    bool   SaveCheckpoint( const char *filename );
+    bool   LoadCheckpoint( const char *filename );
+    void   CheckpointAt( const char *filename, COUNTER accesses );
+
+    // LookupAndFillCache calls so far, including those of a restored checkpoint
+    COUNTER Accesses() { return mytimer; }
+
+    // Warm-up (CRC_WARMUP): up to access 'accesses' tags and replacement
+    // state are updated but nothing is counted. Regions (CRC_REGION): the
+    // statistics after warm-up are kept per 'accesses' long region and
+    // printed one block each.
+    void   SetWarmup( COUNTER accesses );
+    void   SetRegionLength( COUNTER accesses );
+    bool   WarmingUp() { return warming; }
+
+    // Zeroes the counters of the current region; EndRegion keeps them as a
+    // block of their own and starts a new region
+    void   ResetStats();
+    void   EndRegion();
+
+    // Seed of the replacement policy's random generator (see CRC_SEED)
+    void   SeedRandom( UINT64 seed ) { cacheReplState->SeedRandom( seed ); }
+
+    // Sharded replay (llc_shard.h): set routing, shared predictor state and
+    // folding the shards' statistics together
+    UINT32 SetIndexOf( Addr_t paddr ) { return GetSetIndex( paddr ); }
+    CACHE_REPLACEMENT_STATE *ReplacementState() { return cacheReplState; }
+    void   AddStats( const CRC_CACHE *other );
 
     bool   CacheInspect( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType );
+
+    // With set sampling an access to a set outside the sample is not
+    // simulated: it returns false, which the CMP$im front end charges as a
+    // miss, and it is neither counted in the statistics nor captured. It
+    // still counts as a call in Accesses(), which warm-up, regions and
+    // checkpoints are measured in. Simulates() tells the two apart.
     bool   LookupAndFillCache( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType );
+    bool   Simulates( Addr_t paddr ) { return (sampleMap == NULL) || (sampleMap[ GetSetIndex( paddr ) ] >= 0); }
     ostream &   PrintStats(ostream &out);
 
+    // LookupAndFillCache for 'count' accesses in order, e.g. a block of an
+    // LLC stream. The tag store and replacement state of the sets
+    // CRC_BATCH_PREFETCH accesses ahead are prefetched meanwhile, which hides
+    // host cache misses on large caches. 'hit' may be NULL.
+    void   LookupAndFillCacheBatch( const LLC_ACCESS *accesses, UINT32 count, bool *hit = NULL );
+
   private:
 
     Addr_t GetTag( Addr_t addr ) { return ((addr >> lineShift) >> indexShift); }
     UINT32 GetSetIndex( Addr_t addr ) { return ((addr >> lineShift) & indexMask); }
 
+    void   InitSampling();
     void   InitCache();
     void   InitCacheReplacementState();
 
     void   InitStats();
+    void   AllocateStats( CRC_CACHE_REGION *region );
+    void   FreeStats( CRC_CACHE_REGION *region );
+    double SampledMissRateError( const CRC_CACHE_REGION &region, UINT32 firstType, UINT32 lastType, UINT32 firstTid, UINT32 lastTid );
+    void   PrintRegionStats( ostream &out, const CRC_CACHE_REGION &region );
+
+    // Warm-up end, region boundaries and checkpoints, at nextEvent
+    void   AccessEvents();
+    void   ScheduleEvents();
 
     INT32  LookupSet( UINT32 setIndex, Addr_t tag );
     INT32  GetVictimInSet( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t paddr, UINT32 accessType );
 
+    // Cache engine specialized at compile time. Template arguments equal to
+    // CRC_GEOM_DYNAMIC / CRC_REPL_DYNAMIC fall back to the run time values.
+    void   SelectEngine();
+
+    template <UINT32 ASSOC, UINT32 LINE_SHIFT, UINT32 INDEX_SHIFT, UINT32 POL, bool STATS>
+    bool   LookupAndFillCacheT( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType );
+
+    template <UINT32 ASSOC>
+    INT32  LookupSetT( UINT32 setIndex, Addr_t tag );
+
+    template <UINT32 ASSOC, UINT32 POL>
+    INT32  GetVictimInSetT( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t paddr, UINT32 accessType );
+
+    void   PrefetchSet( const LLC_ACCESS &access );
+
+    void   GetLineState( UINT32 setIndex, UINT32 way, LINE_STATE *line )
+    {
+        UINT32 index = setIndex * tagStride + way;
+
+        line->valid       = (validMask[ setIndex ] >> way) & 1;
+        line->tag         = tags[ index ];
+        line->dirty       = (dirtyMask[ setIndex ] >> way) & 1;
+        line->sharing_dir = sharingDir[ index ];
+    }
+
   public:
 
     // Statistics related functions
     COUNTER ThreadDemandLookupStats( UINT32 tid )
     {
         COUNTER stat = 0;
-        for(UINT32 a=0; a<=ACCESS_STORE; a++) stat  += lookups[a][tid];
+        for(UINT32 a=0; a<=ACCESS_STORE; a++) stat  += stats.lookups[a][tid];
         return stat;
     }
 
     COUNTER ThreadDemandMissStats( UINT32 tid )
     {
         COUNTER stat = 0;
-        for(UINT32 a=0; a<=ACCESS_STORE; a++) stat  += misses[a][tid];
+        for(UINT32 a=0; a<=ACCESS_STORE; a++) stat  += stats.misses[a][tid];
         return stat;
     }
     
     COUNTER ThreadDemandHitStats( UINT32 tid )
     {
         COUNTER stat = 0;
-        for(UINT32 a=0; a<=ACCESS_STORE; a++) stat  += hits[a][tid];
+        for(UINT32 a=0; a<=ACCESS_STORE; a++) stat  += stats.hits[a][tid];
         return stat;
     }
 
@@ -0,0 +1,191 @@
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "crc_checkpoint.h"
+
+typedef struct
+{
+    unsigned long long  magic;
+    UINT32              version;
+    UINT32              sections;
+    UINT8               pad[ CRC_CHECKPOINT_ALIGN - 16 ];
+} CRC_CHECKPOINT_HEADER;
+
+typedef struct
+{
+    UINT32              id;
+    UINT32              reserved;
+    unsigned long long  bytes;
+} CRC_CHECKPOINT_SECTION_HEADER;
+
+// Section headers sit in the last 16 bytes of a 64-byte slot, right before
+// the aligned payload
+#define CRC_CHECKPOINT_SECTION_SLOT     CRC_CHECKPOINT_ALIGN
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Writer. Each section takes a 64-byte slot holding its header (at the       //
+// end of the slot) followed by the payload padded to 64 bytes.               //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool CRC_CHECKPOINT_WRITER::Open( const char *filename )
+{
+    Close();
+
+    file = fopen( filename, "wb" );
+    if( file == NULL )
+    {
+        cerr << "CRC_CHECKPOINT_WRITER: cannot create " << filename << endl;
+        return false;
+    }
+
+    CRC_CHECKPOINT_HEADER header;
+
+    memset( &header, 0, sizeof(header) );
+    header.magic   = CRC_CHECKPOINT_MAGIC;
+    header.version = CRC_CHECKPOINT_VERSION;
+
+    sections = 0;
+    failed   = (fwrite( &header, sizeof(header), 1, file ) != 1);
+
+    return !failed;
+}
+
+void CRC_CHECKPOINT_WRITER::Section( UINT32 id, const void *data, size_t bytes, const void *extra, size_t extraBytes )
+{
+    static const UINT8 zeros[ CRC_CHECKPOINT_ALIGN ] = { 0 };
+
+    if( file == NULL ) return;
+
+    UINT8                         slot[ CRC_CHECKPOINT_SECTION_SLOT ];
+    CRC_CHECKPOINT_SECTION_HEADER header;
+    size_t                        total = bytes + extraBytes;
+
+    memset( slot, 0, sizeof(slot) );
+    header.id       = id;
+    header.reserved = 0;
+    header.bytes    = total;
+    memcpy( slot + sizeof(slot) - sizeof(header), &header, sizeof(header) );
+
+    failed |= (fwrite( slot, sizeof(slot), 1, file ) != 1);
+    failed |= (bytes != 0 && fwrite( data, bytes, 1, file ) != 1);
+    failed |= (extraBytes != 0 && fwrite( extra, extraBytes, 1, file ) != 1);
+
+    size_t pad = (CRC_CHECKPOINT_ALIGN - total % CRC_CHECKPOINT_ALIGN) % CRC_CHECKPOINT_ALIGN;
+    failed |= (pad != 0 && fwrite( zeros, pad, 1, file ) != 1);
+
+    sections++;
+}
+
+bool CRC_CHECKPOINT_WRITER::Close()
+{
+    if( file == NULL ) return !failed;
+
+    // The section count goes into the header last
+    failed |= (fseek( file, offsetof( CRC_CHECKPOINT_HEADER, sections ), SEEK_SET ) != 0);
+    failed |= (fwrite( &sections, sizeof(sections), 1, file ) != 1);
+    failed |= (fclose( file ) != 0);
+
+    file = NULL;
+
+    return !failed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Reader. The file is mapped read-only; Find() walks the section slots.      //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool CRC_CHECKPOINT_READER::Open( const char *filename )
+{
+    Close();
+
+    int fd = open( filename, O_RDONLY );
+    if( fd < 0 )
+    {
+        cerr << "CRC_CHECKPOINT_READER: cannot open " << filename << endl;
+        return false;
+    }
+
+    struct stat st;
+    void        *map = MAP_FAILED;
+
+    if( fstat( fd, &st ) == 0 && (size_t) st.st_size >= sizeof(CRC_CHECKPOINT_HEADER) )
+    {
+        map = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    }
+    close( fd );
+
+    if( map == MAP_FAILED )
+    {
+        cerr << "CRC_CHECKPOINT_READER: " << filename << " is not a checkpoint" << endl;
+        return false;
+    }
+
+    base = (const UINT8 *) map;
+    size = st.st_size;
+
+    const CRC_CHECKPOINT_HEADER *header = (const CRC_CHECKPOINT_HEADER *) base;
+
+    if( header->magic != CRC_CHECKPOINT_MAGIC || header->version != CRC_CHECKPOINT_VERSION )
+    {
+        cerr << "CRC_CHECKPOINT_READER: " << filename << " is not a version " << CRC_CHECKPOINT_VERSION << " checkpoint" << endl;
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void CRC_CHECKPOINT_READER::Close()
+{
+    if( base != NULL )
+    {
+        munmap( (void *) base, size );
+        base = NULL;
+        size = 0;
+    }
+}
+
+const void *CRC_CHECKPOINT_READER::Find( UINT32 id, size_t *bytes )
+{
+    if( base == NULL ) return NULL;
+
+    const CRC_CHECKPOINT_HEADER *header = (const CRC_CHECKPOINT_HEADER *) base;
+    size_t                       offset = sizeof(CRC_CHECKPOINT_HEADER);
+
+    for(UINT32 s=0; s<header->sections && offset + CRC_CHECKPOINT_SECTION_SLOT <= size; s++)
+    {
+        CRC_CHECKPOINT_SECTION_HEADER section;
+
+        memcpy( &section, base + offset + CRC_CHECKPOINT_SECTION_SLOT - sizeof(section), sizeof(section) );
+        offset += CRC_CHECKPOINT_SECTION_SLOT;
+
+        if( section.bytes > size - offset ) break;      // truncated file
+
+        if( section.id == id )
+        {
+            *bytes = section.bytes;
+            return base + offset;
+        }
+
+        offset += (section.bytes + CRC_CHECKPOINT_ALIGN - 1) & ~((size_t) CRC_CHECKPOINT_ALIGN - 1);
+    }
+
+    return NULL;
+}
+
+bool CRC_CHECKPOINT_READER::Read( UINT32 id, void *data, size_t bytes )
+{
+    size_t      found   = 0;
+    const void *payload = Find( id, &found );
+
+    if( payload == NULL || found != bytes ) return false;
+
+    memcpy( data, payload, bytes );
+
+    return true;
+}
@@ -0,0 +1,148 @@
+#ifndef CRC_CHECKPOINT_H
+#define CRC_CHECKPOINT_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Versioned binary checkpoints of the cache and replacement state, e.g.      //
+// a warmed-up LLC that several runs start from.                              //
+//                                                                            //
+// A checkpoint is a header followed by tagged sections. Every section        //
+// payload starts on a 64-byte boundary of the file, so once the file is      //
+// memory-mapped each array can be used or copied in place. Sections are      //
+// self-describing: a reader takes the ones it knows and needs, skips the     //
+// others, and a policy restoring a checkpoint written under another          //
+// policy picks up only the state the two have in common.                     //
+//                                                                            //
+// All fields are little endian:                                              //
+//                                                                            //
+//   header   64 bytes: magic "CRCCKPT" (UINT64), version (UINT32), section   //
+//            count (UINT32), zeros                                           //
+//   section  64-byte slot: 48 zero bytes, then id (UINT32), reserved         //
+//            (UINT32, 0) and payload size in bytes (UINT64)                  //
+//            payload, zero padded to a multiple of 64 bytes                  //
+//                                                                            //
+// The section header sits at the end of its slot, right before the payload,  //
+// which keeps the payload aligned. The next slot follows the padding.        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include "utils.h"
+
+#define CRC_CHECKPOINT_MAGIC        0x54504b43435243ULL     // "CRCCKPT"
+#define CRC_CHECKPOINT_VERSION      2
+#define CRC_CHECKPOINT_ALIGN        64
+
+// Section ids; new ones are only ever appended
+typedef enum
+{
+    CKPT_CACHE_GEOMETRY          = 1,   // CRC_CHECKPOINT_GEOMETRY
+    CKPT_CACHE_SAMPLE_MAP        = 2,   // INT32 per set, set sampling only
+    CKPT_CACHE_TAGS              = 3,   // Addr_t per line, tagStride per set
+    CKPT_CACHE_VALID             = 4,   // BITVECTOR per set
+    CKPT_CACHE_DIRTY             = 5,   // BITVECTOR per set
+    CKPT_CACHE_SHARING           = 6,   // BITVECTOR per line
+    CKPT_CACHE_TIMER             = 7,   // COUNTER, LookupAndFillCache calls
+
+    CKPT_REPL_TIMER              = 16,  // COUNTER
+    CKPT_REPL_RANDOM             = 17,  // UINT64 generator state
+    CKPT_REPL_LRU_ORDER          = 18,  // UINT8 per line, ways from MRU to LRU
+    CKPT_REPL_RRPV               = 19,  // UINT8 per line
+    CKPT_REPL_SHIP               = 20,  // UINT16 per line, SHiP signature/outcome
+    CKPT_REPL_DUELING            = 21,  // CRC_CHECKPOINT_DUELING + UINT8 per set
+    CKPT_REPL_SHCT               = 22,  // UINT8 per signature
+    CKPT_REPL_EAF                = 23,  // CRC_CHECKPOINT_BLOOM + bit array
+    CKPT_REPL_HAWKEYE            = 24,  // UINT8 per signature, then UINT16 signature per line
+    CKPT_REPL_PERCEPTRON         = 25,  // INT32 per perceptron weight
+    CKPT_REPL_SDBP               = 26,  // UINT8 per SDBP counter, then BITVECTOR of dead ways per set
+    CKPT_REPL_OPTGEN             = 27,  // CRC_CHECKPOINT_OPTGEN per sampled set, then UINT8 per quantum
+    CKPT_REPL_OPTGEN_SAMPLER     = 28,  // Addr_t tag, then CRC_OPTGEN_ENTRY per quantum
+    CKPT_REPL_PERCEPTRON_SAMPLER = 29,  // Addr_t line, then CRC_PERCEPTRON_ENTRY per sampler way
+    CKPT_REPL_PERCEPTRON_HISTORY = 30,  // Addr_t, 3 PCs per PC history
+    CKPT_REPL_SDBP_SAMPLER       = 31   // Addr_t line, then CRC_SDBP_ENTRY per sampler way
+} CRC_CHECKPOINT_SECTION;
+
+typedef struct
+{
+    UINT32  numsets;
+    UINT32  storedSets;
+    UINT32  assoc;
+    UINT32  threads;
+    UINT32  linesize;
+    UINT32  replPolicy;
+    UINT32  sampleEvery;
+    UINT32  sampleRandom;
+} CRC_CHECKPOINT_GEOMETRY;
+
+typedef struct
+{
+    UINT32  replPolicy;              // leader sets mean different things per policy
+    UINT32  PSEL;
+    UINT32  leaderSets;
+    UINT32  numsets;
+} CRC_CHECKPOINT_DUELING;
+
+typedef struct
+{
+    COUNTER now;                     // quanta so far
+    UINT32  next;                    // sampler slot to fill next
+    UINT32  history;                 // quanta per set
+} CRC_CHECKPOINT_OPTGEN;
+
+typedef struct
+{
+    UINT32  capacity;
+    UINT32  indexBits;
+    UINT32  hashes;
+    UINT32  inserted;
+    COUNTER insertedTotal;
+    COUNTER insertedSynced;
+} CRC_CHECKPOINT_BLOOM;
+
+class CRC_CHECKPOINT_WRITER
+{
+  private:
+
+    FILE        *file;
+    UINT32      sections;
+    bool        failed;
+
+  public:
+
+    CRC_CHECKPOINT_WRITER() { file = NULL; sections = 0; failed = false; }
+    ~CRC_CHECKPOINT_WRITER() { Close(); }
+
+    bool   Open( const char *filename );
+
+    // A section from one or two pieces, e.g. a small header and an array
+    void   Section( UINT32 id, const void *data, size_t bytes, const void *extra = NULL, size_t extraBytes = 0 );
+
+    // Writes the section count; false if anything failed
+    bool   Close();
+};
+
+class CRC_CHECKPOINT_READER
+{
+  private:
+
+    const UINT8 *base;
+    size_t      size;
+
+  public:
+
+    CRC_CHECKPOINT_READER() { base = NULL; size = 0; }
+    ~CRC_CHECKPOINT_READER() { Close(); }
+
+    // Maps the file and checks magic and version
+    bool   Open( const char *filename );
+    void   Close();
+
+    // Payload of section 'id' (64-byte aligned) and its size, or NULL
+    const void *Find( UINT32 id, size_t *bytes );
+
+    // Copies section 'id' if its size is exactly 'bytes'
+    bool   Read( UINT32 id, void *data, size_t bytes );
+};
+
+#endif
@@ -0,0 +1,270 @@
+#ifndef CRC_LRU_H
+#define CRC_LRU_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// True LRU order of every set, for the LRU and D-EAF policies. Touch()       //
+// makes a way the most recently used and Victim() returns the least          //
+// recently used way. The order is kept in one of four encodings:             //
+//                                                                            //
+//   LRU_IMPL_STACK        stack position per line, as in the original kit.   //
+//                         Touch and Victim walk all the ways.                //
+//   LRU_IMPL_PERMUTATION  ways in age order, one nibble each, in a 64-bit    //
+//                         word per set. Up to 16 ways; O(1) Touch/Victim.    //
+//   LRU_IMPL_MATRIX       bit matrix: row w has bit j set if way w was used  //
+//                         after way j. Up to 64 ways; branch free.           //
+//   LRU_IMPL_TIMESTAMP    last access time per line, taken from the          //
+//                         replacement state's mytimer. Victim is a SIMD min. //
+//                                                                            //
+// LRU_IMPL_AUTO uses the permutation for up to 16 ways and timestamps        //
+// above that. All encodings start from the same order (way 0 most recent)    //
+// and give identical victims.                                                //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include "utils.h"
+#include "crc_simd.h"
+
+#define LRU_IMPL_AUTO           0
+#define LRU_IMPL_STACK          1
+#define LRU_IMPL_PERMUTATION    2
+#define LRU_IMPL_MATRIX         3
+#define LRU_IMPL_TIMESTAMP      4
+#ifndef LRU_IMPL
+#define LRU_IMPL                LRU_IMPL_AUTO
+#endif
+
+class CRC_LRU
+{
+  private:
+
+    UINT32              numsets;
+    UINT32              assoc;
+    UINT32              stride;      // ways per set in 'state', rounded up to 4
+    UINT32              encoding;
+
+    // Stack positions, matrix rows or timestamps, 'stride' entries per set
+    unsigned long long  *state;
+    // One permutation word per set
+    unsigned long long  *perm;
+
+  public:
+
+    CRC_LRU()
+    {
+        numsets = assoc = stride = 0;
+        state   = NULL;
+        perm    = NULL;
+    }
+
+    ~CRC_LRU()
+    {
+        free( state );
+        delete [] perm;
+    }
+
+    void Init( UINT32 _sets, UINT32 _assoc )
+    {
+        numsets  = _sets;
+        assoc    = _assoc;
+        stride   = (assoc + 3) & ~3;
+        encoding = LRU_IMPL;
+
+        if( encoding == LRU_IMPL_AUTO )
+        {
+            encoding = (assoc <= 16) ? LRU_IMPL_PERMUTATION : LRU_IMPL_TIMESTAMP;
+        }
+
+        assert( assoc <= 64 );
+        assert( encoding != LRU_IMPL_PERMUTATION || assoc <= 16 );
+
+        if( encoding == LRU_IMPL_PERMUTATION )
+        {
+            // Nibble k holds the k-th most recent way; unused nibbles hold
+            // 0xf, which is never a way number when assoc < 16
+            unsigned long long initial = ~0ULL;
+
+            for(UINT32 way=0; way<assoc; way++)
+            {
+                initial &= ~(0xfULL << (4 * way));
+                initial |= (unsigned long long) way << (4 * way);
+            }
+
+            perm = new unsigned long long[ numsets ];
+            for(UINT32 setIndex=0; setIndex<numsets; setIndex++) perm[ setIndex ] = initial;
+
+            return;
+        }
+
+        size_t bytes = (size_t) numsets * stride * sizeof(unsigned long long);
+        if( posix_memalign( (void **) &state, 64, bytes ) != 0 )
+        {
+            cout << "CRC_LRU: cannot allocate " << bytes << " bytes" << endl;
+            exit( 1 );
+        }
+
+        for(UINT32 setIndex=0; setIndex<numsets; setIndex++)
+        {
+            unsigned long long *set = &state[ (size_t) setIndex * stride ];
+
+            for(UINT32 way=0; way<stride; way++)
+            {
+                if( encoding == LRU_IMPL_STACK )
+                    set[ way ] = way;
+                else if( encoding == LRU_IMPL_MATRIX )
+                    set[ way ] = (way < assoc) ? (WayMask() & ~((2ULL << way) - 1)) : 0;
+                else
+                    // Padding ways never win the min
+                    set[ way ] = (way < assoc) ? (assoc - 1 - way) : (~0ULL >> 1);
+            }
+        }
+    }
+
+    // 'now' is the replacement state's timer, used by LRU_IMPL_TIMESTAMP
+    void Touch( UINT32 setIndex, UINT32 way, COUNTER now )
+    {
+        if( encoding == LRU_IMPL_PERMUTATION )
+        {
+            unsigned long long p = perm[ setIndex ];
+
+            // Find the nibble holding 'way': the lowest zero nibble of p^key
+            unsigned long long x    = p ^ (way * 0x1111111111111111ULL);
+            unsigned long long zero = (x - 0x1111111111111111ULL) & ~x & 0x8888888888888888ULL;
+            UINT32             pos  = CRC_Ctz( zero ) & ~3;
+
+            // Shift the more recent ways down one slot and put 'way' on top
+            unsigned long long newer = p & ((1ULL << pos) - 1);
+            unsigned long long older = (pos >= 60) ? 0 : (p & (~0ULL << (pos + 4)));
+
+            perm[ setIndex ] = older | (newer << 4) | way;
+            return;
+        }
+
+        unsigned long long *set = &state[ (size_t) setIndex * stride ];
+
+        if( encoding == LRU_IMPL_STACK )
+        {
+            unsigned long long position = set[ way ];
+
+            for(UINT32 w=0; w<assoc; w++)
+            {
+                if( set[w] < position ) set[w]++;
+            }
+            set[ way ] = 0;
+        }
+        else if( encoding == LRU_IMPL_MATRIX )
+        {
+            unsigned long long column = ~(1ULL << way);
+
+            for(UINT32 w=0; w<stride; w++) set[w] &= column;
+            set[ way ] = WayMask() & column;
+        }
+        else
+        {
+            // Offset by assoc so every touch is newer than the initial order
+            set[ way ] = now + assoc;
+        }
+    }
+
+    UINT32 Victim( UINT32 setIndex )
+    {
+        if( encoding == LRU_IMPL_PERMUTATION )
+        {
+            return (UINT32) (perm[ setIndex ] >> (4 * (assoc - 1))) & 0xf;
+        }
+
+        unsigned long long *set = &state[ (size_t) setIndex * stride ];
+
+        if( encoding == LRU_IMPL_STACK )
+        {
+            for(UINT32 w=0; w<assoc; w++)
+            {
+                if( set[w] == assoc - 1 ) return w;
+            }
+            return 0;
+        }
+        else if( encoding == LRU_IMPL_MATRIX )
+        {
+            // The LRU way is the one used after no other way
+            return CRC_Ctz( CRC_MatchTags( set, stride, 0 ) & WayMask() );
+        }
+
+        return CRC_MinIndex( set, stride );
+    }
+
+    // Pulls the order of a set into the host cache ahead of its use
+    void Prefetch( UINT32 setIndex )
+    {
+        if( encoding == LRU_IMPL_PERMUTATION )
+            CRC_Prefetch( &perm[ setIndex ] );
+        else
+            CRC_Prefetch( &state[ (size_t) setIndex * stride ] );
+    }
+
+    // Checkpoints: the order of a set as ways from MRU to LRU, the same
+    // whatever the encoding. SetOrder takes the replacement state's timer.
+    void GetOrder( UINT32 setIndex, UINT8 *order )
+    {
+        if( encoding == LRU_IMPL_PERMUTATION )
+        {
+            for(UINT32 k=0; k<assoc; k++)
+            {
+                order[k] = (UINT8) ((perm[ setIndex ] >> (4 * k)) & 0xf);
+            }
+            return;
+        }
+
+        unsigned long long *set = &state[ (size_t) setIndex * stride ];
+
+        for(UINT32 way=0; way<assoc; way++)
+        {
+            UINT32 position;
+
+            if( encoding == LRU_IMPL_STACK )
+            {
+                position = (UINT32) set[ way ];
+            }
+            else if( encoding == LRU_IMPL_MATRIX )
+            {
+                position = assoc - 1 - CRC_Popcount( set[ way ] );
+            }
+            else
+            {
+                position = 0;
+                for(UINT32 w=0; w<assoc; w++) position += (set[w] > set[ way ]);
+            }
+
+            order[ position ] = (UINT8) way;
+        }
+    }
+
+    void SetOrder( UINT32 setIndex, const UINT8 *order, COUNTER now )
+    {
+        if( encoding == LRU_IMPL_TIMESTAMP )
+        {
+            // As if the ways had been touched up to 'now', MRU last
+            unsigned long long *set = &state[ (size_t) setIndex * stride ];
+
+            for(UINT32 k=0; k<assoc; k++) set[ order[k] ] = now + assoc - k;
+            return;
+        }
+
+        for(UINT32 k=assoc; k>0; k--)
+        {
+            Touch( setIndex, order[ k - 1 ], now );
+        }
+    }
+
+  private:
+
+    unsigned long long WayMask()
+    {
+        return (assoc == 64) ? ~0ULL : ((1ULL << assoc) - 1);
+    }
+};
+
+#endif
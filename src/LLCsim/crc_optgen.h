@@ -0,0 +1,256 @@
+#ifndef CRC_OPTGEN_H
+#define CRC_OPTGEN_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// OPTgen (Jain & Lin, ISCA 2016): what Belady's OPT would have done on a     //
+// few sampled sets, computed online. For each sampled set:                   //
+//                                                                            //
+//   occupancy  one counter per time quantum (an access to the set) over      //
+//              the last 'history' quanta: the lines OPT keeps cached         //
+//              across that quantum. A circular buffer.                       //
+//   sampler    the lines accessed within the history, with the time and      //
+//              signature of their last access. A circular buffer too: a      //
+//              new line takes the oldest slot.                               //
+//                                                                            //
+// A line reused at time t after its last access at p would have hit under    //
+// OPT if every quantum in [p, t) has a free way (occupancy < assoc); the     //
+// line then occupies those quanta. The access at p is what gets trained:     //
+// its signature was cache friendly if OPT hit, averse if it missed, was      //
+// reused too late or left the sampler without being reused.                  //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstring>
+#include "utils.h"
+#include "crc_simd.h"
+#include "crc_checkpoint.h"
+
+#define OPTGEN_HISTORY_WAYS     8            // history = 8 x assoc quanta, as in the paper
+#define OPTGEN_NO_TAG           (~(Addr_t) 0)
+
+// A sampler entry; its tag is kept apart so the lookup can match tags
+// with SIMD compares
+typedef struct
+{
+    COUNTER time;          // last access, in quanta of the set
+    UINT32  signature;     // of the last access
+} CRC_OPTGEN_ENTRY;
+
+// Training an access produces: the outcome of the previous access to the
+// line, and the signature of a line the sampler had to let go
+typedef struct
+{
+    bool    reused;
+    bool    optHit;
+    UINT32  reuseSignature;
+    bool    evicted;
+    UINT32  evictedSignature;
+} CRC_OPTGEN_RESULT;
+
+class CRC_OPTGEN
+{
+  private:
+
+    UINT32              numsets;
+    UINT32              assoc;
+    UINT32              history;
+
+    UINT8               *occupancy;  // history counters per set
+    COUNTER             *now;        // quanta so far, per set
+    Addr_t              *tags;       // history sampler tags per set, OPTGEN_NO_TAG if free
+    CRC_OPTGEN_ENTRY    *entries;    // history entries per set
+    UINT32              *next;       // sampler slot to fill next, per set
+
+  public:
+
+    COUNTER             accesses;    // to the sampled sets
+    COUNTER             optHits;
+
+    CRC_OPTGEN()
+    {
+        numsets   = assoc = history = 0;
+        occupancy = NULL;
+        now       = NULL;
+        tags      = NULL;
+        entries   = NULL;
+        next      = NULL;
+        accesses  = optHits = 0;
+    }
+
+    ~CRC_OPTGEN()
+    {
+        delete [] occupancy;
+        delete [] now;
+        free( tags );
+        delete [] entries;
+        delete [] next;
+    }
+
+    void Init( UINT32 _sets, UINT32 _assoc )
+    {
+        numsets   = _sets;
+        assoc     = _assoc;
+        history   = OPTGEN_HISTORY_WAYS * assoc;
+
+        occupancy = new UINT8[ (size_t) numsets * history ];
+        now       = new COUNTER[ numsets ];
+        entries   = new CRC_OPTGEN_ENTRY[ (size_t) numsets * history ];
+        next      = new UINT32[ numsets ];
+
+        // history is a multiple of 8, as CRC_MatchTags needs
+        if( posix_memalign( (void **) &tags, 32, (size_t) numsets * history * sizeof(Addr_t) ) != 0 )
+        {
+            cout << "CRC_OPTGEN: cannot allocate the sampler" << endl;
+            exit( 1 );
+        }
+
+        memset( occupancy, 0, (size_t) numsets * history );
+        memset( entries, 0, (size_t) numsets * history * sizeof(CRC_OPTGEN_ENTRY) );
+        for(size_t i=0; i<(size_t) numsets * history; i++) tags[i] = OPTGEN_NO_TAG;
+
+        for(UINT32 s=0; s<numsets; s++)
+        {
+            now[s]  = 0;
+            next[s] = 0;
+        }
+    }
+
+    void Access( UINT32 set, Addr_t tag, UINT32 signature, CRC_OPTGEN_RESULT *result )
+    {
+        UINT8            *occ     = &occupancy[ (size_t) set * history ];
+        Addr_t           *tagSet  = &tags[ (size_t) set * history ];
+        CRC_OPTGEN_ENTRY *sampler = &entries[ (size_t) set * history ];
+        COUNTER          t        = now[set]++;
+        UINT32           slot     = (UINT32) (t % history);
+
+        accesses++;
+
+        result->reused  = false;
+        result->optHit  = false;
+        result->evicted = false;
+
+        // A new quantum starts empty
+        occ[ slot ] = 0;
+
+        CRC_OPTGEN_ENTRY *entry = NULL;
+
+        for(UINT32 i=0; i<history && entry == NULL; i+=64)
+        {
+            UINT32    n     = (history - i < 64) ? history - i : 64;
+            BITVECTOR match = CRC_MatchTags( &tagSet[i], n, tag );
+
+            if( match != 0 ) entry = &sampler[ i + CRC_Ctz( match ) ];
+        }
+
+        if( entry != NULL )
+        {
+            result->reused         = true;
+            result->reuseSignature = entry->signature;
+
+            // Within the history, OPT hits if the line fits in every quantum;
+            // the quanta run from the one of the last access up to this one
+            COUNTER span = t - entry->time;
+
+            if( span < history )
+            {
+                UINT32 first = (slot >= span) ? slot - (UINT32) span : slot + history - (UINT32) span;
+                UINT32 q     = first;
+                bool   fits  = true;
+
+                for(; q != slot && fits; q = (q + 1 == history) ? 0 : q + 1)
+                {
+                    fits = (occ[q] < assoc);
+                }
+
+                if( fits )
+                {
+                    for(q = first; q != slot; q = (q + 1 == history) ? 0 : q + 1)
+                    {
+                        occ[q]++;
+                    }
+                }
+
+                result->optHit = fits;
+            }
+
+            if( result->optHit ) optHits++;
+        }
+        else
+        {
+            UINT32 victim = next[set];
+
+            entry = &sampler[ victim ];
+            next[set] = (victim + 1 == history) ? 0 : victim + 1;
+
+            if( tagSet[ victim ] != OPTGEN_NO_TAG )
+            {
+                result->evicted          = true;
+                result->evictedSignature = entry->signature;
+            }
+
+            tagSet[ victim ] = tag;
+        }
+
+        entry->time      = t;
+        entry->signature = signature;
+    }
+
+    // Everything but the statistics: the clock, next slot and occupancy
+    // vector of every set, then the sampler
+    void Save( CRC_CHECKPOINT_WRITER &writer, UINT32 id, UINT32 samplerId )
+    {
+        size_t                quanta = (size_t) numsets * history;
+        CRC_CHECKPOINT_OPTGEN *sets  = new CRC_CHECKPOINT_OPTGEN[ numsets ];
+
+        memset( sets, 0, numsets * sizeof(CRC_CHECKPOINT_OPTGEN) );
+        for(UINT32 s=0; s<numsets; s++)
+        {
+            sets[s].now     = now[s];
+            sets[s].next    = next[s];
+            sets[s].history = history;
+        }
+
+        writer.Section( id, sets, numsets * sizeof(CRC_CHECKPOINT_OPTGEN), occupancy, quanta );
+        writer.Section( samplerId, tags, quanta * sizeof(Addr_t), entries, quanta * sizeof(CRC_OPTGEN_ENTRY) );
+
+        delete [] sets;
+    }
+
+    // False, leaving OPTgen as it was, unless the checkpoint has both
+    // sections for as many sets and quanta
+    bool Load( CRC_CHECKPOINT_READER &reader, UINT32 id, UINT32 samplerId )
+    {
+        size_t      quanta       = (size_t) numsets * history;
+        size_t      bytes        = 0;
+        size_t      samplerBytes = 0;
+        const UINT8 *stored      = (const UINT8 *) reader.Find( id, &bytes );
+        const UINT8 *sampler     = (const UINT8 *) reader.Find( samplerId, &samplerBytes );
+
+        if( stored == NULL || bytes != numsets * sizeof(CRC_CHECKPOINT_OPTGEN) + quanta ) return false;
+        if( sampler == NULL || samplerBytes != quanta * (sizeof(Addr_t) + sizeof(CRC_OPTGEN_ENTRY)) ) return false;
+
+        const CRC_CHECKPOINT_OPTGEN *sets = (const CRC_CHECKPOINT_OPTGEN *) stored;
+
+        for(UINT32 s=0; s<numsets; s++)
+        {
+            if( sets[s].history != history || sets[s].next >= history ) return false;
+        }
+
+        for(UINT32 s=0; s<numsets; s++)
+        {
+            now[s]  = sets[s].now;
+            next[s] = sets[s].next;
+        }
+
+        memcpy( occupancy, stored + numsets * sizeof(CRC_CHECKPOINT_OPTGEN), quanta );
+        memcpy( tags, sampler, quanta * sizeof(Addr_t) );
+        memcpy( entries, sampler + quanta * sizeof(Addr_t), quanta * sizeof(CRC_OPTGEN_ENTRY) );
+
+        return true;
+    }
+};
+
+#endif
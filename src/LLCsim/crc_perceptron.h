@@ -0,0 +1,299 @@
+#ifndef CRC_PERCEPTRON_H
+#define CRC_PERCEPTRON_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Multiperspective reuse predictor (after Jimenez & Teran, MICRO 2017).      //
+// Every access is described by PERCEPTRON_FEATURES features, each hashed     //
+// into its own table of small saturating weights:                            //
+//                                                                            //
+//   0  PC                          4  PC of the previous access (per thread) //
+//   1  PC ^ 4KB region of the line 5  PC and the last 3 PCs of the thread    //
+//   2  PC ^ line within the region 6  PC ^ thread                            //
+//   3  thread and access type      7  bias                                   //
+//                                                                            //
+// The sum of the weights, yout, is the prediction: the larger, the more      //
+// likely the line is dead (not reused before it would be evicted). The       //
+// hashing and the sum are one SIMD kernel each (crc_simd.h).                 //
+//                                                                            //
+// Training uses a sampler: for a few sampled sets, the last 'assoc' lines    //
+// in LRU order with the feature indices and yout of their last access. A     //
+// sampler hit means that access was live, an LRU eviction that it was        //
+// dead. Weights are trained only if the prediction was wrong or not          //
+// confident (|yout| below PERCEPTRON_THETA), as perceptron predictors do.    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstring>
+#include "utils.h"
+#include "crc_cache_defs.h"
+#include "crc_simd.h"
+#include "crc_checkpoint.h"
+
+#define PERCEPTRON_FEATURES       8
+#define PERCEPTRON_TABLE_BITS     10           // weights per feature: 2^10
+#define PERCEPTRON_WEIGHTS        (PERCEPTRON_FEATURES << PERCEPTRON_TABLE_BITS)
+#define PERCEPTRON_WEIGHT_MAX     31           // 6-bit signed weights
+#define PERCEPTRON_WEIGHT_MIN     (-32)
+#define PERCEPTRON_THETA          32           // training threshold
+#define PERCEPTRON_SAMPLED_SETS   64
+#define PERCEPTRON_NOT_SAMPLED    0xff
+#define PERCEPTRON_THREADS        64           // PC histories; tids share them modulo
+#define PERCEPTRON_NO_LINE        (~(Addr_t) 0)
+
+// What the sampler keeps of the last access to a line; the line address
+// is kept apart so the lookup can match with SIMD compares
+typedef struct
+{
+    UINT32  index[ PERCEPTRON_FEATURES ];
+    INT32   yout;
+    UINT32  lru;          // 0 most recent
+} CRC_PERCEPTRON_ENTRY;
+
+class CRC_PERCEPTRON
+{
+  private:
+
+    INT32                   *weights;    // PERCEPTRON_WEIGHTS, table f at f << PERCEPTRON_TABLE_BITS
+    Addr_t                  history[ PERCEPTRON_THREADS ][ 3 ];   // last PCs, most recent first
+
+    UINT32                  numsets;
+    UINT32                  assoc;
+    UINT32                  stride;      // assoc rounded up to 4
+    UINT32                  sampledSets;
+    UINT8                   *slot;       // sampler set per set, PERCEPTRON_NOT_SAMPLED if none
+    Addr_t                  *lines;      // stride per sampled set, PERCEPTRON_NO_LINE if free
+    CRC_PERCEPTRON_ENTRY    *entries;
+
+  public:
+
+    COUNTER                 samplerAccesses;
+    COUNTER                 samplerHits;
+    COUNTER                 trainedLive;
+    COUNTER                 trainedDead;
+
+    CRC_PERCEPTRON( UINT32 _sets, UINT32 _assoc )
+    {
+        numsets     = _sets;
+        assoc       = _assoc;
+        stride      = (assoc + 3) & ~3;
+        sampledSets = (numsets < PERCEPTRON_SAMPLED_SETS) ? numsets : PERCEPTRON_SAMPLED_SETS;
+
+        samplerAccesses = samplerHits = trainedLive = trainedDead = 0;
+
+        if( posix_memalign( (void **) &weights, 32, PERCEPTRON_WEIGHTS * sizeof(INT32) ) != 0 ||
+            posix_memalign( (void **) &lines, 32, (size_t) sampledSets * stride * sizeof(Addr_t) ) != 0 )
+        {
+            cout << "CRC_PERCEPTRON: cannot allocate the predictor" << endl;
+            exit( 1 );
+        }
+
+        memset( weights, 0, PERCEPTRON_WEIGHTS * sizeof(INT32) );
+        memset( history, 0, sizeof(history) );
+
+        // Sampled sets are evenly spaced
+        slot = new UINT8[ numsets ];
+        memset( slot, PERCEPTRON_NOT_SAMPLED, numsets );
+        for(UINT32 s=0; s<sampledSets; s++) slot[ (size_t) s * numsets / sampledSets ] = s;
+
+        entries = new CRC_PERCEPTRON_ENTRY[ (size_t) sampledSets * stride ];
+        for(size_t e=0; e<(size_t) sampledSets * stride; e++)
+        {
+            lines[e] = PERCEPTRON_NO_LINE;
+            memset( &entries[e], 0, sizeof(CRC_PERCEPTRON_ENTRY) );
+            entries[e].lru = (UINT32) (e % stride);
+        }
+    }
+
+    ~CRC_PERCEPTRON()
+    {
+        free( weights );
+        free( lines );
+        delete [] slot;
+        delete [] entries;
+    }
+
+    // yout of an access to 'line', with the feature indices it used
+    INT32 Predict( UINT32 tid, Addr_t PC, Addr_t line, UINT32 accessType, UINT32 *index )
+    {
+        const Addr_t *past = history[ tid % PERCEPTRON_THREADS ];
+        Addr_t       key[ PERCEPTRON_FEATURES ];
+
+        key[0] = PC;
+        key[1] = PC ^ ((line >> 6) << 16);
+        key[2] = PC ^ ((line & 63) << 16);
+        key[3] = ((Addr_t) tid << 3) | accessType;
+        key[4] = past[0];
+        key[5] = PC ^ (past[0] << 1) ^ (past[1] << 2) ^ (past[2] << 3);
+        key[6] = PC ^ ((Addr_t) tid << 48);
+        key[7] = 0;
+
+        UINT32 folded[ PERCEPTRON_FEATURES ];
+        for(UINT32 f=0; f<PERCEPTRON_FEATURES; f++)
+        {
+            folded[f] = (UINT32) (key[f] ^ (key[f] >> 32));
+        }
+
+        CRC_HashIndex8( folded, PERCEPTRON_TABLE_BITS, index );
+
+        return CRC_GatherSum8( weights, index );
+    }
+
+    // Trains on the sampler outcome of an access to a sampled set; the
+    // access then takes the line's entry. Other sets are not sampled.
+    void Train( UINT32 setIndex, Addr_t line, const UINT32 *index, INT32 yout )
+    {
+        if( slot[ setIndex ] == PERCEPTRON_NOT_SAMPLED ) return;
+
+        Addr_t               *tags = &lines[ (size_t) slot[ setIndex ] * stride ];
+        CRC_PERCEPTRON_ENTRY *set  = &entries[ (size_t) slot[ setIndex ] * stride ];
+        BITVECTOR            match = CRC_MatchTags( tags, stride, line );
+        UINT32               way;
+
+        samplerAccesses++;
+
+        if( match != 0 )
+        {
+            way = CRC_Ctz( match );
+            samplerHits++;
+
+            // Reused while in the sampler: the last access was live
+            if( set[way].yout > -PERCEPTRON_THETA )
+            {
+                Adjust( set[way].index, -1 );
+                trainedLive++;
+            }
+        }
+        else
+        {
+            for(way=0; set[way].lru != assoc - 1; way++) ;
+
+            // Fell off the LRU end without reuse: the last access was dead
+            if( tags[way] != PERCEPTRON_NO_LINE && set[way].yout < PERCEPTRON_THETA )
+            {
+                Adjust( set[way].index, +1 );
+                trainedDead++;
+            }
+
+            tags[way] = line;
+        }
+
+        for(UINT32 w=0; w<assoc; w++)
+        {
+            set[w].lru += (set[w].lru < set[way].lru);
+        }
+
+        memcpy( set[way].index, index, sizeof(set[way].index) );
+        set[way].yout = yout;
+        set[way].lru  = 0;
+    }
+
+    // Moves 'PC' into the PC history of thread 'tid'
+    void Record( UINT32 tid, Addr_t PC )
+    {
+        Addr_t *past = history[ tid % PERCEPTRON_THREADS ];
+
+        past[2] = past[1];
+        past[1] = past[0];
+        past[0] = PC;
+    }
+
+    // Sharded replay: adds up the weight changes of every copy since the
+    // last call, saturating, and hands the result back to the copies
+    void Synchronize( CRC_PERCEPTRON **copies, UINT32 n )
+    {
+        for(UINT32 w=0; w<PERCEPTRON_WEIGHTS; w++)
+        {
+            INT32 weight = weights[w];
+
+            for(UINT32 c=0; c<n; c++) weight += copies[c]->weights[w] - weights[w];
+
+            weights[w] = Clamp( weight );
+
+            for(UINT32 c=0; c<n; c++) copies[c]->weights[w] = weights[w];
+        }
+    }
+
+    // The weights; SaveSampler() has the rest of the state
+    void Save( CRC_CHECKPOINT_WRITER &writer, UINT32 id )
+    {
+        writer.Section( id, weights, PERCEPTRON_WEIGHTS * sizeof(INT32) );
+    }
+
+    void SaveSampler( CRC_CHECKPOINT_WRITER &writer, UINT32 samplerId, UINT32 historyId )
+    {
+        size_t ways = (size_t) sampledSets * stride;
+
+        writer.Section( samplerId, lines, ways * sizeof(Addr_t), entries, ways * sizeof(CRC_PERCEPTRON_ENTRY) );
+        writer.Section( historyId, history, sizeof(history) );
+    }
+
+    bool Load( CRC_CHECKPOINT_READER &reader, UINT32 id )
+    {
+        if( !reader.Read( id, weights, PERCEPTRON_WEIGHTS * sizeof(INT32) ) ) return false;
+
+        for(UINT32 w=0; w<PERCEPTRON_WEIGHTS; w++) weights[w] = Clamp( weights[w] );
+
+        return true;
+    }
+
+    // False, leaving the sampler and histories as they were, unless the
+    // checkpoint has both for as many sampled ways, with every set in LRU
+    // order and every feature index in range
+    bool LoadSampler( CRC_CHECKPOINT_READER &reader, UINT32 samplerId, UINT32 historyId )
+    {
+        size_t      ways    = (size_t) sampledSets * stride;
+        size_t      bytes   = 0;
+        const UINT8 *stored = (const UINT8 *) reader.Find( samplerId, &bytes );
+        Addr_t      past[ PERCEPTRON_THREADS ][ 3 ];
+
+        if( stored == NULL || bytes != ways * (sizeof(Addr_t) + sizeof(CRC_PERCEPTRON_ENTRY)) ) return false;
+        if( !reader.Read( historyId, past, sizeof(past) ) ) return false;
+
+        const CRC_PERCEPTRON_ENTRY *sampler = (const CRC_PERCEPTRON_ENTRY *) (stored + ways * sizeof(Addr_t));
+
+        for(UINT32 s=0; s<sampledSets; s++)
+        {
+            BITVECTOR seen = 0;
+
+            for(UINT32 w=0; w<assoc; w++)
+            {
+                const CRC_PERCEPTRON_ENTRY &entry = sampler[ (size_t) s * stride + w ];
+
+                if( entry.lru >= assoc || (seen >> entry.lru) & 1 ) return false;
+                seen |= (BITVECTOR) 1 << entry.lru;
+
+                for(UINT32 f=0; f<PERCEPTRON_FEATURES; f++)
+                {
+                    if( entry.index[f] >= PERCEPTRON_WEIGHTS ) return false;
+                }
+            }
+        }
+
+        memcpy( lines, stored, ways * sizeof(Addr_t) );
+        memcpy( entries, sampler, ways * sizeof(CRC_PERCEPTRON_ENTRY) );
+        memcpy( history, past, sizeof(history) );
+
+        return true;
+    }
+
+  private:
+
+    static INT32 Clamp( INT32 weight )
+    {
+        return (weight < PERCEPTRON_WEIGHT_MIN) ? PERCEPTRON_WEIGHT_MIN
+             : ((weight > PERCEPTRON_WEIGHT_MAX) ? PERCEPTRON_WEIGHT_MAX : weight);
+    }
+
+    void Adjust( const UINT32 *index, INT32 delta )
+    {
+        for(UINT32 f=0; f<PERCEPTRON_FEATURES; f++)
+        {
+            weights[ index[f] ] = Clamp( weights[ index[f] ] + delta );
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,295 @@
+#include <cstdio>
+#include <cstring>
+#include <dlfcn.h>
+#include "replacement_state.h"
+
+// A built-in policy and the parameters it takes
+typedef struct
+{
+    const char  *name;
+    UINT32      policy;
+    const char  *params;        // space separated, for the usage text
+} CRC_POLICY_INFO;
+
+static const CRC_POLICY_INFO builtinPolicies[] =
+{
+    { "lru",        CRC_REPL_LRU,        "" },
+    { "random",     CRC_REPL_RANDOM,     "" },
+    { "drrip",      CRC_REPL_DRRIP,      "bip" },
+    { "ship",       CRC_REPL_SHIP,       "sigbits" },
+    { "eaf",        CRC_REPL_EAF,        "bip" },
+    { "eaf_rrip",   CRC_REPL_EAF_RRIP,   "bip" },
+    { "hawkeye",    CRC_REPL_HAWKEYE,    "sigbits" },
+    { "perceptron", CRC_REPL_PERCEPTRON, "" },
+    { "sdbp",       CRC_REPL_SDBP,       "" }
+};
+
+#define CRC_BUILTIN_POLICIES    (sizeof(builtinPolicies) / sizeof(builtinPolicies[0]))
+
+// A spec registered under an id of its own
+typedef struct
+{
+    char                    spec[ CRC_POLICY_SPEC ];
+    UINT32                  base;
+    CRC_POLICY_PARAMS       params;
+    const CRC_POLICY_OPS    *ops;
+    const char              *args;      // plugin arguments, inside 'spec'
+} CRC_POLICY_CONFIG;
+
+static CRC_POLICY_CONFIG configured[ CRC_MAX_CONFIGURED ];
+static UINT32            numConfigured = 0;
+
+static const CRC_POLICY_PARAMS defaultParams = { 0, 0 };
+
+static const CRC_POLICY_CONFIG *Configured( UINT32 id )
+{
+    if( id < CRC_REPL_CONFIGURED || id - CRC_REPL_CONFIGURED >= numConfigured ) return NULL;
+
+    return &configured[ id - CRC_REPL_CONFIGURED ];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Parses the key=value list of a built-in policy into 'params'. Every key    //
+// must be one the policy takes.                                              //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static bool ParseParams( const CRC_POLICY_INFO *info, char *list, CRC_POLICY_PARAMS *params )
+{
+    char *save = NULL;
+
+    for( char *item = strtok_r( list, ":", &save ); item != NULL; item = strtok_r( NULL, ":", &save ) )
+    {
+        char *value = strchr( item, '=' );
+
+        if( value == NULL )
+        {
+            cerr << "CRC_RegisterPolicy: " << item << " is not key=value" << endl;
+            return false;
+        }
+        *value++ = '\0';
+
+        // The key must be one of the policy's, as a whole word
+        const char *known = strstr( info->params, item );
+        size_t      len   = strlen( item );
+
+        if( known == NULL || (known != info->params && known[-1] != ' ') || (known[len] != '\0' && known[len] != ' ') )
+        {
+            cerr << "CRC_RegisterPolicy: " << info->name << " takes no parameter " << item << endl;
+            return false;
+        }
+
+        // The whole value must be a number: "bip=" and "sigbits=4x" are errors
+        char          *end   = NULL;
+        unsigned long number = strtoul( value, &end, 0 );
+
+        if( value[0] == '\0' || *end != '\0' )
+        {
+            cerr << "CRC_RegisterPolicy: " << item << "=" << value << " is not a number" << endl;
+            return false;
+        }
+
+        if( !strcmp( item, "sigbits" ) )
+        {
+            // The outcome bit shares the UINT16 entry with the signature
+            if( number < 1 || number > 15 )
+            {
+                cerr << "CRC_RegisterPolicy: sigbits is 1 to 15" << endl;
+                return false;
+            }
+            params->sigBits = number;
+        }
+        else if( !strcmp( item, "bip" ) )
+        {
+            if( number < 1 || number > (1U << CRC_RANDOM_CHANCE_BITS) )
+            {
+                cerr << "CRC_RegisterPolicy: bip is 1 to " << (1U << CRC_RANDOM_CHANCE_BITS) << endl;
+                return false;
+            }
+            params->bimodal = number;
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Loads the plugin named by the start of 'spec', up to the ':' after ".so".  //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static const CRC_POLICY_OPS *LoadPlugin( char *path )
+{
+    void *handle = dlopen( path, RTLD_NOW | RTLD_LOCAL );
+
+    if( handle == NULL )
+    {
+        cerr << "CRC_RegisterPolicy: " << dlerror() << endl;
+        return NULL;
+    }
+
+    CRC_POLICY_PLUGIN_FUNC entry = (CRC_POLICY_PLUGIN_FUNC) dlsym( handle, CRC_POLICY_PLUGIN_SYMBOL );
+    const CRC_POLICY_OPS   *ops  = (entry != NULL) ? entry() : NULL;
+
+    if( ops == NULL || ops->version != CRC_POLICY_API_VERSION
+        || ops->Create == NULL || ops->GetVictim == NULL || ops->Update == NULL )
+    {
+        cerr << "CRC_RegisterPolicy: " << path << " is not a version " << CRC_POLICY_API_VERSION << " policy plugin" << endl;
+        dlclose( handle );
+        return NULL;
+    }
+
+    return ops;
+}
+
+UINT32 CRC_RegisterPolicy( const char *spec )
+{
+    // Policy numbers pass through as they are, if they name a built-in
+    // policy or a spec registered before
+    char *end = NULL;
+    UINT32 number = strtoul( spec, &end, 10 );
+
+    if( end != spec && *end == '\0' )
+    {
+        for(UINT32 b=0; b<CRC_BUILTIN_POLICIES; b++)
+        {
+            if( builtinPolicies[b].policy == number ) return number;
+        }
+
+        if( Configured( number ) != NULL ) return number;
+
+        cerr << "CRC_RegisterPolicy: unknown policy number " << spec << endl;
+        return CRC_REPL_INVALID;
+    }
+
+    if( strlen( spec ) >= CRC_POLICY_SPEC )
+    {
+        cerr << "CRC_RegisterPolicy: policy spec too long" << endl;
+        return CRC_REPL_INVALID;
+    }
+
+    // A spec seen before keeps its id
+    for(UINT32 c=0; c<numConfigured; c++)
+    {
+        if( !strcmp( configured[c].spec, spec ) ) return CRC_REPL_CONFIGURED + c;
+    }
+
+    char copy[ CRC_POLICY_SPEC ];
+    strcpy( copy, spec );
+
+    char *params = strchr( copy, ':' );
+    const char *so = strstr( copy, ".so" );
+
+    if( so != NULL && (so[3] == '\0' || so[3] == ':') )
+    {
+        params = (so[3] == ':') ? (char *) so + 3 : NULL;
+    }
+    else
+    {
+        so = NULL;
+    }
+
+    if( params != NULL ) *params++ = '\0';
+
+    const CRC_POLICY_INFO *info = NULL;
+
+    for(UINT32 b=0; b<CRC_BUILTIN_POLICIES && so == NULL; b++)
+    {
+        if( !strcmp( copy, builtinPolicies[b].name ) ) info = &builtinPolicies[b];
+    }
+
+    if( info == NULL && so == NULL )
+    {
+        cerr << "CRC_RegisterPolicy: unknown policy " << copy << endl;
+        return CRC_REPL_INVALID;
+    }
+
+    // A bare built-in name is its number
+    if( info != NULL && (params == NULL || *params == '\0') ) return info->policy;
+
+    if( numConfigured == CRC_MAX_CONFIGURED )
+    {
+        cerr << "CRC_RegisterPolicy: more than " << CRC_MAX_CONFIGURED << " configured policies" << endl;
+        return CRC_REPL_INVALID;
+    }
+
+    CRC_POLICY_CONFIG *config = &configured[ numConfigured ];
+
+    strcpy( config->spec, spec );
+    config->params = defaultParams;
+    config->ops    = NULL;
+    config->args   = "";
+
+    if( info != NULL )
+    {
+        config->base = info->policy;
+
+        if( !ParseParams( info, params, &config->params ) ) return CRC_REPL_INVALID;
+    }
+    else
+    {
+        config->base = CRC_REPL_PLUGIN;
+        config->ops  = LoadPlugin( copy );
+
+        if( config->ops == NULL ) return CRC_REPL_INVALID;
+
+        // The arguments as given, without the path
+        if( params != NULL ) config->args = config->spec + (params - copy);
+    }
+
+    return CRC_REPL_CONFIGURED + numConfigured++;
+}
+
+const char *CRC_PolicyName( UINT32 id )
+{
+    const CRC_POLICY_CONFIG *config = Configured( id );
+
+    if( config != NULL ) return (config->ops != NULL) ? config->ops->name : config->spec;
+
+    for(UINT32 b=0; b<CRC_BUILTIN_POLICIES; b++)
+    {
+        if( builtinPolicies[b].policy == id ) return builtinPolicies[b].name;
+    }
+
+    return NULL;
+}
+
+UINT32 CRC_PolicyBase( UINT32 id )
+{
+    const CRC_POLICY_CONFIG *config = Configured( id );
+
+    return (config != NULL) ? config->base : id;
+}
+
+const CRC_POLICY_PARAMS *CRC_PolicyParams( UINT32 id )
+{
+    const CRC_POLICY_CONFIG *config = Configured( id );
+
+    return (config != NULL) ? &config->params : &defaultParams;
+}
+
+const CRC_POLICY_OPS *CRC_PolicyOps( UINT32 id )
+{
+    const CRC_POLICY_CONFIG *config = Configured( id );
+
+    return (config != NULL) ? config->ops : NULL;
+}
+
+const char *CRC_PolicyArgs( UINT32 id )
+{
+    const CRC_POLICY_CONFIG *config = Configured( id );
+
+    return (config != NULL) ? config->args : "";
+}
+
+void CRC_ListPolicies( ostream &out, const char *indent )
+{
+    for(UINT32 b=0; b<CRC_BUILTIN_POLICIES; b++)
+    {
+        out << indent << builtinPolicies[b].policy << " " << builtinPolicies[b].name;
+
+        if( builtinPolicies[b].params[0] != '\0' ) out << " [:" << builtinPolicies[b].params << "=N]";
+
+        out << endl;
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef CRC_POLICY_H
+#define CRC_POLICY_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Replacement policy registry. A policy is named by a spec:                  //
+//                                                                            //
+//   3                       a policy number, as CMP$im's -LLCrepl takes      //
+//   ship                    a built-in policy by name                        //
+//   ship:sigbits=12         with parameters, ':' separated                   //
+//   ./mypolicy.so:k=v       a plugin, with arguments handed to it verbatim   //
+//                                                                            //
+// CRC_RegisterPolicy turns a spec into the policy id that CRC_CACHE and      //
+// CACHE_REPLACEMENT_STATE take. Built-in policies without parameters keep    //
+// their own numbers; every other spec gets an id from CRC_REPL_CONFIGURED    //
+// up, valid for the life of the process. The CMP$im front end passes its     //
+// -LLCrepl number through; CRC_POLICY=<spec> in the environment overrides    //
+// it (see CRC_CACHE).                                                        //
+//                                                                            //
+// A plugin is a shared object exporting                                      //
+//                                                                            //
+//   extern "C" const CRC_POLICY_OPS *CRC_PolicyPlugin();                     //
+//                                                                            //
+// whose hooks are called through the table it returns. The cache keeps       //
+// lineStateBytes of state per line for it, inside the replacement state's    //
+// per-set metadata block, and passes each hook the block of the set.         //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "utils.h"
+#include "crc_cache_defs.h"
+
+#define CRC_REPL_CONFIGURED         64           // first id of a configured spec
+#define CRC_MAX_CONFIGURED          64
+#define CRC_REPL_INVALID            0xfe
+#define CRC_POLICY_SPEC             256          // longest spec kept
+
+#define CRC_POLICY_API_VERSION      1
+#define CRC_POLICY_PLUGIN_SYMBOL    "CRC_PolicyPlugin"
+
+// Parameters of the built-in policies; 0 keeps the policy's default
+typedef struct
+{
+    UINT32  sigBits;        // SHiP-PC signature bits, 1 to 15 (NumSigBits)
+    UINT32  bimodal;        // BRRIP / BIP insertion chance out of 1024
+} CRC_POLICY_PARAMS;
+
+// Hooks of a plugin policy. 'policy' is what Create returned; 'setState'
+// the set's lineStateBytes * assoc bytes, zeroed at start.
+typedef struct
+{
+    UINT32      version;                // CRC_POLICY_API_VERSION
+    const char  *name;
+    UINT32      lineStateBytes;
+
+    void   *(*Create)( UINT32 sets, UINT32 assoc, const char *args );
+    INT32   (*GetVictim)( void *policy, UINT8 *setState, UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet,
+                          UINT32 assoc, Addr_t PC, Addr_t paddr, UINT32 accessType );
+    void    (*Update)( void *policy, UINT8 *setState, UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine,
+                       UINT32 tid, Addr_t PC, UINT32 accessType, bool cacheHit );
+    void    (*PrintStats)( void *policy, ostream &out );
+} CRC_POLICY_OPS;
+
+typedef const CRC_POLICY_OPS *(*CRC_POLICY_PLUGIN_FUNC)();
+
+// Returns the id of 'spec', or CRC_REPL_INVALID after printing why not
+UINT32                   CRC_RegisterPolicy( const char *spec );
+
+// Name of a policy id for reports and file names
+const char              *CRC_PolicyName( UINT32 id );
+
+// The built-in policy (or CRC_REPL_PLUGIN) an id runs, and its settings
+UINT32                   CRC_PolicyBase( UINT32 id );
+const CRC_POLICY_PARAMS *CRC_PolicyParams( UINT32 id );
+const CRC_POLICY_OPS    *CRC_PolicyOps( UINT32 id );
+const char              *CRC_PolicyArgs( UINT32 id );
+
+// Built-in names and their parameters, one per line
+void                     CRC_ListPolicies( ostream &out, const char *indent );
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef CRC_RANDOM_H
+#define CRC_RANDOM_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Pseudo random numbers for the replacement policies. Each replacement       //
+// state owns a generator, so a run depends only on its seed and on its own   //
+// accesses, not on other users of libc rand() in the process.                //
+//                                                                            //
+// The generator is xorshift64* (Vigna, 2016): three shifts, one multiply.    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "utils.h"
+
+#define CRC_RANDOM_DEFAULT_SEED     0x2545f4914f6cdd1dULL
+
+// Bimodal probabilities are expressed out of 2^CRC_RANDOM_CHANCE_BITS
+#define CRC_RANDOM_CHANCE_BITS      10
+
+class CRC_RANDOM
+{
+  private:
+
+    UINT64  state;
+
+  public:
+
+    CRC_RANDOM( UINT64 seed = CRC_RANDOM_DEFAULT_SEED ) { Seed( seed ); }
+
+    // A zero state would stay zero, so it is remapped
+    void   Seed( UINT64 seed )
+    {
+        state = (seed != 0) ? seed : CRC_RANDOM_DEFAULT_SEED;
+    }
+
+    // Current state, e.g. for a checkpoint; Seed() with it resumes the
+    // sequence
+    UINT64 State() { return state; }
+
+    UINT64 Next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+
+        return state * 0x2545f4914f6cdd1dULL;
+    }
+
+    // Uniform value in [0, n), by multiply-shift rather than modulo
+    UINT32 Below( UINT32 n )
+    {
+        return (UINT32) (((Next() >> 32) * n) >> 32);
+    }
+
+    // True with probability threshold / 2^CRC_RANDOM_CHANCE_BITS
+    bool   Chance( UINT32 threshold )
+    {
+        return (Next() >> (64 - CRC_RANDOM_CHANCE_BITS)) < threshold;
+    }
+};
+
+// Stateless 64-bit mix (the splitmix64 finalizer): every input bit affects
+// every output bit, so any slice of the result is a uniform hash of 'value'
+static inline UINT64 CRC_Mix64( UINT64 value )
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+
+    return value;
+}
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef CRC_SDBP_H
+#define CRC_SDBP_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Sampling dead block predictor (Khan, Tian & Jimenez, MICRO 2010). A        //
+// block is predicted dead from the PC of its last access:                    //
+//                                                                            //
+//   predictor  SDBP_TABLES tables of 2-bit counters, each indexed by its     //
+//              own hash of the PC signature (skewed, so that signatures      //
+//              aliasing in one table rarely alias in the others). The        //
+//              block is dead if the counters add up to SDBP_THRESHOLD.       //
+//   sampler    a tag array over SDBP_SAMPLED_SETS sets, SDBP_SAMPLER_WAYS    //
+//              ways in LRU order, with the signature of the last access      //
+//              to each line. A sampler hit trains that signature toward      //
+//              live, an LRU eviction toward dead.                            //
+//                                                                            //
+// The sampler is decoupled from the cache: it has fewer sets and ways and    //
+// its own replacement, so training costs little whatever the policy does     //
+// with the predictions.                                                      //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstring>
+#include "utils.h"
+#include "crc_simd.h"
+#include "crc_checkpoint.h"
+
+#define SDBP_SIG_BITS         15           // PC signature
+#define SDBP_TABLES           3
+#define SDBP_TABLE_BITS       12           // counters per table: 2^12
+#define SDBP_CTR_MAX          3            // 2-bit counters
+#define SDBP_THRESHOLD        8            // sum of the counters at or above: dead
+#define SDBP_SAMPLED_SETS     32
+#define SDBP_SAMPLER_WAYS     12           // a multiple of 4, as CRC_MatchTags needs
+#define SDBP_NOT_SAMPLED      0xff
+#define SDBP_NO_LINE          (~(Addr_t) 0)
+
+// A sampler entry; the line address is kept apart for the SIMD lookup
+typedef struct
+{
+    UINT16  signature;    // of the last access
+    UINT8   lru;          // 0 most recent
+} CRC_SDBP_ENTRY;
+
+class CRC_SDBP
+{
+  private:
+
+    UINT8               *tables;     // SDBP_TABLES << SDBP_TABLE_BITS counters
+
+    UINT32              numsets;
+    UINT32              sampledSets;
+    UINT8               *slot;       // sampler set per set, SDBP_NOT_SAMPLED if none
+    Addr_t              *lines;      // SDBP_SAMPLER_WAYS per sampled set, SDBP_NO_LINE if free
+    CRC_SDBP_ENTRY      *entries;
+
+    // Odd multipliers, one hash per table
+    static UINT32 Index( UINT32 signature, UINT32 t )
+    {
+        static const UINT32 mult[ SDBP_TABLES ] = { 0x9e3779b1, 0x85ebca6b, 0xc2b2ae35 };
+
+        return (t << SDBP_TABLE_BITS) | ((signature * mult[t]) >> (32 - SDBP_TABLE_BITS));
+    }
+
+  public:
+
+    COUNTER             samplerAccesses;
+    COUNTER             samplerHits;
+    COUNTER             trainedLive;
+    COUNTER             trainedDead;
+
+    CRC_SDBP( UINT32 _sets )
+    {
+        numsets     = _sets;
+        sampledSets = (numsets < SDBP_SAMPLED_SETS) ? numsets : SDBP_SAMPLED_SETS;
+
+        samplerAccesses = samplerHits = trainedLive = trainedDead = 0;
+
+        if( posix_memalign( (void **) &lines, 32, (size_t) sampledSets * SDBP_SAMPLER_WAYS * sizeof(Addr_t) ) != 0 )
+        {
+            cout << "CRC_SDBP: cannot allocate the sampler" << endl;
+            exit( 1 );
+        }
+
+        tables = new UINT8[ SDBP_TABLES << SDBP_TABLE_BITS ];
+        memset( tables, 0, SDBP_TABLES << SDBP_TABLE_BITS );
+
+        // Sampled sets are evenly spaced
+        slot = new UINT8[ numsets ];
+        memset( slot, SDBP_NOT_SAMPLED, numsets );
+        for(UINT32 s=0; s<sampledSets; s++) slot[ (size_t) s * numsets / sampledSets ] = s;
+
+        entries = new CRC_SDBP_ENTRY[ (size_t) sampledSets * SDBP_SAMPLER_WAYS ];
+        for(size_t e=0; e<(size_t) sampledSets * SDBP_SAMPLER_WAYS; e++)
+        {
+            lines[e] = SDBP_NO_LINE;
+            memset( &entries[e], 0, sizeof(CRC_SDBP_ENTRY) );
+            entries[e].lru = (UINT8) (e % SDBP_SAMPLER_WAYS);
+        }
+    }
+
+    ~CRC_SDBP()
+    {
+        free( lines );
+        delete [] tables;
+        delete [] slot;
+        delete [] entries;
+    }
+
+    static UINT32 Signature( Addr_t PC )
+    {
+        return (UINT32) ((PC ^ (PC >> SDBP_SIG_BITS) ^ (PC >> (2 * SDBP_SIG_BITS))) & ((1 << SDBP_SIG_BITS) - 1));
+    }
+
+    bool Dead( UINT32 signature )
+    {
+        UINT32 sum = 0;
+
+        for(UINT32 t=0; t<SDBP_TABLES; t++) sum += tables[ Index( signature, t ) ];
+
+        return (sum >= SDBP_THRESHOLD);
+    }
+
+    // Trains on the sampler outcome of an access to a sampled set; the
+    // access then takes the line's entry. Other sets are not sampled.
+    void Train( UINT32 setIndex, Addr_t line, UINT32 signature )
+    {
+        if( slot[ setIndex ] == SDBP_NOT_SAMPLED ) return;
+
+        Addr_t          *tags = &lines[ (size_t) slot[ setIndex ] * SDBP_SAMPLER_WAYS ];
+        CRC_SDBP_ENTRY  *set  = &entries[ (size_t) slot[ setIndex ] * SDBP_SAMPLER_WAYS ];
+        BITVECTOR       match = CRC_MatchTags( tags, SDBP_SAMPLER_WAYS, line );
+        UINT32          way;
+
+        samplerAccesses++;
+
+        if( match != 0 )
+        {
+            // Reused while in the sampler: the last access was live
+            way = CRC_Ctz( match );
+            Adjust( set[way].signature, false );
+            samplerHits++;
+            trainedLive++;
+        }
+        else
+        {
+            for(way=0; set[way].lru != SDBP_SAMPLER_WAYS - 1; way++) ;
+
+            // Fell off the LRU end without reuse: the last access was dead
+            if( tags[way] != SDBP_NO_LINE )
+            {
+                Adjust( set[way].signature, true );
+                trainedDead++;
+            }
+
+            tags[way] = line;
+        }
+
+        for(UINT32 w=0; w<SDBP_SAMPLER_WAYS; w++)
+        {
+            set[w].lru += (set[w].lru < set[way].lru);
+        }
+
+        set[way].signature = (UINT16) signature;
+        set[way].lru       = 0;
+    }
+
+    // Sharded replay: adds up the counter changes of every copy since the
+    // last call, saturating, and hands the result back to the copies
+    void Synchronize( CRC_SDBP **copies, UINT32 n )
+    {
+        for(UINT32 c=0; c<(SDBP_TABLES << SDBP_TABLE_BITS); c++)
+        {
+            INT32 counter = tables[c];
+
+            for(UINT32 k=0; k<n; k++) counter += (INT32) copies[k]->tables[c] - (INT32) tables[c];
+
+            tables[c] = (counter < 0) ? 0 : ((counter > SDBP_CTR_MAX) ? SDBP_CTR_MAX : counter);
+
+            for(UINT32 k=0; k<n; k++) copies[k]->tables[c] = tables[c];
+        }
+    }
+
+    // The predictor tables; SaveSampler() has the sampler
+    void Save( CRC_CHECKPOINT_WRITER &writer, UINT32 id, const void *extra, size_t extraBytes )
+    {
+        writer.Section( id, tables, SDBP_TABLES << SDBP_TABLE_BITS, extra, extraBytes );
+    }
+
+    // The extra payload Save was given, or NULL if the checkpoint has no
+    // matching section
+    const void *Load( CRC_CHECKPOINT_READER &reader, UINT32 id, size_t extraBytes )
+    {
+        size_t      bytes   = 0;
+        const UINT8 *stored = (const UINT8 *) reader.Find( id, &bytes );
+
+        if( stored == NULL || bytes != (SDBP_TABLES << SDBP_TABLE_BITS) + extraBytes ) return NULL;
+
+        for(UINT32 c=0; c<(SDBP_TABLES << SDBP_TABLE_BITS); c++)
+        {
+            tables[c] = (stored[c] > SDBP_CTR_MAX) ? SDBP_CTR_MAX : stored[c];
+        }
+
+        return stored + (SDBP_TABLES << SDBP_TABLE_BITS);
+    }
+
+    void SaveSampler( CRC_CHECKPOINT_WRITER &writer, UINT32 id )
+    {
+        size_t ways = (size_t) sampledSets * SDBP_SAMPLER_WAYS;
+
+        writer.Section( id, lines, ways * sizeof(Addr_t), entries, ways * sizeof(CRC_SDBP_ENTRY) );
+    }
+
+    // False, leaving the sampler as it was, unless the checkpoint has one
+    // as large with every set in LRU order
+    bool LoadSampler( CRC_CHECKPOINT_READER &reader, UINT32 id )
+    {
+        size_t      ways    = (size_t) sampledSets * SDBP_SAMPLER_WAYS;
+        size_t      bytes   = 0;
+        const UINT8 *stored = (const UINT8 *) reader.Find( id, &bytes );
+
+        if( stored == NULL || bytes != ways * (sizeof(Addr_t) + sizeof(CRC_SDBP_ENTRY)) ) return false;
+
+        const CRC_SDBP_ENTRY *sampler = (const CRC_SDBP_ENTRY *) (stored + ways * sizeof(Addr_t));
+
+        for(UINT32 s=0; s<sampledSets; s++)
+        {
+            UINT32 seen = 0;
+
+            for(UINT32 w=0; w<SDBP_SAMPLER_WAYS; w++)
+            {
+                UINT8 lru = sampler[ (size_t) s * SDBP_SAMPLER_WAYS + w ].lru;
+
+                if( lru >= SDBP_SAMPLER_WAYS || (seen >> lru) & 1 ) return false;
+                seen |= 1 << lru;
+            }
+        }
+
+        memcpy( lines, stored, ways * sizeof(Addr_t) );
+        memcpy( entries, sampler, ways * sizeof(CRC_SDBP_ENTRY) );
+
+        return true;
+    }
+
+  private:
+
+    void Adjust( UINT32 signature, bool dead )
+    {
+        for(UINT32 t=0; t<SDBP_TABLES; t++)
+        {
+            UINT8 &counter = tables[ Index( signature, t ) ];
+
+            if( dead && counter < SDBP_CTR_MAX ) counter++;
+            else if( !dead && counter != 0 ) counter--;
+        }
+    }
+};
+
+#endif
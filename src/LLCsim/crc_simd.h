@@ -0,0 +1,340 @@
+#ifndef CRC_SIMD_H
+#define CRC_SIMD_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Small SIMD kernels for the cache model. The path used is picked at         //
+// compile time from the target flags (see ARCH_FLAGS in the makefile):       //
+//                                                                            //
+//   CRC_MatchTags, CRC_HashIndex8, CRC_GatherSum8   AVX2, SSE4.1, scalar     //
+//   CRC_MinIndex                                    AVX2, SSE4.2, scalar     //
+//   CRC_RripVictim, CRC_MaxByteIndex                SSE4.1, scalar           //
+//                                                                            //
+// The last two work on byte wide state, 16 ways to a vector, which already   //
+// covers most sets; the default -msse4.2 build takes every SSE4 path.        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+#include "utils.h"
+
+// Index of the lowest set bit; mask must be non-zero
+static inline UINT32 CRC_Ctz( BITVECTOR mask )
+{
+    return __builtin_ctzll( mask );
+}
+
+// Number of set bits
+static inline UINT32 CRC_Popcount( BITVECTOR mask )
+{
+    return __builtin_popcountll( mask );
+}
+
+// Hint that the line holding 'p' is about to be read and written
+static inline void CRC_Prefetch( const void *p )
+{
+    __builtin_prefetch( p, 1, 3 );
+}
+
+// CRC32-C of a 64-bit value, using the SSE4.2 instruction when available
+static inline UINT32 CRC_Crc32( unsigned long long value )
+{
+#if defined(__SSE4_2__)
+    return (UINT32) _mm_crc32_u64( 0, value );
+#else
+    UINT32 crc = 0;
+
+    for(UINT32 bit=0; bit<64; bit++)
+    {
+        UINT32 mix = (crc ^ (UINT32) (value >> bit)) & 1;
+        crc = (crc >> 1) ^ (mix ? 0x82f63b78 : 0);
+    }
+
+    return crc;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Compares 'n' tags against 'tag' and returns a bit mask with bit i set if   //
+// tags[i] == tag. 'n' must be a multiple of 4 and 'tags' 32-byte aligned.    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static inline BITVECTOR CRC_MatchTags( const Addr_t *tags, UINT32 n, Addr_t tag )
+{
+    BITVECTOR match = 0;
+
+#if defined(__AVX2__)
+    __m256i key = _mm256_set1_epi64x( tag );
+
+    for(UINT32 w=0; w<n; w+=4)
+    {
+        __m256i v  = _mm256_load_si256( (const __m256i *) &tags[w] );
+        __m256i eq = _mm256_cmpeq_epi64( v, key );
+        match |= (BITVECTOR) _mm256_movemask_pd( _mm256_castsi256_pd( eq ) ) << w;
+    }
+#elif defined(__SSE4_1__)
+    __m128i key = _mm_set1_epi64x( tag );
+
+    for(UINT32 w=0; w<n; w+=2)
+    {
+        __m128i v  = _mm_load_si128( (const __m128i *) &tags[w] );
+        __m128i eq = _mm_cmpeq_epi64( v, key );
+        match |= (BITVECTOR) _mm_movemask_pd( _mm_castsi128_pd( eq ) ) << w;
+    }
+#else
+    for(UINT32 w=0; w<n; w++)
+    {
+        match |= (BITVECTOR) (tags[w] == tag) << w;
+    }
+#endif
+
+    return match;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Returns the index of the smallest of 'n' values, the lowest index on a     //
+// tie. Values must be below 2^63; 'n' and alignment as for CRC_MatchTags.    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static inline UINT32 CRC_MinIndex( const unsigned long long *values, UINT32 n )
+{
+    unsigned long long best;
+
+#if defined(__AVX2__)
+    __m256i low = _mm256_load_si256( (const __m256i *) &values[0] );
+
+    for(UINT32 w=4; w<n; w+=4)
+    {
+        __m256i v = _mm256_load_si256( (const __m256i *) &values[w] );
+        low = _mm256_blendv_epi8( low, v, _mm256_cmpgt_epi64( low, v ) );
+    }
+
+    __m128i half = _mm256_extracti128_si256( low, 1 );
+    __m128i lo   = _mm256_castsi256_si128( low );
+    lo   = _mm_blendv_epi8( lo, half, _mm_cmpgt_epi64( lo, half ) );
+    half = _mm_unpackhi_epi64( lo, lo );
+    lo   = _mm_blendv_epi8( lo, half, _mm_cmpgt_epi64( lo, half ) );
+    best = (unsigned long long) _mm_cvtsi128_si64( lo );
+#elif defined(__SSE4_2__)
+    __m128i low = _mm_load_si128( (const __m128i *) &values[0] );
+
+    for(UINT32 w=2; w<n; w+=2)
+    {
+        __m128i v = _mm_load_si128( (const __m128i *) &values[w] );
+        low = _mm_blendv_epi8( low, v, _mm_cmpgt_epi64( low, v ) );
+    }
+
+    __m128i half = _mm_unpackhi_epi64( low, low );
+    low  = _mm_blendv_epi8( low, half, _mm_cmpgt_epi64( low, half ) );
+    best = (unsigned long long) _mm_cvtsi128_si64( low );
+#else
+    best = values[0];
+
+    for(UINT32 w=1; w<n; w++)
+    {
+        if( values[w] < best ) best = values[w];
+    }
+#endif
+
+    return CRC_Ctz( CRC_MatchTags( values, n, best ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// RRIP victim search over one set of byte wide RRPVs. Ages every way by      //
+// the one delta that brings the oldest line to 'rrpvMax', then returns the   //
+// lowest way at 'rrpvMax'. This is what the scan / increment-all / rescan    //
+// loop of the RRIP paper computes, in one pass.                              //
+//                                                                            //
+// 'n' must be a multiple of 16 and 'rrpv' 16-byte aligned. 'ways' holds      //
+// 0xff for the ways that exist and 0 for padding, which is never aged.       //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static inline UINT32 CRC_RripVictim( UINT8 *rrpv, const UINT8 *ways, UINT32 n, UINT8 rrpvMax )
+{
+    BITVECTOR atMax = 0;
+
+#if defined(__SSE4_1__)
+    __m128i top = _mm_setzero_si128();
+
+    for(UINT32 w=0; w<n; w+=16)
+    {
+        top = _mm_max_epu8( top, _mm_load_si128( (const __m128i *) &rrpv[w] ) );
+    }
+
+    top = _mm_max_epu8( top, _mm_srli_si128( top, 8 ) );
+    top = _mm_max_epu8( top, _mm_srli_si128( top, 4 ) );
+    top = _mm_max_epu8( top, _mm_srli_si128( top, 2 ) );
+    top = _mm_max_epu8( top, _mm_srli_si128( top, 1 ) );
+
+    __m128i delta = _mm_set1_epi8( (char) (rrpvMax - (UINT8) _mm_cvtsi128_si32( top )) );
+    __m128i key   = _mm_set1_epi8( (char) rrpvMax );
+
+    for(UINT32 w=0; w<n; w+=16)
+    {
+        __m128i v    = _mm_load_si128( (const __m128i *) &rrpv[w] );
+        __m128i mask = _mm_load_si128( (const __m128i *) &ways[w] );
+
+        v = _mm_add_epi8( v, _mm_and_si128( delta, mask ) );
+        _mm_store_si128( (__m128i *) &rrpv[w], v );
+
+        atMax |= (BITVECTOR) (UINT32) _mm_movemask_epi8( _mm_cmpeq_epi8( v, key ) ) << w;
+    }
+#else
+    UINT8 top = 0;
+
+    for(UINT32 w=0; w<n; w++)
+    {
+        if( rrpv[w] > top ) top = rrpv[w];
+    }
+
+    UINT8 delta = rrpvMax - top;
+
+    for(UINT32 w=0; w<n; w++)
+    {
+        rrpv[w] += delta & ways[w];
+        atMax   |= (BITVECTOR) (rrpv[w] == rrpvMax) << w;
+    }
+#endif
+
+    return CRC_Ctz( atMax );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Returns the lowest index of the largest of 'n' bytes, without changing     //
+// them: the victim search of policies that do not age on a miss. 'n' and     //
+// alignment as for CRC_RripVictim; padding must hold 0.                      //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static inline UINT32 CRC_MaxByteIndex( const UINT8 *values, UINT32 n )
+{
+    BITVECTOR atMax = 0;
+
+#if defined(__SSE4_1__)
+    __m128i top = _mm_setzero_si128();
+
+    for(UINT32 w=0; w<n; w+=16)
+    {
+        top = _mm_max_epu8( top, _mm_load_si128( (const __m128i *) &values[w] ) );
+    }
+
+    top = _mm_max_epu8( top, _mm_srli_si128( top, 8 ) );
+    top = _mm_max_epu8( top, _mm_srli_si128( top, 4 ) );
+    top = _mm_max_epu8( top, _mm_srli_si128( top, 2 ) );
+    top = _mm_max_epu8( top, _mm_srli_si128( top, 1 ) );
+
+    __m128i key = _mm_shuffle_epi8( top, _mm_setzero_si128() );
+
+    for(UINT32 w=0; w<n; w+=16)
+    {
+        __m128i v = _mm_load_si128( (const __m128i *) &values[w] );
+
+        atMax |= (BITVECTOR) (UINT32) _mm_movemask_epi8( _mm_cmpeq_epi8( v, key ) ) << w;
+    }
+#else
+    UINT8 top = 0;
+
+    for(UINT32 w=0; w<n; w++)
+    {
+        if( values[w] > top ) top = values[w];
+    }
+
+    for(UINT32 w=0; w<n; w++)
+    {
+        atMax |= (BITVECTOR) (values[w] == top) << w;
+    }
+#endif
+
+    return CRC_Ctz( atMax );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Hashes 8 keys into 8 tables of 2^bits entries laid end to end: index[i]    //
+// is (i << bits) plus the top 'bits' bits of keys[i] times an odd            //
+// constant. 'bits' must be at most 28.                                       //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static inline void CRC_HashIndex8( const UINT32 *keys, UINT32 bits, UINT32 *index )
+{
+#if defined(__AVX2__)
+    __m256i k    = _mm256_loadu_si256( (const __m256i *) keys );
+    __m256i base = _mm256_slli_epi32( _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ), bits );
+
+    k = _mm256_mullo_epi32( k, _mm256_set1_epi32( (int) 0x9e3779b1 ) );
+    k = _mm256_srli_epi32( k, 32 - bits );
+    _mm256_storeu_si256( (__m256i *) index, _mm256_add_epi32( k, base ) );
+#elif defined(__SSE4_1__)
+    __m128i mult = _mm_set1_epi32( (int) 0x9e3779b1 );
+
+    for(UINT32 i=0; i<8; i+=4)
+    {
+        __m128i k    = _mm_loadu_si128( (const __m128i *) &keys[i] );
+        __m128i base = _mm_slli_epi32( _mm_setr_epi32( i, i + 1, i + 2, i + 3 ), bits );
+
+        k = _mm_mullo_epi32( k, mult );
+        k = _mm_srli_epi32( k, 32 - bits );
+        _mm_storeu_si128( (__m128i *) &index[i], _mm_add_epi32( k, base ) );
+    }
+#else
+    for(UINT32 i=0; i<8; i++)
+    {
+        index[i] = (i << bits) + ((keys[i] * 0x9e3779b1U) >> (32 - bits));
+    }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Sum of table[index[i]] over 8 indices: a perceptron's output from the      //
+// weights its features select. AVX2 fetches them with one gather; SSE4.1     //
+// has none, so it inserts them into two vectors and adds those.              //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static inline INT32 CRC_GatherSum8( const INT32 *table, const UINT32 *index )
+{
+#if defined(__AVX2__)
+    __m256i idx = _mm256_loadu_si256( (const __m256i *) index );
+    __m256i v   = _mm256_i32gather_epi32( (const int *) table, idx, 4 );
+    __m128i sum = _mm_add_epi32( _mm256_castsi256_si128( v ), _mm256_extracti128_si256( v, 1 ) );
+
+    sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+
+    return _mm_cvtsi128_si32( sum );
+#elif defined(__SSE4_1__)
+    __m128i lo = _mm_cvtsi32_si128( table[ index[0] ] );
+    __m128i hi = _mm_cvtsi32_si128( table[ index[4] ] );
+
+    lo = _mm_insert_epi32( lo, table[ index[1] ], 1 );
+    hi = _mm_insert_epi32( hi, table[ index[5] ], 1 );
+    lo = _mm_insert_epi32( lo, table[ index[2] ], 2 );
+    hi = _mm_insert_epi32( hi, table[ index[6] ], 2 );
+    lo = _mm_insert_epi32( lo, table[ index[3] ], 3 );
+    hi = _mm_insert_epi32( hi, table[ index[7] ], 3 );
+
+    __m128i sum = _mm_add_epi32( lo, hi );
+
+    sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+
+    return _mm_cvtsi128_si32( sum );
+#else
+    INT32 sum = 0;
+
+    for(UINT32 i=0; i<8; i++)
+    {
+        sum += table[ index[i] ];
+    }
+
+    return sum;
+#endif
+}
+
+#endif
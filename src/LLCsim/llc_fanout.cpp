@@ -0,0 +1,136 @@
+#include <sched.h>
+#include <unistd.h>
+#include "llc_fanout.h"
+
+LLC_FANOUT::LLC_FANOUT( CRC_CACHE **_caches, UINT32 _numCaches )
+{
+    numCaches = _numCaches;
+    caches    = new CRC_CACHE* [ numCaches ];
+    threads   = new pthread_t [ numCaches ];
+    workers   = new LLC_FANOUT_WORKER [ numCaches ];
+
+    for(UINT32 b=0; b<LLC_FANOUT_BUFFERS; b++)
+    {
+        batches[b]    = new LLC_ACCESS[ LLC_FANOUT_BATCH ];
+        batchCount[b] = 0;
+    }
+
+    fill      = batches[0];
+    fillCount = 0;
+    published = 0;
+    done      = false;
+
+    // Pin only when every worker can have a core of its own
+    long cores = sysconf( _SC_NPROCESSORS_ONLN );
+
+    for(UINT32 c=0; c<numCaches; c++)
+    {
+        caches[c]           = _caches[c];
+        workers[c].fanout   = this;
+        workers[c].index    = c;
+        workers[c].consumed = 0;
+
+        pthread_create( &threads[c], NULL, WorkerThread, &workers[c] );
+
+        if( cores > (long) numCaches )
+        {
+            cpu_set_t cpus;
+            CPU_ZERO( &cpus );
+            CPU_SET( c + 1, &cpus );     // core 0 is left to the reader
+            pthread_setaffinity_np( threads[c], sizeof(cpus), &cpus );
+        }
+    }
+}
+
+LLC_FANOUT::~LLC_FANOUT()
+{
+    for(UINT32 c=0; c<numCaches; c++)
+    {
+        delete caches[c];
+    }
+
+    for(UINT32 b=0; b<LLC_FANOUT_BUFFERS; b++)
+    {
+        delete [] batches[b];
+    }
+
+    delete [] caches;
+    delete [] threads;
+    delete [] workers;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Makes the filled batch visible to the workers and waits until the next     //
+// buffer has been replayed by all of them.                                   //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void LLC_FANOUT::Publish()
+{
+    batchCount[ published % LLC_FANOUT_BUFFERS ] = fillCount;
+    __atomic_store_n( &published, published + 1, __ATOMIC_RELEASE );
+
+    // Batch 'published' reuses the buffer of batch published-BUFFERS
+    for(UINT32 c=0; c<numCaches; c++)
+    {
+        while( published - __atomic_load_n( &workers[c].consumed, __ATOMIC_ACQUIRE ) >= LLC_FANOUT_BUFFERS )
+        {
+            sched_yield();
+        }
+    }
+
+    fill      = batches[ published % LLC_FANOUT_BUFFERS ];
+    fillCount = 0;
+}
+
+void LLC_FANOUT::Finish()
+{
+    if( fillCount != 0 )
+    {
+        Publish();
+    }
+
+    __atomic_store_n( &done, true, __ATOMIC_RELEASE );
+
+    for(UINT32 c=0; c<numCaches; c++)
+    {
+        pthread_join( threads[c], NULL );
+    }
+}
+
+void *LLC_FANOUT::WorkerThread( void *arg )
+{
+    LLC_FANOUT_WORKER *worker = (LLC_FANOUT_WORKER *) arg;
+
+    worker->fanout->Work( worker );
+
+    return NULL;
+}
+
+void LLC_FANOUT::Work( LLC_FANOUT_WORKER *worker )
+{
+    CRC_CACHE *llc  = caches[ worker->index ];
+    COUNTER    next = 0;
+
+    while( true )
+    {
+        // 'done' is read before 'published' so a final batch is not missed
+        bool finished = __atomic_load_n( &done, __ATOMIC_ACQUIRE );
+
+        if( __atomic_load_n( &published, __ATOMIC_ACQUIRE ) == next )
+        {
+            if( finished ) break;
+
+            sched_yield();
+            continue;
+        }
+
+        const LLC_ACCESS *batch = batches[ next % LLC_FANOUT_BUFFERS ];
+        UINT32            count = batchCount[ next % LLC_FANOUT_BUFFERS ];
+
+        llc->LookupAndFillCacheBatch( batch, count );
+
+        next++;
+        __atomic_store_n( &worker->consumed, next, __ATOMIC_RELEASE );
+    }
+}
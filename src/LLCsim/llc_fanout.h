@@ -0,0 +1,83 @@
+#ifndef LLC_FANOUT_H
+#define LLC_FANOUT_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Single-pass replay of one LLC stream into several independent caches,      //
+// e.g. one per replacement policy. The stream is read and decoded once;      //
+// the accesses are collected in batches that every cache's worker thread     //
+// replays read-only, each worker pinned to its own core when the host        //
+// has enough of them.                                                        //
+//                                                                            //
+// LLC_FANOUT_BUFFERS batches are in flight. The reader refills a buffer      //
+// only after every worker has finished with it, so the slowest cache sets    //
+// the pace and the others run ahead by at most the remaining buffers.        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <pthread.h>
+#include "crc_cache.h"
+#include "llc_trace.h"
+
+#define LLC_FANOUT_BATCH        16384        // accesses per batch
+#define LLC_FANOUT_BUFFERS      8            // batches in flight
+
+class LLC_FANOUT;
+
+// Per-worker state, on its own host cache line
+typedef struct
+{
+    LLC_FANOUT              *fanout;
+    UINT32                  index;
+    COUNTER                 consumed        __attribute__(( aligned( 64 ) ));   // batches finished
+} LLC_FANOUT_WORKER;
+
+class LLC_FANOUT
+{
+  private:
+
+    UINT32                  numCaches;
+    CRC_CACHE               **caches;
+
+    LLC_ACCESS              *batches[ LLC_FANOUT_BUFFERS ];
+    UINT32                  batchCount[ LLC_FANOUT_BUFFERS ];
+    LLC_ACCESS              *fill;           // batch being filled by the reader
+    UINT32                  fillCount;
+
+    COUNTER                 published        __attribute__(( aligned( 64 ) ));
+    bool                    done;
+
+    pthread_t               *threads;
+    LLC_FANOUT_WORKER       *workers;
+
+  public:
+
+    // Takes ownership of the caches
+    LLC_FANOUT( CRC_CACHE **_caches, UINT32 _numCaches );
+    ~LLC_FANOUT();
+
+    void   Access( const LLC_ACCESS &access )
+    {
+        fill[ fillCount ] = access;
+
+        if( ++fillCount == LLC_FANOUT_BATCH )
+        {
+            Publish();
+        }
+    }
+
+    // Replays what is left and waits for every cache to finish
+    void   Finish();
+
+    CRC_CACHE *Cache( UINT32 index ) { return caches[ index ]; }
+
+  private:
+
+    void   Publish();
+    void   Work( LLC_FANOUT_WORKER *worker );
+
+    static void *WorkerThread( void *arg );
+};
+
+#endif
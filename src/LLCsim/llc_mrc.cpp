@@ -0,0 +1,202 @@
+#include <cassert>
+#include <cstring>
+#include "crc_simd.h"
+#include "llc_mrc.h"
+
+LLC_MRC::LLC_MRC( UINT32 linesize, UINT32 _minSets, UINT32 maxSets )
+{
+    assert( (_minSets & (_minSets - 1)) == 0 && (maxSets & (maxSets - 1)) == 0 && _minSets <= maxSets );
+
+    lineShift = CRC_FloorLog2( linesize );
+    minSets   = _minSets;
+    numLevels = CRC_FloorLog2( maxSets ) - CRC_FloorLog2( minSets ) + 1;
+    writebacks = 0;
+
+    sets   = new LLC_MRC_SET* [ numLevels ];
+    depths = new COUNTER [ numLevels ][ ACCESS_MAX ][ LLC_MRC_MAX_ASSOC + 1 ];
+
+    memset( depths, 0, sizeof(depths[0]) * numLevels );
+
+    for(UINT32 l=0; l<numLevels; l++)
+    {
+        UINT32 count = minSets << l;
+
+        sets[l] = new LLC_MRC_SET[ count ];
+
+        memset( sets[l], 0, sizeof(LLC_MRC_SET) * count );
+    }
+}
+
+LLC_MRC::~LLC_MRC()
+{
+    for(UINT32 l=0; l<numLevels; l++)
+    {
+        delete [] sets[l];
+    }
+
+    delete [] sets;
+    delete [] depths;
+}
+
+// Number of lines more recent than the one in slot 's'
+inline UINT32 LLC_MRC::Depth( const LLC_MRC_SET *set, UINT32 s )
+{
+    if( s < 64 )
+    {
+        return CRC_Popcount( set->live[0] & ~((2ULL << s) - 1) ) + CRC_Popcount( set->live[1] );
+    }
+
+    return CRC_Popcount( set->live[1] & ~((2ULL << (s - 64)) - 1) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Gives 'entry' the next recency slot. When the slots run out the live       //
+// ones are renumbered from 0 in recency order.                               //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+inline void LLC_MRC::MakeMRU( LLC_MRC_SET *set, UINT32 entry )
+{
+    if( set->next == LLC_MRC_SLOTS )
+    {
+        UINT32 count = 0;
+
+        for(UINT32 half=0; half<2; half++)
+        {
+            for(BITVECTOR live = set->live[half]; live; live &= live - 1)
+            {
+                UINT32 e = set->owner[ half * 64 + CRC_Ctz( live ) ];
+
+                set->owner[ count ] = e;
+                set->slot[ e ]      = count;
+                count++;
+            }
+        }
+
+        set->live[0] = (count == 64) ? ~0ULL : ((1ULL << count) - 1);
+        set->live[1] = 0;
+        set->next    = count;
+    }
+
+    UINT32 s = set->next++;
+
+    set->owner[ s ]         = entry;
+    set->slot[ entry ]      = s;
+    set->live[ s >> 6 ]    |= 1ULL << (s & 63);
+}
+
+void LLC_MRC::Access( Addr_t paddr, UINT32 accessType )
+{
+    Addr_t line = paddr >> lineShift;
+
+    writebacks += (accessType == ACCESS_WRITEBACK);
+
+    for(UINT32 l=0; l<numLevels; l++)
+    {
+        LLC_MRC_SET *set   = &sets[l][ line & ((minSets << l) - 1) ];
+        BITVECTOR    match = CRC_MatchTags( set->keys, LLC_MRC_MAX_ASSOC, line ) & set->valid;
+
+        if( match )
+        {
+            UINT32 e = CRC_Ctz( match );
+            UINT32 s = set->slot[ e ];
+
+            depths[l][ accessType ][ Depth( set, s ) ]++;
+
+            // Writeback hits leave the LRU order alone, as in CRC_CACHE
+            if( accessType != ACCESS_WRITEBACK )
+            {
+                set->live[ s >> 6 ] &= ~(1ULL << (s & 63));
+                MakeMRU( set, e );
+            }
+            continue;
+        }
+
+        depths[l][ accessType ][ LLC_MRC_MAX_ASSOC ]++;
+
+        UINT32 e;
+
+        if( set->valid == ~0ULL )
+        {
+            // Drop the line at the bottom of the stack
+            UINT32 s = set->live[0] ? CRC_Ctz( set->live[0] ) : 64 + CRC_Ctz( set->live[1] );
+
+            e = set->owner[ s ];
+            set->live[ s >> 6 ] &= ~(1ULL << (s & 63));
+        }
+        else
+        {
+            e = CRC_Ctz( ~set->valid );
+            set->valid |= 1ULL << e;
+        }
+
+        set->keys[ e ] = line;
+        MakeMRU( set, e );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// A cache with 'a' ways misses on every access found at depth 'a' or         //
+// deeper, so the misses per associativity are suffix sums of the depth       //
+// histogram. Demand accesses are instruction fetches, loads and stores, as   //
+// in the per-thread CRC_CACHE statistics.                                    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+ostream & LLC_MRC::PrintStats( ostream &out )
+{
+    out<<"=========================================================="<<endl;
+    out<<"==== LRU Miss Ratio Curves                            ===="<<endl;
+    out<<"=========================================================="<<endl;
+    out<<endl;
+    if( writebacks != 0 )
+    {
+        out<<"Approximate: "<<writebacks<<" writebacks. A writeback is left at its stack depth, but a CRC_CACHE smaller"<<endl;
+        out<<"than that depth refills it at MRU, so rows can differ from a CRC_CACHE LRU run (exact without writebacks)."<<endl;
+        out<<endl;
+    }
+    out<<"Sets\tAssoc\tSizeKB\tAccesses\tMisses\tMissRate\tDemandAccesses\tDemandMisses\tDemandMissRate"<<endl;
+
+    for(UINT32 l=0; l<numLevels; l++)
+    {
+        UINT32  numsets = minSets << l;
+        COUNTER all[ LLC_MRC_MAX_ASSOC + 1 ];
+        COUNTER demand[ LLC_MRC_MAX_ASSOC + 1 ];
+
+        for(UINT32 d=0; d<=LLC_MRC_MAX_ASSOC; d++)
+        {
+            all[d]    = 0;
+            demand[d] = 0;
+
+            for(UINT32 a=0; a<ACCESS_MAX; a++)
+            {
+                all[d] += depths[l][a][d];
+                if( a <= ACCESS_STORE ) demand[d] += depths[l][a][d];
+            }
+        }
+
+        COUNTER totAll = 0, totDemand = 0;
+
+        for(UINT32 d=0; d<=LLC_MRC_MAX_ASSOC; d++)
+        {
+            totAll    += all[d];
+            totDemand += demand[d];
+        }
+
+        COUNTER missAll    = totAll;
+        COUNTER missDemand = totDemand;
+
+        for(UINT32 assoc=1; assoc<=LLC_MRC_MAX_ASSOC; assoc++)
+        {
+            missAll    -= all[ assoc - 1 ];
+            missDemand -= demand[ assoc - 1 ];
+
+            out<<numsets<<"\t"<<assoc<<"\t"<<((COUNTER) numsets * assoc << lineShift) / 1024
+               <<"\t"<<totAll<<"\t"<<missAll<<"\t"<<(totAll ? (double) missAll / (double) totAll * 100.0 : 0.0)
+               <<"\t"<<totDemand<<"\t"<<missDemand<<"\t"<<(totDemand ? (double) missDemand / (double) totDemand * 100.0 : 0.0)
+               <<endl;
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,77 @@
+#ifndef LLC_MRC_H
+#define LLC_MRC_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// One-pass LRU miss ratio curves (Mattson stack simulation). For every       //
+// power of two set count in a range, each set keeps the LRU stack of its     //
+// 64 most recent lines; an access at stack depth d hits in every cache of    //
+// that set count with more than d ways. One replay of the LLC stream thus    //
+// gives the LRU misses of all associativities 1-64 at all set counts.        //
+//                                                                            //
+// The stack order is kept as an order statistic over recency slots: each     //
+// resident line holds a slot number that grows with recency, and a line's    //
+// depth is the number of live slots above its own, two popcounts over a      //
+// 128-bit mask. Slots are renumbered once they run out, at most every 64     //
+// accesses to the set, so an access costs O(1) per set count apart from      //
+// the tag search.                                                            //
+//                                                                            //
+// CRC_CACHE does not update the replacement state on writeback hits. The     //
+// curves model this by leaving a writeback's line at its stack depth; a      //
+// cache smaller than that depth would have refilled the line at MRU          //
+// instead, so curves for streams with writebacks are approximate: close      //
+// to, not identical with, CRC_CACHE's LRU. PrintStats says so.               //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "utils.h"
+#include "crc_cache_defs.h"
+#include "llc_trace.h"
+
+#define LLC_MRC_MAX_ASSOC       64           // deepest stack position tracked
+#define LLC_MRC_SLOTS           128          // recency slots per set
+#define LLC_MRC_MIN_SETS        1            // default set count range
+#define LLC_MRC_MAX_SETS        16384
+
+typedef struct
+{
+    Addr_t                  keys[ LLC_MRC_MAX_ASSOC ]   __attribute__(( aligned( 32 ) ));   // line addresses
+    BITVECTOR               valid;                        // entries in use
+    BITVECTOR               live[ 2 ];                    // recency slots in use
+    UINT8                   slot[ LLC_MRC_MAX_ASSOC ];    // entry -> recency slot
+    UINT8                   owner[ LLC_MRC_SLOTS ];       // recency slot -> entry
+    UINT32                  next;                         // next free slot, the MRU position
+} LLC_MRC_SET;
+
+class LLC_MRC
+{
+  private:
+
+    UINT32                  lineShift;
+    UINT32                  minSets;
+    UINT32                  numLevels;       // set counts minSets, 2*minSets, ...
+    COUNTER                 writebacks;      // accesses the curves only approximate
+
+    LLC_MRC_SET             **sets;          // per level
+    COUNTER                 (*depths)[ ACCESS_MAX ][ LLC_MRC_MAX_ASSOC + 1 ];   // per level; last bucket: not in the stack
+
+  public:
+
+    // Set counts must be powers of two
+    LLC_MRC( UINT32 linesize, UINT32 _minSets, UINT32 maxSets );
+    ~LLC_MRC();
+
+    void   Access( Addr_t paddr, UINT32 accessType );
+    void   Access( const LLC_ACCESS &access ) { Access( access.paddr, access.accessType ); }
+
+    // Misses of every (set count, associativity) pair as a table
+    ostream & PrintStats( ostream &out );
+
+  private:
+
+    UINT32 Depth( const LLC_MRC_SET *set, UINT32 s );
+    void   MakeMRU( LLC_MRC_SET *set, UINT32 entry );
+};
+
+#endif
@@ -0,0 +1,408 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "crc_simd.h"
+#include "llc_opt.h"
+
+extern string crc_access_names[];
+
+LLC_NEXT_USE::LLC_NEXT_USE( UINT32 linesize )
+{
+    lineShift = CRC_FloorLog2( linesize );
+    fd        = -1;
+    chunk     = new unsigned long long[ LLC_OPT_CHUNK ];
+    fill      = 0;
+    pos       = LLC_OPT_CHUNK;
+    count     = 0;
+    consumed  = 0;
+}
+
+LLC_NEXT_USE::~LLC_NEXT_USE()
+{
+    if( fd >= 0 ) close( fd );
+
+    delete [] chunk;
+}
+
+bool LLC_NEXT_USE::Create( const char *dir )
+{
+    char path[ LLC_OPT_PATH ];
+    snprintf( path, sizeof(path), "%s/llc-opt-XXXXXX", dir );
+
+    fd = mkstemp( path );
+
+    if( fd < 0 )
+    {
+        cerr << "LLC_NEXT_USE: cannot create a side file in " << dir << endl;
+        return false;
+    }
+
+    // Gone with the process, however it ends
+    unlink( path );
+
+    return true;
+}
+
+void LLC_NEXT_USE::WriteChunk()
+{
+    size_t bytes = (size_t) fill * sizeof(unsigned long long);
+
+    if( pwrite( fd, chunk, bytes, (off_t) count * sizeof(unsigned long long) ) != (ssize_t) bytes )
+    {
+        cerr << "LLC_NEXT_USE: cannot write the side file" << endl;
+        exit( 1 );
+    }
+
+    count += fill;
+    fill   = 0;
+}
+
+void LLC_NEXT_USE::ReadChunk()
+{
+    assert( consumed < count );
+
+    UINT32 n     = (count - consumed < LLC_OPT_CHUNK) ? (UINT32) (count - consumed) : LLC_OPT_CHUNK;
+    size_t bytes = (size_t) n * sizeof(unsigned long long);
+
+    if( pread( fd, chunk, bytes, (off_t) consumed * sizeof(unsigned long long) ) != (ssize_t) bytes )
+    {
+        cerr << "LLC_NEXT_USE: cannot read the side file" << endl;
+        exit( 1 );
+    }
+
+    consumed += n;
+    pos       = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Last access seen to each line, by line address, for the backward pass:     //
+// open addressing with linear probing, doubled at half load.                 //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+class LLC_OPT_TABLE
+{
+  private:
+
+    Addr_t                  *lines;
+    COUNTER                 *last;
+    size_t                  capacity;
+    size_t                  used;
+
+  public:
+
+    LLC_OPT_TABLE()
+    {
+        capacity = 1 << 16;
+        used     = 0;
+        lines    = new Addr_t[ capacity ];
+        last     = new COUNTER[ capacity ];
+
+        for(size_t i=0; i<capacity; i++) lines[i] = LLC_OPT_NO_LINE;
+    }
+
+    ~LLC_OPT_TABLE()
+    {
+        delete [] lines;
+        delete [] last;
+    }
+
+    // Returns the access to 'line' seen last, LLC_OPT_NEVER if none, and
+    // makes 'index' the last one
+    COUNTER Swap( Addr_t line, COUNTER index )
+    {
+        size_t i = Slot( line );
+
+        if( lines[i] == LLC_OPT_NO_LINE )
+        {
+            lines[i] = line;
+            last[i]  = index;
+
+            if( ++used * 2 > capacity ) Grow();
+
+            return LLC_OPT_NEVER;
+        }
+
+        COUNTER next = last[i];
+        last[i] = index;
+
+        return next;
+    }
+
+  private:
+
+    size_t Slot( Addr_t line )
+    {
+        size_t i = (size_t) ((line * 0x9e3779b97f4a7c15ULL) >> 20) & (capacity - 1);
+
+        while( lines[i] != LLC_OPT_NO_LINE && lines[i] != line )
+        {
+            i = (i + 1) & (capacity - 1);
+        }
+
+        return i;
+    }
+
+    void Grow()
+    {
+        Addr_t  *oldLines = lines;
+        COUNTER *oldLast  = last;
+        size_t  oldCapacity = capacity;
+
+        capacity *= 2;
+        lines     = new Addr_t[ capacity ];
+        last      = new COUNTER[ capacity ];
+
+        for(size_t i=0; i<capacity; i++) lines[i] = LLC_OPT_NO_LINE;
+
+        for(size_t i=0; i<oldCapacity; i++)
+        {
+            if( oldLines[i] == LLC_OPT_NO_LINE ) continue;
+
+            size_t j = Slot( oldLines[i] );
+            lines[j] = oldLines[i];
+            last[j]  = oldLast[i];
+        }
+
+        delete [] oldLines;
+        delete [] oldLast;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The backward pass: chunks from last to first, each read, turned from       //
+// line addresses into next uses from its end, and written back in place.     //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool LLC_NEXT_USE::Finish()
+{
+    if( fill != 0 ) WriteChunk();
+
+    LLC_OPT_TABLE table;
+    COUNTER       chunks = (count + LLC_OPT_CHUNK - 1) / LLC_OPT_CHUNK;
+
+    for(COUNTER k=chunks; k>0; k--)
+    {
+        COUNTER first = (k - 1) * LLC_OPT_CHUNK;
+        UINT32  n     = (count - first < LLC_OPT_CHUNK) ? (UINT32) (count - first) : LLC_OPT_CHUNK;
+        size_t  bytes = (size_t) n * sizeof(unsigned long long);
+        off_t   at    = (off_t) first * sizeof(unsigned long long);
+
+        if( pread( fd, chunk, bytes, at ) != (ssize_t) bytes )
+        {
+            cerr << "LLC_NEXT_USE: cannot read the side file" << endl;
+            return false;
+        }
+
+        for(UINT32 i=n; i>0; i--)
+        {
+            chunk[ i - 1 ] = table.Swap( chunk[ i - 1 ], first + i - 1 );
+        }
+
+        if( pwrite( fd, chunk, bytes, at ) != (ssize_t) bytes )
+        {
+            cerr << "LLC_NEXT_USE: cannot write the side file" << endl;
+            return false;
+        }
+    }
+
+    pos      = LLC_OPT_CHUNK;
+    consumed = 0;
+
+    return true;
+}
+
+LLC_OPT::LLC_OPT( LLC_NEXT_USE *_nextUse, UINT32 _threads, UINT32 _linesize,
+                  const UINT32 *sizeKB, const UINT32 *assoc, UINT32 numConfigs )
+{
+    nextUse   = _nextUse;
+    threads   = _threads;
+    linesize  = _linesize;
+    lineShift = CRC_FloorLog2( linesize );
+    numCaches = numConfigs;
+    caches    = new LLC_OPT_CACHE[ numCaches ];
+    accesses  = 0;
+
+    for(UINT32 c=0; c<numCaches; c++)
+    {
+        LLC_OPT_CACHE *cache = &caches[c];
+
+        assert( assoc[c] <= 64 );
+
+        cache->numsets   = (UINT32) ((COUNTER) sizeKB[c] * 1024 / (linesize * assoc[c]));
+        cache->assoc     = assoc[c];
+        cache->stride    = (assoc[c] + 3) & ~3;
+        cache->indexMask = (1 << CRC_FloorLog2( cache->numsets )) - 1;
+        cache->wayMask   = (assoc[c] == 64) ? ~0ULL : ((1ULL << assoc[c]) - 1);
+        cache->bypasses  = 0;
+
+        size_t entries = (size_t) cache->numsets * cache->stride;
+
+        if( posix_memalign( (void **) &cache->lines, 32, entries * sizeof(Addr_t) ) != 0 ||
+            posix_memalign( (void **) &cache->keys, 32, entries * sizeof(unsigned long long) ) != 0 )
+        {
+            cerr << "LLC_OPT: cannot allocate the OPT cache" << endl;
+            exit( 1 );
+        }
+
+        for(size_t i=0; i<entries; i++)
+        {
+            cache->lines[i] = LLC_OPT_NO_LINE;
+            cache->keys[i]  = (i % cache->stride < cache->assoc) ? 0 : LLC_OPT_PAD_KEY;
+        }
+
+        for(UINT32 a=0; a<ACCESS_MAX; a++)
+        {
+            cache->lookups[a] = new COUNTER[ threads ];
+            cache->misses[a]  = new COUNTER[ threads ];
+
+            memset( cache->lookups[a], 0, threads * sizeof(COUNTER) );
+            memset( cache->misses[a], 0, threads * sizeof(COUNTER) );
+        }
+    }
+}
+
+LLC_OPT::~LLC_OPT()
+{
+    for(UINT32 c=0; c<numCaches; c++)
+    {
+        free( caches[c].lines );
+        free( caches[c].keys );
+
+        for(UINT32 a=0; a<ACCESS_MAX; a++)
+        {
+            delete [] caches[c].lookups[a];
+            delete [] caches[c].misses[a];
+        }
+    }
+
+    delete [] caches;
+    delete nextUse;
+}
+
+void LLC_OPT::Access( const LLC_ACCESS &access )
+{
+    Addr_t             line = access.paddr >> lineShift;
+    unsigned long long key  = LLC_OPT_NEVER - nextUse->Next();
+
+    accesses++;
+
+    for(UINT32 c=0; c<numCaches; c++)
+    {
+        Lookup( &caches[c], line, key, access.tid, access.accessType );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// One access to an OPT cache. A hit renews the line's next use; a miss       //
+// fills a free way, else replaces the line reused furthest in the future,    //
+// the smallest key, unless the new line itself is reused later still.        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+inline void LLC_OPT::Lookup( LLC_OPT_CACHE *cache, Addr_t line, unsigned long long key, UINT32 tid, UINT32 accessType )
+{
+    size_t             base  = (size_t) (line & cache->indexMask) * cache->stride;
+    Addr_t             *set  = &cache->lines[ base ];
+    unsigned long long *keys = &cache->keys[ base ];
+
+    cache->lookups[ accessType ][ tid ]++;
+
+    BITVECTOR hit = CRC_MatchTags( set, cache->stride, line );
+
+    if( hit )
+    {
+        keys[ CRC_Ctz( hit ) ] = key;
+        return;
+    }
+
+    cache->misses[ accessType ][ tid ]++;
+
+    BITVECTOR empty = CRC_MatchTags( set, cache->stride, LLC_OPT_NO_LINE ) & cache->wayMask;
+    UINT32    way;
+
+    if( empty )
+    {
+        way = CRC_Ctz( empty );
+    }
+    else
+    {
+        way = CRC_MinIndex( keys, cache->stride );
+
+        if( LLC_OPT_BYPASS && key <= keys[ way ] )
+        {
+            cache->bypasses++;
+            return;
+        }
+    }
+
+    set[ way ]  = line;
+    keys[ way ] = key;
+}
+
+ostream & LLC_OPT::PrintStats( ostream &out, UINT32 config )
+{
+    LLC_OPT_CACHE *cache = &caches[ config ];
+    COUNTER       totLookups, totMisses;
+
+    out<<"=========================================================="<<endl;
+    out<<"=========== Belady OPT Statistics ========================"<<endl;
+    out<<"=========================================================="<<endl;
+    out<<endl;
+    out<<"OPT Configuration: "<<endl;
+    out<<"\tCache Size:     "<<((COUNTER) cache->numsets*cache->assoc*linesize/1024)<<"K"<<endl;
+    out<<"\tAssociativity:  "<<cache->assoc<<endl;
+    out<<"\tBypass:         "<<(LLC_OPT_BYPASS ? "yes (MIN)" : "no")<<endl;
+    out<<endl;
+    out<<"OPT Cache Statistics: "<<endl;
+    out<<endl;
+
+    for(UINT32 a=0; a<ACCESS_MAX; a++)
+    {
+        totLookups = 0;
+        totMisses  = 0;
+
+        for(UINT32 t=0; t<threads; t++)
+        {
+            totLookups += cache->lookups[a][t];
+            totMisses  += cache->misses[a][t];
+        }
+
+        if( totLookups )
+        {
+            out<<"\t"<<crc_access_names[a]<<" Accesses:   "<<totLookups<<endl;
+            out<<"\t"<<crc_access_names[a]<<" Misses:     "<<totMisses<<endl;
+            out<<"\t"<<crc_access_names[a]<<" Hits:       "<<totLookups - totMisses<<endl;
+            out<<"\t"<<crc_access_names[a]<<" Miss Rate:  "<<((double)totMisses/(double)totLookups)*100.0<<endl;
+            out<<endl;
+        }
+    }
+
+    out<<"\tBypassed fills: "<<cache->bypasses<<endl;
+    out<<endl;
+    out<<"OPT Per Thread Demand Reference Statistics: "<<endl;
+
+    for(UINT32 t=0; t<threads; t++)
+    {
+        totLookups = 0;
+        totMisses  = 0;
+
+        for(UINT32 a=0; a<=ACCESS_STORE; a++)
+        {
+            totLookups += cache->lookups[a][t];
+            totMisses  += cache->misses[a][t];
+        }
+
+        if( totLookups )
+        {
+            out<<"\tThread: "<<t<<" Lookups: "<<totLookups<<" Misses: "<<totMisses
+               <<" Miss Rate: "<<((double)totMisses/(double)totLookups)*100.0<<endl;
+        }
+    }
+    out<<endl;
+
+    return out;
+}
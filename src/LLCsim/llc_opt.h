@@ -0,0 +1,135 @@
+#ifndef LLC_OPT_H
+#define LLC_OPT_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Belady's OPT for an LLC stream, as the bound a replacement policy is       //
+// measured against. OPT needs the future, so the stream is read twice:       //
+//                                                                            //
+//   LLC_NEXT_USE  the first pass records the line address of every access    //
+//                 in a side file, in chunks of LLC_OPT_CHUNK accesses. A     //
+//                 pass over the chunks from last to first then overwrites    //
+//                 each address with the index of the next access to the      //
+//                 same line. The side file is read back in order during      //
+//                 the second pass. Memory stays at one chunk plus one        //
+//                 table entry per distinct line, however long the stream.    //
+//   LLC_OPT       the second pass simulates one OPT cache per LLC            //
+//                 configuration. Every line is stored with its next use;     //
+//                 a miss evicts the line used furthest in the future, a      //
+//                 SIMD min over the per-set keys (LLC_OPT_NEVER - next use). //
+//                 With LLC_OPT_BYPASS, an incoming line is not filled if it  //
+//                 is reused later than every line in the set. That makes     //
+//                 the bound MIN.                                             //
+//                                                                            //
+// Sets are indexed as CRC_CACHE indexes them. Every access, writebacks       //
+// included, updates the next use of its line, so OPT's counts sit beside     //
+// the ones of the replayed policy (llcsim -opt).                             //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "utils.h"
+#include "crc_cache_defs.h"
+#include "llc_trace.h"
+
+#define LLC_OPT_CHUNK           (1 << 20)                 // accesses per side file chunk
+#define LLC_OPT_NEVER           (1ULL << 62)              // next use of a line never reused
+#define LLC_OPT_NO_LINE         (~(Addr_t) 0)             // free way
+#define LLC_OPT_PAD_KEY         (~0ULL >> 1)              // padding ways, never the min
+#define LLC_OPT_BYPASS          1                         // OPT may leave a miss unfilled
+#define LLC_OPT_PATH            4096
+
+class LLC_NEXT_USE
+{
+  private:
+
+    UINT32                  lineShift;
+    int                     fd;              // side file, unlinked once created
+    unsigned long long      *chunk;
+    UINT32                  fill;            // recording: entries in 'chunk'
+    UINT32                  pos;             // reading: next entry of 'chunk'
+    COUNTER                 count;           // accesses recorded
+    COUNTER                 consumed;        // next uses handed out
+
+  public:
+
+    LLC_NEXT_USE( UINT32 linesize );
+    ~LLC_NEXT_USE();
+
+    // Creates the side file in 'dir'
+    bool   Create( const char *dir );
+
+    // First pass
+    void   Access( const LLC_ACCESS &access )
+    {
+        chunk[ fill++ ] = access.paddr >> lineShift;
+
+        if( fill == LLC_OPT_CHUNK ) WriteChunk();
+    }
+
+    // Turns the recorded lines into next uses and rewinds the side file
+    bool   Finish();
+
+    // Second pass: the next use of each access in turn, LLC_OPT_NEVER for
+    // the last access to a line
+    COUNTER Next()
+    {
+        if( pos == LLC_OPT_CHUNK ) ReadChunk();
+
+        return chunk[ pos++ ];
+    }
+
+    COUNTER Accesses() { return count; }
+
+  private:
+
+    void   WriteChunk();
+    void   ReadChunk();
+};
+
+// One OPT cache, stored as CRC_CACHE stores its tags: 'stride' ways per set
+typedef struct
+{
+    UINT32                  numsets;
+    UINT32                  assoc;
+    UINT32                  stride;          // assoc rounded up to 4
+    UINT32                  indexMask;
+    BITVECTOR               wayMask;
+    Addr_t                  *lines;          // line addresses, LLC_OPT_NO_LINE if free
+    unsigned long long      *keys;           // LLC_OPT_NEVER - next use
+    COUNTER                 *lookups[ ACCESS_MAX ];   // per thread
+    COUNTER                 *misses[ ACCESS_MAX ];
+    COUNTER                 bypasses;
+} LLC_OPT_CACHE;
+
+class LLC_OPT
+{
+  private:
+
+    LLC_NEXT_USE            *nextUse;
+    UINT32                  threads;
+    UINT32                  linesize;
+    UINT32                  lineShift;
+    UINT32                  numCaches;
+    LLC_OPT_CACHE           *caches;
+    COUNTER                 accesses;
+
+  public:
+
+    // One OPT cache per configuration; takes ownership of 'nextUse'
+    LLC_OPT( LLC_NEXT_USE *_nextUse, UINT32 _threads, UINT32 _linesize,
+             const UINT32 *sizeKB, const UINT32 *assoc, UINT32 numConfigs );
+    ~LLC_OPT();
+
+    void   Access( const LLC_ACCESS &access );
+
+    // The OPT block of configuration 'config', formatted as CRC_CACHE's
+    // statistics
+    ostream & PrintStats( ostream &out, UINT32 config );
+
+  private:
+
+    void   Lookup( LLC_OPT_CACHE *cache, Addr_t line, unsigned long long key, UINT32 tid, UINT32 accessType );
+};
+
+#endif
@@ -0,0 +1,424 @@
+#include <cstring>
+#include <ctime>
+#include <sched.h>
+#include <unistd.h>
+#include "llc_pipeline.h"
+
+static COUNTER NowNs()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (COUNTER) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+LLC_TRACE_PIPELINE::LLC_TRACE_PIPELINE( gzFile _file, UINT32 _version, UINT32 inflaters )
+{
+    file         = _file;
+    version      = _version;
+    numInflaters = (inflaters == 0) ? 1 : (inflaters > LLC_PIPELINE_MAX_INFLATERS ? LLC_PIPELINE_MAX_INFLATERS : inflaters);
+    stopping     = false;
+    finished     = false;
+    current      = NULL;
+    pos          = 0;
+
+    memset( counters, 0, sizeof(counters) );
+    memset( &endBlock, 0, sizeof(endBlock) );
+    endBlock.last = true;
+
+    // Enough blocks to fill every queue between fetch and the consumer
+    numBlocks = numInflaters * 2 * LLC_PIPELINE_DEPTH + 2;
+    blocks    = new LLC_PIPELINE_BLOCK[ numBlocks ];
+
+    UINT32 rawBytes = (version == 1) ? LLC_TRACE_BLOCK * sizeof(LLC_TRACE_RECORD_V1)
+                                     : compressBound( LLC_TRACE_BLOCK * sizeof(LLC_TRACE_RECORD) );
+
+    freeBlocks = new SPSC_QUEUE<LLC_PIPELINE_BLOCK *>( numBlocks );
+    decoded    = new SPSC_QUEUE<LLC_PIPELINE_BLOCK *>( numBlocks );
+
+    for(UINT32 b=0; b<numBlocks; b++)
+    {
+        blocks[b].compressedSize  = rawBytes;
+        blocks[b].compressed      = new Bytef[ rawBytes ];
+        blocks[b].compressedBytes = 0;
+        blocks[b].records         = (version == 1) ? NULL : new LLC_TRACE_RECORD[ LLC_TRACE_BLOCK ];
+        blocks[b].accesses        = new LLC_ACCESS[ LLC_TRACE_BLOCK ];
+        blocks[b].count           = 0;
+        blocks[b].last            = false;
+
+        freeBlocks->Push( &blocks[b] );
+    }
+
+    for(UINT32 i=0; i<numInflaters; i++)
+    {
+        toInflate[i] = new SPSC_QUEUE<LLC_PIPELINE_BLOCK *>( LLC_PIPELINE_DEPTH );
+        inflated[i]  = new SPSC_QUEUE<LLC_PIPELINE_BLOCK *>( LLC_PIPELINE_DEPTH );
+    }
+
+    startNs       = NowNs();
+    simulateSince = 0;
+    numThreads    = 0;
+
+    // fetch, the inflaters, decode
+    for(UINT32 t=0; t<numInflaters + 2; t++)
+    {
+        workers[t].pipeline = this;
+        workers[t].index    = (t == 0 || t == numInflaters + 1) ? 0 : t - 1;
+
+        void *(*body)( void * ) = (t == 0) ? FetchThread : (t == numInflaters + 1) ? DecodeThread : InflateThread;
+
+        pthread_create( &threads[t], NULL, body, &workers[t] );
+        numThreads++;
+    }
+
+    // Pin the stages to the highest cores when the consumer and whatever
+    // it feeds (see LLC_FANOUT, which uses the lowest) still have room
+    long cores = sysconf( _SC_NPROCESSORS_ONLN );
+
+    if( cores > (long) (2 * numThreads) )
+    {
+        for(UINT32 t=0; t<numThreads; t++)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO( &cpus );
+            CPU_SET( cores - 1 - t, &cpus );
+            pthread_setaffinity_np( threads[t], sizeof(cpus), &cpus );
+        }
+    }
+}
+
+LLC_TRACE_PIPELINE::~LLC_TRACE_PIPELINE()
+{
+    __atomic_store_n( &stopping, true, __ATOMIC_RELEASE );
+
+    for(UINT32 t=0; t<numThreads; t++)
+    {
+        pthread_join( threads[t], NULL );
+    }
+
+    for(UINT32 b=0; b<numBlocks; b++)
+    {
+        delete [] blocks[b].compressed;
+        delete [] blocks[b].records;
+        delete [] blocks[b].accesses;
+    }
+
+    for(UINT32 i=0; i<numInflaters; i++)
+    {
+        delete toInflate[i];
+        delete inflated[i];
+    }
+
+    delete freeBlocks;
+    delete decoded;
+    delete [] blocks;
+
+    gzclose( file );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Blocking queue operations of the stages. A wait counts as one stall of     //
+// 'stage'; both give up (false) once the pipeline is being torn down.        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool LLC_TRACE_PIPELINE::Push( SPSC_QUEUE<LLC_PIPELINE_BLOCK *> *queue, LLC_PIPELINE_BLOCK *block, UINT32 stage )
+{
+    if( queue->TryPush( block ) ) return true;
+
+    __atomic_add_fetch( &counters[ stage ].stalls, 1, __ATOMIC_RELAXED );
+
+    while( !queue->TryPush( block ) )
+    {
+        if( __atomic_load_n( &stopping, __ATOMIC_ACQUIRE ) ) return false;
+        sched_yield();
+    }
+
+    return true;
+}
+
+bool LLC_TRACE_PIPELINE::Pop( SPSC_QUEUE<LLC_PIPELINE_BLOCK *> *queue, LLC_PIPELINE_BLOCK **block, UINT32 stage )
+{
+    if( queue->TryPop( block ) ) return true;
+
+    __atomic_add_fetch( &counters[ stage ].stalls, 1, __ATOMIC_RELAXED );
+
+    while( !queue->TryPop( block ) )
+    {
+        if( __atomic_load_n( &stopping, __ATOMIC_ACQUIRE ) ) return false;
+        sched_yield();
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Consumer side: returns the finished block to the pool and takes the next   //
+// decoded one. The time in between is the simulation's.                      //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool LLC_TRACE_PIPELINE::NextBlock()
+{
+    if( finished ) return false;
+
+    COUNTER now = NowNs();
+
+    if( current != NULL )
+    {
+        counters[ LLC_STAGE_SIMULATE ].blocks++;
+        counters[ LLC_STAGE_SIMULATE ].records += current->count;
+        counters[ LLC_STAGE_SIMULATE ].busyNs  += now - simulateSince;
+
+        freeBlocks->Push( current );
+        current = NULL;
+    }
+
+    LLC_PIPELINE_BLOCK *block = NULL;
+
+    if( !Pop( decoded, &block, LLC_STAGE_SIMULATE ) || block->last )
+    {
+        finished = true;
+        return false;
+    }
+
+    current       = block;
+    pos           = 0;
+    simulateSince = NowNs();
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Stage bodies                                                               //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool LLC_TRACE_PIPELINE::Fetch( LLC_PIPELINE_BLOCK *block )
+{
+    if( version == 1 )
+    {
+        int bytes = gzread( file, block->compressed, LLC_TRACE_BLOCK * sizeof(LLC_TRACE_RECORD_V1) );
+
+        if( bytes <= 0 ) return false;
+
+        // A trailing partial record is the end of the stream
+        block->compressedBytes = bytes;
+        block->count           = bytes / sizeof(LLC_TRACE_RECORD_V1);
+
+        return block->count != 0;
+    }
+
+    LLC_TRACE_BLOCK_HEADER header;
+
+    if( gzread( file, &header, sizeof(header) ) != (int) sizeof(header) )
+    {
+        return false;
+    }
+
+    if( header.records > LLC_TRACE_BLOCK )
+    {
+        cerr << "LLC_TRACE_READER: corrupt block header" << endl;
+        return false;
+    }
+
+    if( header.compressedBytes > block->compressedSize )
+    {
+        delete [] block->compressed;
+        block->compressedSize = header.compressedBytes;
+        block->compressed     = new Bytef[ block->compressedSize ];
+    }
+
+    if( gzread( file, block->compressed, header.compressedBytes ) != (int) header.compressedBytes )
+    {
+        cerr << "LLC_TRACE_READER: truncated block" << endl;
+        return false;
+    }
+
+    block->compressedBytes = header.compressedBytes;
+    block->count           = header.records;
+
+    return true;
+}
+
+bool LLC_TRACE_PIPELINE::Inflate( LLC_PIPELINE_BLOCK *block )
+{
+    // Version 1 streams are inflated by gzip as they are fetched
+    if( version == 1 ) return true;
+
+    uLongf rawBytes = block->count * sizeof(LLC_TRACE_RECORD);
+
+    if( uncompress( (Bytef *) block->records, &rawBytes, block->compressed, block->compressedBytes ) != Z_OK
+        || rawBytes != block->count * sizeof(LLC_TRACE_RECORD) )
+    {
+        cerr << "LLC_TRACE_READER: corrupt block" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+void LLC_TRACE_PIPELINE::Decode( LLC_PIPELINE_BLOCK *block, COUNTER firstSeq )
+{
+    if( version == 1 )
+    {
+        const LLC_TRACE_RECORD_V1 *raw = (const LLC_TRACE_RECORD_V1 *) block->compressed;
+
+        for(UINT32 i=0; i<block->count; i++)
+        {
+            block->accesses[i].PC         = raw[i].PC;
+            block->accesses[i].paddr      = raw[i].paddr;
+            block->accesses[i].seq        = firstSeq + i;
+            block->accesses[i].tid        = raw[i].tid;
+            block->accesses[i].accessType = raw[i].accessType;
+        }
+        return;
+    }
+
+    for(UINT32 i=0; i<block->count; i++)
+    {
+        const LLC_TRACE_RECORD *rec = &block->records[i];
+
+        block->accesses[i].PC         = rec->PC;
+        block->accesses[i].paddr      = rec->paddr;
+        block->accesses[i].seq        = rec->seq;
+        block->accesses[i].tid        = rec->tid;
+        block->accesses[i].accessType = rec->accessType;
+    }
+}
+
+void LLC_TRACE_PIPELINE::FetchStage()
+{
+    LLC_PIPELINE_COUNTERS *stats = &counters[ LLC_STAGE_FETCH ];
+
+    for(COUNTER b=0; ; b++)
+    {
+        LLC_PIPELINE_BLOCK *block = NULL;
+
+        if( !Pop( freeBlocks, &block, LLC_STAGE_FETCH ) ) return;
+
+        COUNTER start = NowNs();
+        bool    ok    = Fetch( block );
+
+        stats->busyNs += NowNs() - start;
+
+        if( !ok )
+        {
+            // Every inflater gets the end marker; decode stops at the one
+            // in stream order. The unused block stays out of the pool, whose
+            // only producer is the consumer.
+            for(UINT32 i=0; i<numInflaters; i++)
+            {
+                if( !Push( toInflate[ (b + i) % numInflaters ], &endBlock, LLC_STAGE_FETCH ) ) return;
+            }
+            return;
+        }
+
+        stats->blocks++;
+        stats->records += block->count;
+
+        if( !Push( toInflate[ b % numInflaters ], block, LLC_STAGE_FETCH ) ) return;
+    }
+}
+
+void LLC_TRACE_PIPELINE::InflateStage( UINT32 inflater )
+{
+    LLC_PIPELINE_COUNTERS *stats = &counters[ LLC_STAGE_INFLATE ];
+
+    while( true )
+    {
+        LLC_PIPELINE_BLOCK *block = NULL;
+
+        if( !Pop( toInflate[ inflater ], &block, LLC_STAGE_INFLATE ) ) return;
+
+        if( !block->last )
+        {
+            COUNTER start = NowNs();
+
+            // A corrupt block ends the stream as an empty one
+            if( !Inflate( block ) ) block->count = 0;
+
+            __atomic_add_fetch( &stats->busyNs, NowNs() - start, __ATOMIC_RELAXED );
+            __atomic_add_fetch( &stats->blocks, 1, __ATOMIC_RELAXED );
+            __atomic_add_fetch( &stats->records, block->count, __ATOMIC_RELAXED );
+        }
+
+        if( !Push( inflated[ inflater ], block, LLC_STAGE_INFLATE ) || block->last ) return;
+    }
+}
+
+void LLC_TRACE_PIPELINE::DecodeStage()
+{
+    LLC_PIPELINE_COUNTERS *stats = &counters[ LLC_STAGE_DECODE ];
+    COUNTER                seq   = 1;
+
+    for(COUNTER b=0; ; b++)
+    {
+        LLC_PIPELINE_BLOCK *block = NULL;
+
+        if( !Pop( inflated[ b % numInflaters ], &block, LLC_STAGE_DECODE ) ) return;
+
+        if( !block->last )
+        {
+            COUNTER start = NowNs();
+
+            Decode( block, seq );
+            seq += block->count;
+
+            stats->busyNs += NowNs() - start;
+            stats->blocks++;
+            stats->records += block->count;
+        }
+
+        // A block that failed to inflate ends the stream
+        if( block->count == 0 ) block = &endBlock;
+
+        if( !Push( decoded, block, LLC_STAGE_DECODE ) || block->last ) return;
+    }
+}
+
+void *LLC_TRACE_PIPELINE::FetchThread( void *arg )
+{
+    ((LLC_PIPELINE_WORKER *) arg)->pipeline->FetchStage();
+    return NULL;
+}
+
+void *LLC_TRACE_PIPELINE::InflateThread( void *arg )
+{
+    LLC_PIPELINE_WORKER *worker = (LLC_PIPELINE_WORKER *) arg;
+
+    worker->pipeline->InflateStage( worker->index );
+    return NULL;
+}
+
+void *LLC_TRACE_PIPELINE::DecodeThread( void *arg )
+{
+    ((LLC_PIPELINE_WORKER *) arg)->pipeline->DecodeStage();
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Throughput of a stage is its records over its busy time, i.e. what it      //
+// could sustain on its own; the slowest stage bounds the pipeline. Inflate   //
+// sums the busy time of all inflaters.                                       //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void LLC_TRACE_PIPELINE::PrintStats( ostream &out )
+{
+    static const char *names[ LLC_STAGE_MAX ] = { "fetch", "inflate", "decode", "simulate" };
+
+    double elapsed = (double) (NowNs() - startNs) / 1e9;
+
+    out<<"Pipeline: "<<numInflaters<<" inflaters, "<<numBlocks<<" blocks, "<<elapsed<<" s"<<endl;
+    out<<"Stage\tBlocks\tRecords\tBusy(s)\tMRecords/s\tStalls"<<endl;
+
+    for(UINT32 s=0; s<LLC_STAGE_MAX; s++)
+    {
+        double busy = (double) counters[s].busyNs / 1e9;
+
+        out<<names[s]<<"\t"<<counters[s].blocks<<"\t"<<counters[s].records<<"\t"<<busy
+           <<"\t"<<(busy > 0.0 ? (double) counters[s].records / busy / 1e6 : 0.0)<<"\t"<<counters[s].stalls<<endl;
+    }
+}
@@ -0,0 +1,145 @@
+#ifndef LLC_PIPELINE_H
+#define LLC_PIPELINE_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Pipelined reading of an LLC stream (LLC_TRACE_READER::Open with            //
+// inflaters > 0). Blocks of the stream move through three stages, each on    //
+// its own host threads, before the simulation consumes them:                 //
+//                                                                            //
+//   fetch     reads the next block: for version 2 its compressed image,      //
+//             for version 1 the next LLC_TRACE_BLOCK records through gzip    //
+//   inflate   uncompresses version 2 blocks; there are 'inflaters' of        //
+//             these, block b going to inflater b % inflaters                 //
+//   decode    takes blocks back in order from the inflaters and converts     //
+//             them into LLC_ACCESS records, numbering version 1 records      //
+//                                                                            //
+// Stages are linked by bounded SPSC_QUEUEs of block pointers, and the        //
+// blocks come from a fixed pool that the consumer hands back to fetch, so    //
+// a slow stage stalls the ones before it instead of letting them run         //
+// ahead. Each stage counts its blocks, records, busy time and stalls.        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <pthread.h>
+#include <zlib.h>
+#include "llc_trace.h"
+#include "spsc_queue.h"
+
+#define LLC_PIPELINE_MAX_INFLATERS  16
+#define LLC_PIPELINE_DEPTH          4            // blocks queued per inflater
+
+typedef enum
+{
+    LLC_STAGE_FETCH    = 0,
+    LLC_STAGE_INFLATE  = 1,
+    LLC_STAGE_DECODE   = 2,
+    LLC_STAGE_SIMULATE = 3,
+    LLC_STAGE_MAX      = 4
+} LLC_PIPELINE_STAGE;
+
+// One block of the stream on its way through the stages
+typedef struct
+{
+    Bytef              *compressed;
+    UINT32             compressedSize;      // allocated
+    UINT32             compressedBytes;     // used
+    LLC_TRACE_RECORD   *records;
+    LLC_ACCESS         *accesses;
+    UINT32             count;
+    bool               last;                // end of stream marker, no records
+} LLC_PIPELINE_BLOCK;
+
+// Counters of one stage, on its own host cache line
+typedef struct
+{
+    COUNTER            blocks               __attribute__(( aligned( 64 ) ));
+    COUNTER            records;
+    COUNTER            busyNs;              // time spent working, not waiting
+    COUNTER            stalls;              // waits on an empty input or full output
+} LLC_PIPELINE_COUNTERS;
+
+class LLC_TRACE_PIPELINE;
+
+typedef struct
+{
+    LLC_TRACE_PIPELINE *pipeline;
+    UINT32             index;
+} LLC_PIPELINE_WORKER;
+
+class LLC_TRACE_PIPELINE
+{
+  private:
+
+    gzFile                              file;
+    UINT32                              version;
+    UINT32                              numInflaters;
+
+    UINT32                              numBlocks;
+    LLC_PIPELINE_BLOCK                  *blocks;
+
+    SPSC_QUEUE<LLC_PIPELINE_BLOCK *>    *freeBlocks;                            // simulate -> fetch
+    SPSC_QUEUE<LLC_PIPELINE_BLOCK *>    *toInflate[ LLC_PIPELINE_MAX_INFLATERS ];  // fetch -> inflate
+    SPSC_QUEUE<LLC_PIPELINE_BLOCK *>    *inflated[ LLC_PIPELINE_MAX_INFLATERS ];   // inflate -> decode
+    SPSC_QUEUE<LLC_PIPELINE_BLOCK *>    *decoded;                               // decode -> simulate
+
+    // End of stream marker, sent by fetch to every inflater
+    LLC_PIPELINE_BLOCK                  endBlock;
+
+    UINT32                              numThreads;
+    pthread_t                           threads[ LLC_PIPELINE_MAX_INFLATERS + 2 ];
+    LLC_PIPELINE_WORKER                 workers[ LLC_PIPELINE_MAX_INFLATERS + 2 ];
+    bool                                stopping;
+
+    LLC_PIPELINE_COUNTERS               counters[ LLC_STAGE_MAX ];
+    COUNTER                             startNs;
+
+    // Block being consumed
+    LLC_PIPELINE_BLOCK                  *current;
+    UINT32                              pos;
+    COUNTER                             simulateSince;
+    bool                                finished;
+
+  public:
+
+    // Takes over 'file', positioned after the stream header
+    LLC_TRACE_PIPELINE( gzFile _file, UINT32 _version, UINT32 inflaters );
+    ~LLC_TRACE_PIPELINE();
+
+    bool   Next( LLC_ACCESS *access )
+    {
+        if( current == NULL || pos == current->count )
+        {
+            if( !NextBlock() ) return false;
+        }
+
+        *access = current->accesses[ pos++ ];
+
+        return true;
+    }
+
+    // Per stage blocks, records, busy time and throughput
+    void   PrintStats( ostream &out );
+
+  private:
+
+    bool   NextBlock();
+
+    bool   Push( SPSC_QUEUE<LLC_PIPELINE_BLOCK *> *queue, LLC_PIPELINE_BLOCK *block, UINT32 stage );
+    bool   Pop( SPSC_QUEUE<LLC_PIPELINE_BLOCK *> *queue, LLC_PIPELINE_BLOCK **block, UINT32 stage );
+
+    bool   Fetch( LLC_PIPELINE_BLOCK *block );
+    bool   Inflate( LLC_PIPELINE_BLOCK *block );
+    void   Decode( LLC_PIPELINE_BLOCK *block, COUNTER firstSeq );
+
+    void   FetchStage();
+    void   InflateStage( UINT32 inflater );
+    void   DecodeStage();
+
+    static void *FetchThread( void *arg );
+    static void *InflateThread( void *arg );
+    static void *DecodeThread( void *arg );
+};
+
+#endif
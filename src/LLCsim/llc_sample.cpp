@@ -0,0 +1,129 @@
+#include <cassert>
+#include <cmath>
+#include "llc_sample.h"
+
+LLC_SAMPLED_MRC::LLC_SAMPLED_MRC( UINT32 _threads, UINT32 linesize, UINT32 _assoc, UINT32 minKB, UINT32 maxKB,
+                                  const UINT32 *_policies, UINT32 _numPolicies, UINT32 sampleSets )
+{
+    assert( _numPolicies <= LLC_SAMPLE_MAX_POLICIES );
+
+    lineShift      = CRC_FloorLog2( linesize );
+    assoc          = _assoc;
+    threads        = _threads;
+    numPolicies    = _numPolicies;
+    numSizes       = 0;
+    demandAccesses = 0;
+
+    for(UINT32 p=0; p<numPolicies; p++)
+    {
+        policies[p] = _policies[p];
+    }
+
+    // 64 bits, so that doubling past the largest UINT32 size ends the loop
+    for(COUNTER sizeKB=minKB; sizeKB<=maxKB && numSizes<LLC_SAMPLE_MAX_SIZES; sizeKB*=2)
+    {
+        LLC_SAMPLE_SIZE *size = &sizes[ numSizes++ ];
+
+        size->sizeKB   = (UINT32) sizeKB;
+        size->numsets  = (UINT32) (sizeKB * 1024 / (linesize * assoc));
+        size->shift    = (size->numsets > sampleSets) ? CRC_FloorLog2( size->numsets / sampleSets ) : 0;
+        size->replicas = (size->shift == 0) ? 1 : ((1U << size->shift) < LLC_SAMPLE_REPLICAS ? (1U << size->shift) : LLC_SAMPLE_REPLICAS);
+        size->caches   = new CRC_CACHE* [ numPolicies * size->replicas ];
+
+        UINT32 scaledSets = size->numsets >> size->shift;
+
+        for(UINT32 c=0; c<numPolicies * size->replicas; c++)
+        {
+            size->caches[c] = new CRC_CACHE( scaledSets * assoc * linesize, assoc, threads, linesize, policies[ c / size->replicas ] );
+            size->caches[c]->ReplacementState()->ScaleDown( size->shift );
+        }
+    }
+}
+
+LLC_SAMPLED_MRC::~LLC_SAMPLED_MRC()
+{
+    for(UINT32 s=0; s<numSizes; s++)
+    {
+        for(UINT32 c=0; c<numPolicies * sizes[s].replicas; c++)
+        {
+            delete sizes[s].caches[c];
+        }
+
+        delete [] sizes[s].caches;
+    }
+}
+
+void LLC_SAMPLED_MRC::SeedRandom( UINT64 seed )
+{
+    for(UINT32 s=0; s<numSizes; s++)
+    {
+        for(UINT32 c=0; c<numPolicies * sizes[s].replicas; c++)
+        {
+            sizes[s].caches[c]->SeedRandom( seed );
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// The estimate is the mean of the replicas' demand miss ratios; the error    //
+// is the standard error of that mean. Sizes simulated in full have no        //
+// error. EstMisses scales the estimate to the demand accesses of the         //
+// whole stream.                                                              //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+ostream & LLC_SAMPLED_MRC::PrintStats( ostream &out )
+{
+    out<<"=========================================================="<<endl;
+    out<<"==== Sampled Miss Ratio Curves                        ===="<<endl;
+    out<<"=========================================================="<<endl;
+    out<<endl;
+    out<<"Policy\tSizeKB\tSets\tSampledSets\tSampleRate\tReplicas\tSampledAccesses\tMissRate\tStdErr\tEstMisses"<<endl;
+
+    for(UINT32 p=0; p<numPolicies; p++)
+    {
+        for(UINT32 s=0; s<numSizes; s++)
+        {
+            LLC_SAMPLE_SIZE *size     = &sizes[s];
+            COUNTER          accesses = 0;
+            double           ratio[ LLC_SAMPLE_REPLICAS ];
+            double           mean     = 0.0;
+            double           var      = 0.0;
+
+            for(UINT32 r=0; r<size->replicas; r++)
+            {
+                CRC_CACHE *llc    = size->caches[ p * size->replicas + r ];
+                COUNTER    lookup = 0, miss = 0;
+
+                for(UINT32 t=0; t<threads; t++)
+                {
+                    lookup += llc->ThreadDemandLookupStats( t );
+                    miss   += llc->ThreadDemandMissStats( t );
+                }
+
+                accesses += lookup;
+                ratio[r]  = lookup ? (double) miss / (double) lookup : 0.0;
+                mean     += ratio[r] / size->replicas;
+            }
+
+            for(UINT32 r=0; r<size->replicas; r++)
+            {
+                var += (ratio[r] - mean) * (ratio[r] - mean);
+            }
+
+            double stderror = (size->replicas > 1) ? sqrt( var / (size->replicas - 1) / size->replicas ) : 0.0;
+
+            // Configured policies are known by their spec
+            if( policies[p] >= CRC_REPL_CONFIGURED )
+                out<<CRC_PolicyName( policies[p] );
+            else
+                out<<policies[p];
+
+            out<<"\t"<<size->sizeKB<<"\t"<<size->numsets<<"\t"<<(size->numsets >> size->shift)
+               <<"\t"<<1.0 / (double) (1U << size->shift)<<"\t"<<size->replicas<<"\t"<<accesses
+               <<"\t"<<mean * 100.0<<"\t"<<stderror * 100.0<<"\t"<<(COUNTER) (mean * (double) demandAccesses)<<endl;
+        }
+    }
+
+    return out;
+}
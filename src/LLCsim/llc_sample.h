@@ -0,0 +1,90 @@
+#ifndef LLC_SAMPLE_H
+#define LLC_SAMPLE_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Approximate miss ratio curves for any replacement policy by spatial        //
+// sampling (SHARDS, Waldspurger et al., FAST'15 and ATC'17). A line takes    //
+// part in the simulation of a size only if a hash of its address falls       //
+// in that size's sampled range. The sampled lines are replayed into a        //
+// CRC_CACHE with the same fraction of the sets, whose miss ratio             //
+// estimates that of the full size cache.                                     //
+//                                                                            //
+// The fraction is 1/2^shift, picked per size so that every scaled cache      //
+// has LLC_SAMPLE_SETS sets: memory stays constant whatever the size, and     //
+// sizes up to LLC_SAMPLE_SETS sets are simulated exactly. Each sampled       //
+// size runs LLC_SAMPLE_REPLICAS scaled caches on disjoint hash ranges;       //
+// their spread gives the standard error of the estimate.                     //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "crc_cache.h"
+#include "crc_random.h"
+#include "llc_trace.h"
+
+#define LLC_SAMPLE_SETS         256          // sets of each scaled cache
+#define LLC_SAMPLE_REPLICAS     4            // independent samples per size
+#define LLC_SAMPLE_MAX_SIZES    32
+#define LLC_SAMPLE_MAX_POLICIES 16
+
+typedef struct
+{
+    UINT32                  sizeKB;
+    UINT32                  numsets;         // of the modeled cache
+    UINT32                  shift;           // one line in 2^shift is sampled per replica
+    UINT32                  replicas;
+    CRC_CACHE               **caches;        // [policy * replicas + replica]
+} LLC_SAMPLE_SIZE;
+
+class LLC_SAMPLED_MRC
+{
+  private:
+
+    UINT32                  lineShift;
+    UINT32                  assoc;
+    UINT32                  threads;
+
+    UINT32                  numPolicies;
+    UINT32                  policies[ LLC_SAMPLE_MAX_POLICIES ];
+
+    UINT32                  numSizes;
+    LLC_SAMPLE_SIZE         sizes[ LLC_SAMPLE_MAX_SIZES ];
+
+    COUNTER                 demandAccesses;  // of the whole stream
+
+  public:
+
+    // Sizes are the powers of two from minKB to maxKB; every size must
+    // give a power of two set count
+    LLC_SAMPLED_MRC( UINT32 _threads, UINT32 linesize, UINT32 _assoc, UINT32 minKB, UINT32 maxKB,
+                     const UINT32 *_policies, UINT32 _numPolicies, UINT32 sampleSets );
+    ~LLC_SAMPLED_MRC();
+
+    void   SeedRandom( UINT64 seed );
+
+    void   Access( const LLC_ACCESS &access )
+    {
+        UINT32 hash = (UINT32) (CRC_Mix64( access.paddr >> lineShift ) >> 32);
+
+        if( access.accessType <= ACCESS_STORE ) demandAccesses++;
+
+        for(UINT32 s=0; s<numSizes; s++)
+        {
+            LLC_SAMPLE_SIZE *size    = &sizes[s];
+            UINT32           replica = (size->shift != 0) ? hash >> (32 - size->shift) : 0;
+
+            if( replica >= size->replicas ) continue;
+
+            for(UINT32 p=0; p<numPolicies; p++)
+            {
+                size->caches[ p * size->replicas + replica ]->LookupAndFillCache( access.tid, access.PC, access.paddr, access.accessType );
+            }
+        }
+    }
+
+    // Estimated demand miss ratio and its standard error per policy and size
+    ostream & PrintStats( ostream &out );
+};
+
+#endif
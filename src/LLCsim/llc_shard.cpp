@@ -0,0 +1,159 @@
+#include "llc_shard.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Builds one full-geometry cache per shard, so set indices need no           //
+// remapping, and starts the workers. A shard only ever touches the sets      //
+// it owns.                                                                   //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+LLC_SHARDED_REPLAY::LLC_SHARDED_REPLAY( UINT32 cacheSize, UINT32 assoc, UINT32 tpc, UINT32 linesize, UINT32 pol,
+                                        UINT32 _shards, COUNTER _epoch )
+{
+    numShards  = _shards;
+    epoch      = (_epoch != 0) ? _epoch : LLC_SHARD_EPOCH;
+    sinceSync  = 0;
+    epochs     = 0;
+
+    caches     = new CRC_CACHE* [ numShards ];
+    replStates = new CACHE_REPLACEMENT_STATE* [ numShards ];
+    queues     = new SPSC_QUEUE<LLC_ACCESS>* [ numShards ];
+    threads    = new pthread_t [ numShards ];
+    workers    = new LLC_SHARD_WORKER [ numShards ];
+
+    for(UINT32 s=0; s<numShards; s++)
+    {
+        caches[s]     = new CRC_CACHE( cacheSize, assoc, tpc, linesize, pol );
+        replStates[s] = caches[s]->ReplacementState();
+        queues[s]     = new SPSC_QUEUE<LLC_ACCESS>( LLC_SHARD_QUEUE );
+    }
+
+    UINT32 numsets = cacheSize / (linesize * assoc);
+
+    shared     = new CACHE_REPLACEMENT_STATE( numsets, assoc, pol );
+    syncShared = shared->HasSharedState();
+
+    // The workers and the distributor meet at the epoch barrier
+    pthread_barrier_init( &barrier, NULL, numShards + 1 );
+
+    for(UINT32 s=0; s<numShards; s++)
+    {
+        workers[s].replay = this;
+        workers[s].shard  = s;
+        pthread_create( &threads[s], NULL, WorkerThread, &workers[s] );
+    }
+}
+
+LLC_SHARDED_REPLAY::~LLC_SHARDED_REPLAY()
+{
+    for(UINT32 s=0; s<numShards; s++)
+    {
+        delete queues[s];
+        delete caches[s];
+    }
+
+    delete shared;
+    delete [] caches;
+    delete [] replStates;
+    delete [] queues;
+    delete [] threads;
+    delete [] workers;
+
+    pthread_barrier_destroy( &barrier );
+}
+
+void LLC_SHARDED_REPLAY::SeedRandom( UINT64 seed )
+{
+    for(UINT32 s=0; s<numShards; s++)
+    {
+        caches[s]->SeedRandom( seed );
+    }
+    shared->SeedRandom( seed );
+}
+
+void LLC_SHARDED_REPLAY::Broadcast( UINT32 control )
+{
+    LLC_ACCESS marker;
+
+    marker.PC         = 0;
+    marker.paddr      = 0;
+    marker.seq        = 0;
+    marker.tid        = 0;
+    marker.accessType = control;
+
+    for(UINT32 s=0; s<numShards; s++)
+    {
+        queues[s]->Push( marker );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Epoch boundary: once every worker has replayed the epoch and is parked     //
+// at the barrier, the distributor combines the shared predictor state and    //
+// releases the workers through the second barrier.                           //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void LLC_SHARDED_REPLAY::Synchronize()
+{
+    Broadcast( LLC_SHARD_SYNC );
+
+    pthread_barrier_wait( &barrier );
+    shared->SynchronizeShared( replStates, numShards );
+    pthread_barrier_wait( &barrier );
+
+    sinceSync = 0;
+    epochs++;
+}
+
+CRC_CACHE *LLC_SHARDED_REPLAY::Finish()
+{
+    Broadcast( LLC_SHARD_STOP );
+
+    for(UINT32 s=0; s<numShards; s++)
+    {
+        pthread_join( threads[s], NULL );
+    }
+
+    for(UINT32 s=1; s<numShards; s++)
+    {
+        caches[0]->AddStats( caches[s] );
+    }
+
+    return caches[0];
+}
+
+void *LLC_SHARDED_REPLAY::WorkerThread( void *arg )
+{
+    LLC_SHARD_WORKER *worker = (LLC_SHARD_WORKER *) arg;
+
+    worker->replay->Work( worker->shard );
+
+    return NULL;
+}
+
+void LLC_SHARDED_REPLAY::Work( UINT32 shard )
+{
+    SPSC_QUEUE<LLC_ACCESS> *queue = queues[ shard ];
+    CRC_CACHE              *llc   = caches[ shard ];
+    LLC_ACCESS             access;
+
+    while( true )
+    {
+        queue->Pop( &access );
+
+        if( access.accessType == LLC_SHARD_STOP )
+        {
+            break;
+        }
+
+        if( access.accessType == LLC_SHARD_SYNC )
+        {
+            pthread_barrier_wait( &barrier );
+            pthread_barrier_wait( &barrier );
+            continue;
+        }
+
+        llc->LookupAndFillCache( access.tid, access.PC, access.paddr, access.accessType );
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef LLC_SHARD_H
+#define LLC_SHARD_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Set-sharded replay of one LLC stream on several host threads.              //
+//                                                                            //
+// Sets of CRC_CACHE only interact through the replacement policy's shared    //
+// predictors (PSEL, SHCT, EAF) and the statistics. Each worker thread owns   //
+// a private CRC_CACHE and replays the accesses of the sets assigned to it    //
+// (set index modulo the number of shards). The distributor, the thread       //
+// calling Access(), routes every access to its owner through a lock-free     //
+// single-producer single-consumer queue.                                     //
+//                                                                            //
+// Every 'epoch' accesses the workers stop at a barrier and the shared        //
+// predictor state is combined and handed back to all of them, so their       //
+// views of it drift apart by at most one epoch of updates. Results are       //
+// therefore close to, but not identical with, a serial replay; llcsim        //
+// -drift reports the difference.                                             //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <pthread.h>
+#include "crc_cache.h"
+#include "llc_trace.h"
+#include "spsc_queue.h"
+
+#define LLC_SHARD_QUEUE         4096         // accesses in flight per worker
+#define LLC_SHARD_EPOCH         65536        // default accesses per epoch
+
+// Control records sent in place of an access
+#define LLC_SHARD_SYNC          0xfffffffe   // synchronize at the epoch barrier
+#define LLC_SHARD_STOP          0xffffffff   // no more accesses
+
+class LLC_SHARDED_REPLAY;
+
+typedef struct
+{
+    LLC_SHARDED_REPLAY      *replay;
+    UINT32                  shard;
+} LLC_SHARD_WORKER;
+
+class LLC_SHARDED_REPLAY
+{
+  private:
+
+    UINT32                  numShards;
+    COUNTER                 epoch;
+    COUNTER                 sinceSync;
+
+    CRC_CACHE               **caches;        // one per shard
+    CACHE_REPLACEMENT_STATE **replStates;
+    CACHE_REPLACEMENT_STATE *shared;         // predictor state as of the last epoch
+    bool                    syncShared;
+
+    SPSC_QUEUE<LLC_ACCESS>  **queues;
+    pthread_t               *threads;
+    LLC_SHARD_WORKER        *workers;
+    pthread_barrier_t       barrier;
+
+    COUNTER                 epochs;
+
+  public:
+
+    LLC_SHARDED_REPLAY( UINT32 cacheSize, UINT32 assoc, UINT32 tpc, UINT32 linesize, UINT32 pol,
+                        UINT32 _shards, COUNTER _epoch );
+    ~LLC_SHARDED_REPLAY();
+
+    // Seeds every shard identically, so they agree on the leader sets.
+    // Call before the first access.
+    void   SeedRandom( UINT64 seed );
+
+    void   Access( const LLC_ACCESS &access )
+    {
+        queues[ caches[0]->SetIndexOf( access.paddr ) % numShards ]->Push( access );
+
+        if( ++sinceSync == epoch && syncShared )
+        {
+            Synchronize();
+        }
+    }
+
+    // Drains the queues, stops the workers and folds the statistics of all
+    // shards into the returned cache
+    CRC_CACHE *Finish();
+
+    COUNTER Epochs() { return epochs; }
+
+  private:
+
+    void   Synchronize();
+    void   Broadcast( UINT32 control );
+    void   Work( UINT32 shard );
+
+    static void *WorkerThread( void *arg );
+};
+
+#endif
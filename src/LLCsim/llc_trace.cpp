@@ -0,0 +1,583 @@
+#include <cstdlib>
+#include <cstring>
+#include "llc_trace.h"
+#include "llc_pipeline.h"
+#include "llc_trace_cache.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Reader for LLC access streams. Records are pulled from the file a whole    //
+// block at a time so that the per-access cost is a struct copy rather        //
+// than a call into zlib.                                                     //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+LLC_TRACE_READER::LLC_TRACE_READER()
+{
+    file           = NULL;
+    pipeline       = NULL;
+    image          = NULL;
+    batch          = new LLC_TRACE_RECORD[ LLC_TRACE_BLOCK ];
+    batchCount     = 0;
+    batchPos       = 0;
+    compressed     = NULL;
+    compressedSize = 0;
+    recordsRead    = 0;
+    filename       = NULL;
+    inflaters      = 0;
+    mixThreads     = 0;
+
+    header.magic   = 0;
+    header.version = 0;
+    header.threads = 0;
+}
+
+LLC_TRACE_READER::~LLC_TRACE_READER()
+{
+    Close();
+    delete [] batch;
+    delete [] compressed;
+    free( filename );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Opens the stream and validates the header. Returns false if the file       //
+// cannot be opened or is not an LLC stream of a known version. With          //
+// inflaters > 0 the rest of the file is handed to an LLC_TRACE_PIPELINE;     //
+// with cached set the records come from the stream's LLC_TRACE_IMAGE.        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool LLC_TRACE_READER::Open( const char *_filename, UINT32 _inflaters, bool cached )
+{
+    Close();
+
+    if( filename != _filename )
+    {
+        free( filename );
+        filename = strdup( _filename );
+    }
+    inflaters   = _inflaters;
+    batchCount  = 0;
+    batchPos    = 0;
+    recordsRead = 0;
+
+    if( cached )
+    {
+        image = LLC_TRACE_CACHE::Acquire( filename );
+        if( image == NULL ) return false;
+
+        header.magic   = LLC_TRACE_MAGIC;
+        header.version = LLC_TRACE_VERSION;
+        header.threads = image->threads;
+
+        return true;
+    }
+
+    file = gzopen( filename, "rb" );
+    if( file == NULL )
+    {
+        cerr << "LLC_TRACE_READER: cannot open " << filename << endl;
+        return false;
+    }
+
+    gzbuffer( file, 1 << 20 );
+
+    if( gzread( file, &header, sizeof(header) ) != (int) sizeof(header)
+        || header.magic != LLC_TRACE_MAGIC )
+    {
+        cerr << "LLC_TRACE_READER: " << filename << " is not an LLC stream" << endl;
+        Close();
+        return false;
+    }
+
+    if( header.version != 1 && header.version != LLC_TRACE_VERSION )
+    {
+        cerr << "LLC_TRACE_READER: " << filename << " has unsupported version "
+             << header.version << endl;
+        Close();
+        return false;
+    }
+
+    if( inflaters > 0 )
+    {
+        // The pipeline owns the file from here on
+        pipeline = new LLC_TRACE_PIPELINE( file, header.version, inflaters );
+        file     = NULL;
+    }
+
+    return true;
+}
+
+void LLC_TRACE_READER::Close()
+{
+    for(UINT32 t=0; t<mixThreads; t++)
+    {
+        LLC_TRACE_CACHE::Release( mixImages[t] );
+    }
+    mixThreads = 0;
+
+    if( image != NULL )
+    {
+        LLC_TRACE_CACHE::Release( image );
+        image = NULL;
+    }
+
+    if( pipeline != NULL )
+    {
+        delete pipeline;
+        pipeline = NULL;
+    }
+
+    if( file != NULL )
+    {
+        gzclose( file );
+        file = NULL;
+    }
+}
+
+bool LLC_TRACE_READER::OpenMix( char **files, UINT32 count )
+{
+    Close();
+
+    if( count == 0 || count > LLC_TRACE_MIX_MAX )
+    {
+        cerr << "LLC_TRACE_READER: a mix takes 1 to " << LLC_TRACE_MIX_MAX << " streams" << endl;
+        return false;
+    }
+
+    for(UINT32 t=0; t<count; t++)
+    {
+        mixImages[t] = LLC_TRACE_CACHE::Acquire( files[t] );
+
+        if( mixImages[t] != NULL && mixImages[t]->count == 0 )
+        {
+            cerr << "LLC_TRACE_READER: " << files[t] << " is empty" << endl;
+            LLC_TRACE_CACHE::Release( mixImages[t] );
+            mixImages[t] = NULL;
+        }
+
+        if( mixImages[t] == NULL )
+        {
+            mixThreads = t;
+            Close();
+            return false;
+        }
+    }
+
+    mixThreads     = count;
+    header.magic   = LLC_TRACE_MAGIC;
+    header.version = LLC_TRACE_VERSION;
+    header.threads = count;
+
+    return Rewind();
+}
+
+bool LLC_TRACE_READER::Rewind()
+{
+    if( mixThreads != 0 )
+    {
+        for(UINT32 t=0; t<mixThreads; t++)
+        {
+            mixPos[t]  = 0;
+            mixDone[t] = false;
+        }
+
+        mixTurn     = 0;
+        mixPending  = mixThreads;
+        recordsRead = 0;
+        return true;
+    }
+
+    if( image != NULL )
+    {
+        recordsRead = 0;
+        return true;
+    }
+
+    return (filename != NULL) && Open( filename, inflaters );
+}
+
+bool LLC_TRACE_READER::Refill()
+{
+    if( file == NULL ) return false;
+
+    bool ok = (header.version == 1) ? RefillV1() : RefillV2();
+
+    batchPos = 0;
+
+    return ok && (batchCount != 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Version 1: decodes the next batch of flat records. A trailing partial      //
+// record is treated as the end of the stream. Sequence numbers are the       //
+// record positions.                                                          //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool LLC_TRACE_READER::RefillV1()
+{
+    // Decode in place from the tail of the batch buffer, which is large
+    // enough because a version 1 record is smaller than a version 2 one
+    LLC_TRACE_RECORD_V1 *raw = (LLC_TRACE_RECORD_V1 *) &batch[ LLC_TRACE_BLOCK ] - LLC_TRACE_BLOCK;
+
+    int bytes = gzread( file, raw, LLC_TRACE_BLOCK * sizeof(LLC_TRACE_RECORD_V1) );
+
+    if( bytes <= 0 ) return false;
+
+    batchCount = bytes / sizeof(LLC_TRACE_RECORD_V1);
+
+    for(UINT32 i=0; i<batchCount; i++)
+    {
+        LLC_TRACE_RECORD_V1 rec = raw[i];
+
+        batch[i].PC         = rec.PC;
+        batch[i].paddr      = rec.paddr;
+        batch[i].seq        = recordsRead + i + 1;
+        batch[i].tid        = rec.tid;
+        batch[i].accessType = rec.accessType;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Version 2: reads and inflates the next block.                              //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool LLC_TRACE_READER::RefillV2()
+{
+    LLC_TRACE_BLOCK_HEADER block;
+
+    if( gzread( file, &block, sizeof(block) ) != (int) sizeof(block) )
+    {
+        return false;
+    }
+
+    if( block.records > LLC_TRACE_BLOCK )
+    {
+        cerr << "LLC_TRACE_READER: corrupt block header" << endl;
+        return false;
+    }
+
+    if( block.compressedBytes > compressedSize )
+    {
+        delete [] compressed;
+        compressedSize = block.compressedBytes;
+        compressed     = new Bytef[ compressedSize ];
+    }
+
+    if( gzread( file, compressed, block.compressedBytes ) != (int) block.compressedBytes )
+    {
+        cerr << "LLC_TRACE_READER: truncated block" << endl;
+        return false;
+    }
+
+    uLongf rawBytes = block.records * sizeof(LLC_TRACE_RECORD);
+
+    if( uncompress( (Bytef *) batch, &rawBytes, compressed, block.compressedBytes ) != Z_OK
+        || rawBytes != block.records * sizeof(LLC_TRACE_RECORD) )
+    {
+        cerr << "LLC_TRACE_READER: corrupt block" << endl;
+        return false;
+    }
+
+    batchCount = block.records;
+
+    return true;
+}
+
+bool LLC_TRACE_READER::Next( LLC_ACCESS *access )
+{
+    // The cursor into a cached image is the count of records read
+    if( image != NULL )
+    {
+        if( recordsRead == image->count ) return false;
+
+        *access = image->accesses[ recordsRead++ ];
+        return true;
+    }
+
+    if( mixThreads != 0 )
+    {
+        return NextMix( access );
+    }
+
+    if( pipeline != NULL )
+    {
+        if( !pipeline->Next( access ) ) return false;
+
+        recordsRead++;
+        return true;
+    }
+
+    if( batchPos == batchCount && !Refill() )
+    {
+        return false;
+    }
+
+    LLC_TRACE_RECORD *rec = &batch[ batchPos++ ];
+
+    access->PC         = rec->PC;
+    access->paddr      = rec->paddr;
+    access->seq        = rec->seq;
+    access->tid        = rec->tid;
+    access->accessType = rec->accessType;
+
+    recordsRead++;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Next access of a mix: thread mixTurn's, which is rewound if it has run     //
+// out. A thread is finished as soon as it hands out its last record, so the  //
+// mix ends right after the last thread's, with nothing replayed twice.       //
+// Sequence numbers count the accesses of the mix.                            //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool LLC_TRACE_READER::NextMix( LLC_ACCESS *access )
+{
+    if( mixPending == 0 ) return false;
+
+    UINT32                 t   = mixTurn;
+    const LLC_TRACE_IMAGE *img = mixImages[t];
+
+    mixTurn = (t + 1 == mixThreads) ? 0 : t + 1;
+
+    if( mixPos[t] == img->count ) mixPos[t] = 0;
+
+    *access = img->accesses[ mixPos[t]++ ];
+
+    if( mixPos[t] == img->count && !mixDone[t] )
+    {
+        mixDone[t] = true;
+        mixPending--;
+    }
+
+    access->paddr ^= (Addr_t) t << LLC_TRACE_MIX_SHIFT;
+    access->seq    = ++recordsRead;
+    access->tid    = t;
+
+    return true;
+}
+
+void LLC_TRACE_READER::PrintPipelineStats( ostream &out )
+{
+    if( pipeline != NULL )
+    {
+        pipeline->PrintStats( out );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Writer for version 2 streams                                               //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+// Writers that are still open when the process exits. CMP$im never
+// destroys the LLC, so capture files are flushed from an atexit handler.
+static LLC_TRACE_WRITER *openWriters = NULL;
+
+LLC_TRACE_WRITER::LLC_TRACE_WRITER()
+{
+    file      = NULL;
+    fill      = NULL;
+    fillCount = 0;
+    submitted = 0;
+    written   = 0;
+    closing   = false;
+    nextOpen  = NULL;
+
+    for(UINT32 b=0; b<LLC_TRACE_WRITE_BUFFERS; b++)
+    {
+        blocks[b]     = NULL;
+        blockCount[b] = 0;
+    }
+}
+
+LLC_TRACE_WRITER::~LLC_TRACE_WRITER()
+{
+    Close();
+}
+
+bool LLC_TRACE_WRITER::Open( const char *filename, UINT32 threads )
+{
+    static bool atExitRegistered = false;
+
+    Close();
+
+    file = fopen( filename, "wb" );
+    if( file == NULL )
+    {
+        cerr << "LLC_TRACE_WRITER: cannot create " << filename << endl;
+        return false;
+    }
+
+    LLC_TRACE_HEADER header;
+
+    header.magic    = LLC_TRACE_MAGIC;
+    header.version  = LLC_TRACE_VERSION;
+    header.threads  = threads;
+    header.reserved = 0;
+
+    fwrite( &header, sizeof(header), 1, file );
+
+    for(UINT32 b=0; b<LLC_TRACE_WRITE_BUFFERS; b++)
+    {
+        blocks[b] = new LLC_TRACE_RECORD[ LLC_TRACE_BLOCK ];
+    }
+
+    fill      = blocks[0];
+    fillCount = 0;
+    submitted = 0;
+    written   = 0;
+    closing   = false;
+
+    pthread_mutex_init( &lock, NULL );
+    pthread_cond_init( &blockReady, NULL );
+    pthread_cond_init( &blockDone, NULL );
+    pthread_create( &thread, NULL, WriterThread, this );
+
+    nextOpen    = openWriters;
+    openWriters = this;
+
+    if( !atExitRegistered )
+    {
+        atexit( CloseAtExit );
+        atExitRegistered = true;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Flushes the partial block, waits for the writer thread to drain and        //
+// closes the file.                                                           //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void LLC_TRACE_WRITER::Close()
+{
+    if( file == NULL ) return;
+
+    if( fillCount != 0 )
+    {
+        Submit();
+    }
+
+    pthread_mutex_lock( &lock );
+    closing = true;
+    pthread_cond_signal( &blockReady );
+    pthread_mutex_unlock( &lock );
+
+    pthread_join( thread, NULL );
+
+    pthread_mutex_destroy( &lock );
+    pthread_cond_destroy( &blockReady );
+    pthread_cond_destroy( &blockDone );
+
+    fclose( file );
+    file = NULL;
+
+    for(UINT32 b=0; b<LLC_TRACE_WRITE_BUFFERS; b++)
+    {
+        delete [] blocks[b];
+        blocks[b] = NULL;
+    }
+
+    // Unlink from the exit list
+    for(LLC_TRACE_WRITER **w = &openWriters; *w != NULL; w = &(*w)->nextOpen)
+    {
+        if( *w == this )
+        {
+            *w = nextOpen;
+            break;
+        }
+    }
+}
+
+void LLC_TRACE_WRITER::CloseAtExit()
+{
+    while( openWriters != NULL )
+    {
+        openWriters->Close();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Hands the filled block to the writer thread and moves on to the next       //
+// buffer, waiting only if that buffer has not been written out yet.          //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void LLC_TRACE_WRITER::Submit()
+{
+    pthread_mutex_lock( &lock );
+
+    blockCount[ submitted % LLC_TRACE_WRITE_BUFFERS ] = fillCount;
+    submitted++;
+    pthread_cond_signal( &blockReady );
+
+    while( submitted - written >= LLC_TRACE_WRITE_BUFFERS )
+    {
+        pthread_cond_wait( &blockDone, &lock );
+    }
+
+    pthread_mutex_unlock( &lock );
+
+    fill      = blocks[ submitted % LLC_TRACE_WRITE_BUFFERS ];
+    fillCount = 0;
+}
+
+void *LLC_TRACE_WRITER::WriterThread( void *arg )
+{
+    ((LLC_TRACE_WRITER *) arg)->WriteBlocks();
+    return NULL;
+}
+
+void LLC_TRACE_WRITER::WriteBlocks()
+{
+    uLong  bound = compressBound( LLC_TRACE_BLOCK * sizeof(LLC_TRACE_RECORD) );
+    Bytef *out   = new Bytef[ bound ];
+
+    pthread_mutex_lock( &lock );
+
+    while( true )
+    {
+        while( written == submitted && !closing )
+        {
+            pthread_cond_wait( &blockReady, &lock );
+        }
+
+        if( written == submitted ) break;
+
+        UINT32            buffer  = written % LLC_TRACE_WRITE_BUFFERS;
+        LLC_TRACE_RECORD *records = blocks[ buffer ];
+        UINT32            count   = blockCount[ buffer ];
+
+        pthread_mutex_unlock( &lock );
+
+        uLongf outBytes = bound;
+        compress2( out, &outBytes, (const Bytef *) records, count * sizeof(LLC_TRACE_RECORD), Z_BEST_SPEED );
+
+        LLC_TRACE_BLOCK_HEADER block;
+        block.records         = count;
+        block.compressedBytes = outBytes;
+
+        fwrite( &block, sizeof(block), 1, file );
+        fwrite( out, 1, outBytes, file );
+
+        pthread_mutex_lock( &lock );
+        written++;
+        pthread_cond_signal( &blockDone );
+    }
+
+    pthread_mutex_unlock( &lock );
+
+    delete [] out;
+}
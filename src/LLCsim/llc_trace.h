@@ -0,0 +1,214 @@
+#ifndef LLC_TRACE_H
+#define LLC_TRACE_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// LLC access streams. An LLC stream is the sequence of calls made to         //
+// CRC_CACHE::LookupAndFillCache by the CMP$im front end, one record per      //
+// call. Replaying a stream exercises only the LLC model: there is no Pin,    //
+// no instruction trace decoding and no L1/L2 work.                           //
+//                                                                            //
+// File layout: an LLC_TRACE_HEADER followed by the records.                  //
+//                                                                            //
+//   Version 1: a flat array of LLC_TRACE_RECORD_V1. The file may be gzip     //
+//              compressed or plain; the reader handles both.                 //
+//   Version 2: written by CRC_CACHE capture mode. A sequence of blocks,      //
+//              each an LLC_TRACE_BLOCK_HEADER followed by the zlib           //
+//              compressed image of up to LLC_TRACE_BLOCK LLC_TRACE_RECORDs.  //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <pthread.h>
+#include <zlib.h>
+#include "utils.h"
+
+#define LLC_TRACE_MAGIC         0x54434c4c   // "LLCT" in little endian
+#define LLC_TRACE_VERSION       2
+#define LLC_TRACE_BLOCK         16384        // records per compressed block
+#define LLC_TRACE_WRITE_BUFFERS 4            // blocks in flight to the writer thread
+#define LLC_TRACE_MIX_MAX       64           // streams of a mix
+#define LLC_TRACE_MIX_SHIFT     48           // paddr bit of the mix thread id
+
+// On-disk file header
+typedef struct
+{
+    UINT32  magic;
+    UINT32  version;
+    UINT32  threads;      // hardware threads that issued the accesses
+    UINT32  reserved;
+} LLC_TRACE_HEADER;
+
+// On-disk record of a version 1 stream
+typedef struct
+{
+    Addr_t  PC;
+    Addr_t  paddr;
+    UINT32  tid;
+    UINT32  accessType;
+} LLC_TRACE_RECORD_V1;
+
+// On-disk record of a version 2 stream, one per LookupAndFillCache call
+typedef struct
+{
+    Addr_t  PC;
+    Addr_t  paddr;
+    COUNTER seq;          // global sequence number of the call
+    UINT32  tid;
+    UINT32  accessType;
+} LLC_TRACE_RECORD;
+
+// On-disk header of a version 2 block
+typedef struct
+{
+    UINT32  records;
+    UINT32  compressedBytes;
+} LLC_TRACE_BLOCK_HEADER;
+
+// Decoded access handed to the cache model
+typedef struct
+{
+    Addr_t  PC;
+    Addr_t  paddr;
+    COUNTER seq;
+    UINT32  tid;
+    UINT32  accessType;
+} LLC_ACCESS;
+
+class LLC_TRACE_PIPELINE;
+struct LLC_TRACE_IMAGE;
+
+class LLC_TRACE_READER
+{
+  private:
+
+    gzFile            file;
+    LLC_TRACE_PIPELINE *pipeline;    // set when the stream is read pipelined
+    LLC_TRACE_IMAGE   *image;       // set when the stream is read from the cache
+    LLC_TRACE_HEADER  header;
+
+    LLC_TRACE_RECORD  *batch;
+    UINT32            batchCount;
+    UINT32            batchPos;
+
+    Bytef             *compressed;
+    UINT32            compressedSize;
+
+    COUNTER           recordsRead;
+
+    char              *filename;
+    UINT32            inflaters;
+
+    // A mix: one single-program stream per hardware thread, interleaved
+    UINT32            mixThreads;
+    LLC_TRACE_IMAGE   *mixImages[ LLC_TRACE_MIX_MAX ];
+    COUNTER           mixPos[ LLC_TRACE_MIX_MAX ];
+    bool              mixDone[ LLC_TRACE_MIX_MAX ];
+    UINT32            mixTurn;
+    UINT32            mixPending;  // threads still in their first pass
+
+  public:
+
+    LLC_TRACE_READER();
+    ~LLC_TRACE_READER();
+
+    // With inflaters > 0 the stream is fetched, inflated and decoded ahead
+    // of the caller by LLC_TRACE_PIPELINE threads; with cached set it is
+    // read from its shared decoded image (see LLC_TRACE_CACHE)
+    bool   Open( const char *filename, UINT32 inflaters = 0, bool cached = false );
+    void   Close();
+
+    // Replays 'files[t]' as hardware thread t, one access per thread in
+    // turn. A thread that reaches the end of its stream starts it again;
+    // the mix ends when every thread has finished once. The programs are
+    // separate processes: thread t's addresses get t in bit
+    // LLC_TRACE_MIX_SHIFT up. Each distinct file is decoded once.
+    bool   OpenMix( char **files, UINT32 count );
+
+    // Back to the first record: a cursor reset for a cached stream, else
+    // a new Open of the same file
+    bool   Rewind();
+
+    // Returns false at the end of the stream
+    bool   Next( LLC_ACCESS *access );
+
+    UINT32  Threads()     { return header.threads; }
+    COUNTER RecordsRead() { return recordsRead; }
+
+    // Per stage statistics of a pipelined stream; nothing otherwise
+    void    PrintPipelineStats( ostream &out );
+
+  private:
+
+    bool   NextMix( LLC_ACCESS *access );
+    bool   Refill();
+    bool   RefillV1();
+    bool   RefillV2();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Writer for version 2 streams. Append() only copies the record into the     //
+// block being filled; full blocks are compressed and written by a            //
+// background thread so the caller's hot path stays cheap. The caller         //
+// blocks only when all LLC_TRACE_WRITE_BUFFERS blocks are still queued.      //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+class LLC_TRACE_WRITER
+{
+  private:
+
+    FILE              *file;
+
+    LLC_TRACE_RECORD  *blocks[ LLC_TRACE_WRITE_BUFFERS ];
+    UINT32            blockCount[ LLC_TRACE_WRITE_BUFFERS ];
+
+    LLC_TRACE_RECORD  *fill;        // block currently owned by the producer
+    UINT32            fillCount;
+
+    COUNTER           submitted;    // blocks handed to the writer thread
+    COUNTER           written;      // blocks the writer thread has finished
+    bool              closing;
+
+    pthread_t         thread;
+    pthread_mutex_t   lock;
+    pthread_cond_t    blockReady;
+    pthread_cond_t    blockDone;
+
+    LLC_TRACE_WRITER  *nextOpen;    // writers flushed at exit
+
+  public:
+
+    LLC_TRACE_WRITER();
+    ~LLC_TRACE_WRITER();
+
+    bool   Open( const char *filename, UINT32 threads );
+    void   Close();
+
+    void   Append( UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType, COUNTER seq )
+    {
+        LLC_TRACE_RECORD *rec = &fill[ fillCount ];
+
+        rec->PC         = PC;
+        rec->paddr      = paddr;
+        rec->seq        = seq;
+        rec->tid        = tid;
+        rec->accessType = accessType;
+
+        if( ++fillCount == LLC_TRACE_BLOCK )
+        {
+            Submit();
+        }
+    }
+
+  private:
+
+    void   Submit();
+    void   WriteBlocks();
+
+    static void *WriterThread( void *arg );
+    static void  CloseAtExit();
+};
+
+#endif
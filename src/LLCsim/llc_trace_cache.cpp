@@ -0,0 +1,261 @@
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "llc_trace_cache.h"
+
+LLC_TRACE_IMAGE *LLC_TRACE_CACHE::images = NULL;
+pthread_mutex_t  LLC_TRACE_CACHE::lock   = PTHREAD_MUTEX_INITIALIZER;
+
+static long long ModificationTime( const struct stat *st )
+{
+    return (long long) st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+LLC_TRACE_IMAGE *LLC_TRACE_CACHE::Acquire( const char *filename )
+{
+    char resolved[ LLC_IMAGE_PATH ];
+
+    if( realpath( filename, resolved ) == NULL )
+    {
+        cerr << "LLC_TRACE_CACHE: cannot open " << filename << endl;
+        return NULL;
+    }
+
+    pthread_mutex_lock( &lock );
+
+    LLC_TRACE_IMAGE *image = images;
+
+    while( image != NULL && strcmp( image->path, resolved ) )
+    {
+        image = image->next;
+    }
+
+    if( image != NULL )
+    {
+        image->refs++;
+    }
+    else
+    {
+        // Decoding under the lock keeps a second reader from doing it too
+        image = new LLC_TRACE_IMAGE;
+
+        memset( image, 0, sizeof(LLC_TRACE_IMAGE) );
+        strcpy( image->path, resolved );
+
+        if( Decode( image, resolved ) )
+        {
+            image->refs = 1;
+            image->next = images;
+            images      = image;
+        }
+        else
+        {
+            delete image;
+            image = NULL;
+        }
+    }
+
+    pthread_mutex_unlock( &lock );
+
+    return image;
+}
+
+void LLC_TRACE_CACHE::Release( LLC_TRACE_IMAGE *image )
+{
+    pthread_mutex_lock( &lock );
+
+    if( --image->refs == 0 )
+    {
+        for(LLC_TRACE_IMAGE **i = &images; *i != NULL; i = &(*i)->next)
+        {
+            if( *i == image )
+            {
+                *i = image->next;
+                break;
+            }
+        }
+
+        if( image->bytes != 0 )
+        {
+            munmap( image->base, image->bytes );
+        }
+        else
+        {
+            free( image->base );
+        }
+
+        delete image;
+    }
+
+    pthread_mutex_unlock( &lock );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Builds the image: from the file in CRC_TRACE_CACHE when there is an        //
+// up to date one, else by decoding the stream into a new file there, else    //
+// (no directory, or it cannot be written) on the heap of this process.       //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool LLC_TRACE_CACHE::Decode( LLC_TRACE_IMAGE *image, const char *filename )
+{
+    struct stat source;
+
+    if( stat( filename, &source ) != 0 )
+    {
+        cerr << "LLC_TRACE_CACHE: cannot open " << filename << endl;
+        return false;
+    }
+
+    const char *dir = getenv( "CRC_TRACE_CACHE" );
+
+    if( dir != NULL && dir[0] != '\0' )
+    {
+        // FNV-1a of the resolved path names the image file
+        unsigned long long hash = 0xcbf29ce484222325ULL;
+
+        for(const char *c = filename; *c != '\0'; c++)
+        {
+            hash = (hash ^ (UINT8) *c) * 0x100000001b3ULL;
+        }
+
+        char imageFile[ LLC_IMAGE_PATH ];
+        snprintf( imageFile, sizeof(imageFile), "%s/llc-%016llx.img", dir, hash );
+
+        if( Map( image, imageFile, &source ) ) return true;
+
+        if( Build( image, filename, imageFile, &source ) && Map( image, imageFile, &source ) ) return true;
+
+        cerr << "LLC_TRACE_CACHE: cannot keep " << filename << " in " << dir << ", decoding it in memory" << endl;
+    }
+
+    return Build( image, filename, NULL, &source );
+}
+
+bool LLC_TRACE_CACHE::Map( LLC_TRACE_IMAGE *image, const char *imageFile, const struct stat *source )
+{
+    int fd = open( imageFile, O_RDONLY );
+    if( fd < 0 ) return false;
+
+    struct stat st;
+    void        *map = MAP_FAILED;
+
+    if( fstat( fd, &st ) == 0 && (size_t) st.st_size >= sizeof(LLC_IMAGE_HEADER) )
+    {
+        map = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    }
+    close( fd );
+
+    if( map == MAP_FAILED ) return false;
+
+    const LLC_IMAGE_HEADER *header = (const LLC_IMAGE_HEADER *) map;
+
+    if( header->magic != LLC_IMAGE_MAGIC || header->version != LLC_IMAGE_VERSION
+        || header->sourceBytes != (unsigned long long) source->st_size
+        || header->sourceMtime != ModificationTime( source )
+        || (size_t) st.st_size != sizeof(LLC_IMAGE_HEADER) + header->count * sizeof(LLC_ACCESS) )
+    {
+        munmap( map, st.st_size );
+        return false;
+    }
+
+    image->threads  = header->threads;
+    image->count    = header->count;
+    image->accesses = (const LLC_ACCESS *) (header + 1);
+    image->base     = map;
+    image->bytes    = st.st_size;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Decodes the stream with a plain reader, either into 'imageFile' or, if     //
+// that is NULL, into a heap block of the image. The file is written under    //
+// a temporary name and renamed, so a concurrent job never maps half of it.   //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+bool LLC_TRACE_CACHE::Build( LLC_TRACE_IMAGE *image, const char *filename, const char *imageFile, const struct stat *source )
+{
+    LLC_TRACE_READER reader;
+
+    if( !reader.Open( filename ) ) return false;
+
+    LLC_ACCESS access;
+
+    if( imageFile == NULL )
+    {
+        COUNTER    capacity = LLC_TRACE_BLOCK;
+        LLC_ACCESS *records = (LLC_ACCESS *) malloc( capacity * sizeof(LLC_ACCESS) );
+        COUNTER    count    = 0;
+
+        while( reader.Next( &access ) )
+        {
+            if( count == capacity )
+            {
+                capacity *= 2;
+                records   = (LLC_ACCESS *) realloc( records, capacity * sizeof(LLC_ACCESS) );
+            }
+            records[ count++ ] = access;
+        }
+
+        image->threads  = reader.Threads();
+        image->count    = count;
+        image->accesses = records;
+        image->base     = records;
+        image->bytes    = 0;
+
+        return true;
+    }
+
+    char tempFile[ LLC_IMAGE_PATH + 32 ];
+    snprintf( tempFile, sizeof(tempFile), "%s.%d", imageFile, (int) getpid() );
+
+    FILE *out = fopen( tempFile, "wb" );
+    if( out == NULL ) return false;
+
+    LLC_IMAGE_HEADER header;
+
+    memset( &header, 0, sizeof(header) );
+    fwrite( &header, sizeof(header), 1, out );
+
+    LLC_ACCESS *block = new LLC_ACCESS[ LLC_TRACE_BLOCK ];
+    UINT32     fill   = 0;
+
+    while( reader.Next( &access ) )
+    {
+        block[ fill++ ] = access;
+
+        if( fill == LLC_TRACE_BLOCK )
+        {
+            fwrite( block, sizeof(LLC_ACCESS), fill, out );
+            fill = 0;
+        }
+    }
+    fwrite( block, sizeof(LLC_ACCESS), fill, out );
+
+    delete [] block;
+
+    header.magic       = LLC_IMAGE_MAGIC;
+    header.version     = LLC_IMAGE_VERSION;
+    header.threads     = reader.Threads();
+    header.count       = reader.RecordsRead();
+    header.sourceBytes = source->st_size;
+    header.sourceMtime = ModificationTime( source );
+
+    fseek( out, 0, SEEK_SET );
+
+    bool ok = (fwrite( &header, sizeof(header), 1, out ) == 1);
+
+    ok = (fclose( out ) == 0) && ok;
+
+    if( !ok || rename( tempFile, imageFile ) != 0 )
+    {
+        unlink( tempFile );
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef LLC_TRACE_CACHE_H
+#define LLC_TRACE_CACHE_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Process-wide cache of decoded LLC streams (LLC_TRACE_READER::Open with     //
+// cached set). A stream that is replayed several times, e.g. once per        //
+// thread of a homogeneous mix or again for the -drift comparison, is         //
+// inflated and decoded only once into an image of LLC_ACCESS records.        //
+// Readers on the same file share the image and only keep a cursor into       //
+// it, so a rewind is a reset of that cursor.                                 //
+//                                                                            //
+// Images are reference counted and released with their last reader. When     //
+// CRC_TRACE_CACHE names a directory (/dev/shm keeps it in memory), images    //
+// are also kept there as files and mapped, so concurrent sweep jobs on the   //
+// same stream share one copy of the pages and later jobs skip decoding.      //
+// The file of an image is named after the stream's path and records its      //
+// size and modification time; a stale one is rebuilt.                        //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <pthread.h>
+#include <sys/stat.h>
+#include "llc_trace.h"
+
+#define LLC_IMAGE_MAGIC         0x474d49434c4cULL    // "LLCIMG"
+#define LLC_IMAGE_VERSION       1
+#define LLC_IMAGE_PATH          4096
+
+// Header of an image file; the records follow on the next 64-byte boundary
+typedef struct
+{
+    unsigned long long  magic;
+    UINT32              version;
+    UINT32              threads;
+    COUNTER             count;
+    unsigned long long  sourceBytes;
+    long long           sourceMtime;
+    UINT8               pad[ 24 ];
+} LLC_IMAGE_HEADER;
+
+typedef struct LLC_TRACE_IMAGE
+{
+    char                    path[ LLC_IMAGE_PATH ];   // stream file, resolved
+    UINT32                  threads;
+    const LLC_ACCESS        *accesses;
+    COUNTER                 count;
+
+    void                    *base;                    // mapping or heap block
+    size_t                  bytes;                    // 0 for a heap block
+    UINT32                  refs;
+
+    struct LLC_TRACE_IMAGE  *next;
+} LLC_TRACE_IMAGE;
+
+class LLC_TRACE_CACHE
+{
+  private:
+
+    static LLC_TRACE_IMAGE  *images;
+    static pthread_mutex_t  lock;
+
+  public:
+
+    // Returns the image of 'filename', decoding it if no reader holds it
+    // yet; NULL if the stream cannot be read
+    static LLC_TRACE_IMAGE *Acquire( const char *filename );
+    static void             Release( LLC_TRACE_IMAGE *image );
+
+  private:
+
+    static bool   Decode( LLC_TRACE_IMAGE *image, const char *filename );
+    static bool   Map( LLC_TRACE_IMAGE *image, const char *imageFile, const struct stat *source );
+    static bool   Build( LLC_TRACE_IMAGE *image, const char *filename, const char *imageFile, const struct stat *source );
+};
+
+#endif
@@ -0,0 +1,815 @@
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include "crc_cache.h"
+#include "llc_trace.h"
+#include "llc_shard.h"
+#include "llc_fanout.h"
+#include "llc_mrc.h"
+#include "llc_sample.h"
+#include "llc_opt.h"
+
+#define LLCSIM_MAX_RUNS     64           // caches replayed in one pass
+#define LLCSIM_BATCH        256          // accesses per LookupAndFillCacheBatch call
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// llcsim: trace driven LLC simulator. Replays an LLC access stream straight  //
+// into CRC_CACHE and prints the same statistics as CMP$im. No Pin and no     //
+// libCMPsim are needed, so sweeping LLC policies only pays for the LLC.      //
+//                                                                            //
+// Usage:                                                                     //
+//   llcsim -t <stream> | -mix <stream>,<stream>...                           //
+//          [-threads N] [-cache UL3:<KB>:<line>:<assoc>]                     //
+//          [-LLCrepl <policy>] [-seed N] [-o <stats file>]                   //
+//          [-shards N [-epoch N] [-drift]]                                   //
+//          [-checkpoint <file> -checkpointat N] [-restore <file>]            //
+//          [-warmup N] [-region N] [-pipeline N] [-tracecache <dir>]         //
+//          [-opt <dir>]                                                      //
+//                                                                            //
+// -LLCrepl and -cache take comma separated lists; the stream is then         //
+// replayed once into one cache per (configuration, policy) pair.             //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+static void Usage( const char *prog )
+{
+    cerr << "Usage: " << prog << " -t <LLC stream> | -mix <stream>,<stream>... [options]" << endl;
+    cerr << "\t-mix <stream>[,<stream>...]   replay stream t as thread t, rewinding each until all have finished" << endl;
+    cerr << "\t-tracecache <dir>             keep decoded streams in <dir>, e.g. /dev/shm (sets CRC_TRACE_CACHE)" << endl;
+    cerr << "\t-threads N                    hardware threads (default: from stream)" << endl;
+    cerr << "\t-cache UL3:<KB>:<line>:<assoc> LLC configurations, comma separated (default: UL3:1024:64:16)" << endl;
+    cerr << "\t-LLCrepl <policy>[,...]       policy numbers, names with :key=value parameters" << endl;
+    cerr << "\t                              or plugin.so[:args] (default: 0); built in:" << endl;
+    CRC_ListPolicies( cerr, "\t                                " );
+    cerr << "\t-seed N                       replacement policy random seed (default: CRC_SEED or built in)" << endl;
+    cerr << "\t-o <file>                     statistics output (default: stdout); with several caches" << endl;
+    cerr << "\t                              %p and %c in the name give one file per policy / cache size" << endl;
+    cerr << "\t-capture <file>               re-record the replayed stream (version 2 format)" << endl;
+    cerr << "\t-setsample N[:every]          simulate 1 in N sets, random or every Nth, and extrapolate (sets CRC_SET_SAMPLE)" << endl;
+    cerr << "\t-checkpoint <file>            save the cache state after -checkpointat N accesses" << endl;
+    cerr << "\t-restore <file>               start from a saved state, skipping the accesses it covers" << endl;
+    cerr << "\t-warmup N                     count nothing for the first N accesses (sets CRC_WARMUP)" << endl;
+    cerr << "\t-region N                     statistics per N accesses after warm-up (sets CRC_REGION)" << endl;
+    cerr << "\t-pipeline N                   read the stream on separate threads with N inflaters" << endl;
+    cerr << "\t-shards N                     replay with N worker threads, sets split across them" << endl;
+    cerr << "\t-epoch N                      accesses between shared predictor syncs (default: " << LLC_SHARD_EPOCH << ")" << endl;
+    cerr << "\t-drift                        also replay serially and report the sharded replay's drift" << endl;
+    cerr << "\t-opt <dir>                    also run Belady's OPT on every cache, next-use side file in <dir>" << endl;
+    cerr << "\t-mrc                          print LRU miss ratio curves instead of simulating a cache (approximate with writebacks)" << endl;
+    cerr << "\t-sample <minKB>:<maxKB>       print sampled miss ratio curves of the -LLCrepl policies" << endl;
+    cerr << "\t-samplesets N                 sets of each scaled-down cache (default: " << LLC_SAMPLE_SETS << ")" << endl;
+    cerr << "\t-mrcsets <min>:<max>          set counts of the curves (default: " << LLC_MRC_MIN_SETS << ":" << LLC_MRC_MAX_SETS << ")" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Parses a CMP$im style cache configuration string UL3:<KB>:<line>:<assoc>   //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static bool ParseCacheConfig( const char *config, UINT32 *sizeKB, UINT32 *linesize, UINT32 *assoc )
+{
+    char level[8];
+
+    if( sscanf( config, "%7[^:]:%u:%u:%u", level, sizeKB, linesize, assoc ) != 4 )
+    {
+        return false;
+    }
+
+    return (*sizeKB != 0) && (*linesize != 0) && (*assoc != 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Splits a comma separated option value in place. Returns the number of      //
+// items, or 0 if there are more than 'max'.                                  //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static UINT32 SplitList( char *list, char **items, UINT32 max )
+{
+    UINT32 count = 0;
+    char   *save = NULL;
+
+    for( char *item = strtok_r( list, ",", &save ); item != NULL; item = strtok_r( NULL, ",", &save ) )
+    {
+        if( count == max ) return 0;
+        items[ count++ ] = item;
+    }
+
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Output file of one cache of a multi-cache run: %p in 'pattern' becomes     //
+// the policy name, %c the cache size in KB.                                  //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static string ExpandOutputName( const char *pattern, UINT32 policy, UINT32 sizeKB )
+{
+    string name;
+    char   number[16];
+
+    for( const char *c = pattern; *c; c++ )
+    {
+        if( c[0] == '%' && c[1] == 'p' )
+        {
+            const char *policyName = CRC_PolicyName( policy );
+
+            if( policyName != NULL )
+            {
+                // A spec may hold a path and parameters
+                for( const char *n = policyName; *n; n++ )
+                {
+                    name += (*n == '/' || *n == ':' || *n == '=') ? '_' : *n;
+                }
+            }
+            else
+            {
+                snprintf( number, sizeof(number), "%u", policy );
+                name += number;
+            }
+            c++;
+        }
+        else if( c[0] == '%' && c[1] == 'c' )
+        {
+            snprintf( number, sizeof(number), "%u", sizeKB );
+            name += number;
+            c++;
+        }
+        else
+        {
+            name += *c;
+        }
+    }
+
+    return name;
+}
+
+// Replay target feeding a single cache, LLCSIM_BATCH accesses at a time;
+// Finish() hands over the last partial batch
+class SERIAL_REPLAY
+{
+  private:
+
+    CRC_CACHE  *llc;
+    LLC_ACCESS batch[ LLCSIM_BATCH ];
+    UINT32     count;
+
+  public:
+
+    SERIAL_REPLAY( CRC_CACHE *_llc ) { llc = _llc; count = 0; }
+
+    void Access( const LLC_ACCESS &access )
+    {
+        batch[ count++ ] = access;
+
+        if( count == LLCSIM_BATCH ) Finish();
+    }
+
+    void Finish()
+    {
+        llc->LookupAndFillCacheBatch( batch, count );
+        count = 0;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Feeds the stream to 'target': a single cache, a sharded replay, a fan      //
+// out to several caches or the miss ratio curve engine. Malformed records    //
+// are skipped and holes in the sequence numbers counted; both are            //
+// reported if 'report' is set, as are the stage statistics of a pipelined    //
+// reader. The first 'warm' accesses, already in a restored checkpoint, are   //
+// read but not replayed. 'opt', if given, sees every access as well.         //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+template <class TARGET>
+static void Replay( LLC_TRACE_READER &reader, UINT32 threads, TARGET *target, bool report, COUNTER warm = 0, LLC_OPT *opt = NULL )
+{
+    LLC_ACCESS  access;
+    COUNTER     skipped = 0;
+    COUNTER     gaps    = 0;
+    COUNTER     lastSeq = 0;
+
+    while( reader.Next( &access ) )
+    {
+        if( access.tid >= threads || access.accessType >= ACCESS_MAX )
+        {
+            skipped++;
+            continue;
+        }
+
+        // A hole in the sequence numbers means the capture lost records
+        if( access.seq != lastSeq + 1 ) gaps++;
+        lastSeq = access.seq;
+
+        if( warm != 0 )
+        {
+            warm--;
+            continue;
+        }
+
+        target->Access( access );
+
+        if( opt != NULL ) opt->Access( access );
+    }
+
+    if( skipped && report )
+    {
+        cerr << "llcsim: skipped " << skipped << " malformed records" << endl;
+    }
+
+    if( gaps && report )
+    {
+        cerr << "llcsim: " << gaps << " gaps in the stream sequence numbers" << endl;
+    }
+
+    if( report )
+    {
+        reader.PrintPipelineStats( cerr );
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Prints how far the demand misses of a sharded replay are from a serial     //
+// replay of the same stream, per thread and overall.                         //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static void ReportDrift( CRC_CACHE *sharded, CRC_CACHE *serial, UINT32 threads )
+{
+    COUNTER totSharded = 0, totSerial = 0;
+
+    for(UINT32 t=0; t<threads; t++)
+    {
+        COUNTER a = sharded->ThreadDemandMissStats( t );
+        COUNTER b = serial->ThreadDemandMissStats( t );
+
+        totSharded += a;
+        totSerial  += b;
+
+        if( b )
+        {
+            cerr << "llcsim: drift thread " << t << ": misses " << a << " sharded, " << b
+                 << " serial (" << ((double) a - (double) b) / (double) b * 100.0 << "%)" << endl;
+        }
+    }
+
+    if( totSerial )
+    {
+        cerr << "llcsim: drift total: misses " << totSharded << " sharded, " << totSerial
+             << " serial (" << ((double) totSharded - (double) totSerial) / (double) totSerial * 100.0 << "%)" << endl;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Replays the stream once into one cache per (configuration, policy) pair    //
+// and prints every cache's statistics, each block headed by its              //
+// configuration, and OPT's block after it if 'opt' is given. 'serialOnly'    //
+// is set when options that need a single cache were given.                   //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+static int ReplayMany( LLC_TRACE_READER &reader, UINT32 threads,
+                       const UINT32 *sizeKB, const UINT32 *linesize, const UINT32 *assoc, UINT32 numConfigs,
+                       const UINT32 *policies, UINT32 numPolicies,
+                       const char *seed, const char *outFile, bool serialOnly, LLC_OPT *opt )
+{
+    UINT32 runs = numConfigs * numPolicies;
+
+    if( serialOnly )
+    {
+        cerr << "llcsim: -shards, -drift and -capture need a single cache and policy" << endl;
+        return 1;
+    }
+
+    if( runs > LLCSIM_MAX_RUNS )
+    {
+        cerr << "llcsim: at most " << LLCSIM_MAX_RUNS << " caches per run" << endl;
+        return 1;
+    }
+
+    CRC_CACHE *caches[ LLCSIM_MAX_RUNS ];
+
+    for(UINT32 r=0; r<runs; r++)
+    {
+        UINT32 c = r / numPolicies;
+
+        caches[r] = new CRC_CACHE( sizeKB[c] * 1024, assoc[c], threads, linesize[c], policies[ r % numPolicies ] );
+
+        if( seed != NULL )
+        {
+            caches[r]->SeedRandom( strtoull( seed, NULL, 0 ) );
+        }
+    }
+
+    // A restored checkpoint already holds the start of the stream
+    COUNTER warm = caches[0]->Accesses();
+
+    LLC_FANOUT fanout( caches, runs );
+
+    Replay( reader, threads, &fanout, true, warm, opt );
+
+    fanout.Finish();
+
+    // One file per cache if the name says how to tell them apart
+    bool     perCache = (outFile != NULL) && (strstr( outFile, "%p" ) || strstr( outFile, "%c" ));
+    ofstream shared;
+
+    if( outFile != NULL && !perCache )
+    {
+        shared.open( outFile );
+    }
+
+    for(UINT32 r=0; r<runs; r++)
+    {
+        UINT32 c      = r / numPolicies;
+        UINT32 policy = policies[ r % numPolicies ];
+
+        if( perCache )
+        {
+            ofstream out( ExpandOutputName( outFile, policy, sizeKB[c] ).c_str() );
+            fanout.Cache( r )->PrintStats( out );
+            if( opt != NULL ) opt->PrintStats( out, c );
+            continue;
+        }
+
+        ostream &out = (outFile != NULL) ? (ostream &) shared : cout;
+
+        out << "LLC: UL3:" << sizeKB[c] << ":" << linesize[c] << ":" << assoc[c] << " LLCrepl: " << policy << endl;
+        fanout.Cache( r )->PrintStats( out );
+        if( opt != NULL ) opt->PrintStats( out, c );
+        out << endl;
+    }
+
+    return 0;
+}
+
+int main( int argc, char *argv[] )
+{
+    const char *traceFile  = NULL;
+    const char *outFile    = NULL;
+    const char *captureFile = NULL;
+    UINT32      threads    = 0;
+    UINT32      sizeKB[ LLCSIM_MAX_RUNS ]   = { 1024 };
+    UINT32      linesize[ LLCSIM_MAX_RUNS ] = { 64 };
+    UINT32      assoc[ LLCSIM_MAX_RUNS ]    = { 16 };
+    UINT32      numConfigs = 1;
+    UINT32      policies[ LLCSIM_MAX_RUNS ] = { CRC_REPL_LRU };
+    UINT32      numPolicies = 1;
+    char        *items[ LLCSIM_MAX_RUNS ];
+    const char *seed       = NULL;
+    UINT32      shards     = 1;
+    COUNTER     epoch      = LLC_SHARD_EPOCH;
+    bool        drift      = false;
+    bool        mrc        = false;
+    UINT32      mrcMinSets = LLC_MRC_MIN_SETS;
+    UINT32      mrcMaxSets = LLC_MRC_MAX_SETS;
+    bool        sample     = false;
+    UINT32      sampleMinKB = 0;
+    UINT32      sampleMaxKB = 0;
+    UINT32      sampleSets = LLC_SAMPLE_SETS;
+    const char *restoreFile = NULL;
+    const char *checkpointFile = NULL;
+    const char *checkpointAt = NULL;
+    const char *warmup     = NULL;
+    const char *region     = NULL;
+    UINT32      inflaters  = 0;
+    char        *mixFiles[ LLC_TRACE_MIX_MAX ];
+    UINT32      mixCount   = 0;
+    const char *traceCache = NULL;
+    const char *optDir     = NULL;
+
+    for( int i=1; i<argc; i++ )
+    {
+        if( !strcmp( argv[i], "-t" ) && i+1 < argc )
+        {
+            traceFile = argv[++i];
+        }
+        else if( !strcmp( argv[i], "-o" ) && i+1 < argc )
+        {
+            outFile = argv[++i];
+        }
+        else if( !strcmp( argv[i], "-capture" ) && i+1 < argc )
+        {
+            captureFile = argv[++i];
+        }
+        else if( !strcmp( argv[i], "-threads" ) && i+1 < argc )
+        {
+            threads = atoi( argv[++i] );
+        }
+        else if( !strcmp( argv[i], "-LLCrepl" ) && i+1 < argc )
+        {
+            numPolicies = SplitList( argv[++i], items, LLCSIM_MAX_RUNS );
+
+            if( numPolicies == 0 )
+            {
+                cerr << "Bad policy list" << endl;
+                return 1;
+            }
+
+            for(UINT32 p=0; p<numPolicies; p++)
+            {
+                policies[p] = CRC_RegisterPolicy( items[p] );
+
+                if( policies[p] == CRC_REPL_INVALID ) return 1;
+            }
+        }
+        else if( !strcmp( argv[i], "-setsample" ) && i+1 < argc )
+        {
+            // The caches read it at construction, as under CMP$im
+            setenv( "CRC_SET_SAMPLE", argv[++i], 1 );
+        }
+        else if( !strcmp( argv[i], "-warmup" ) && i+1 < argc )
+        {
+            warmup = argv[++i];
+        }
+        else if( !strcmp( argv[i], "-region" ) && i+1 < argc )
+        {
+            region = argv[++i];
+        }
+        else if( !strcmp( argv[i], "-restore" ) && i+1 < argc )
+        {
+            restoreFile = argv[++i];
+        }
+        else if( !strcmp( argv[i], "-checkpoint" ) && i+1 < argc )
+        {
+            checkpointFile = argv[++i];
+        }
+        else if( !strcmp( argv[i], "-checkpointat" ) && i+1 < argc )
+        {
+            checkpointAt = argv[++i];
+        }
+        else if( !strcmp( argv[i], "-mix" ) && i+1 < argc )
+        {
+            mixCount = SplitList( argv[++i], mixFiles, LLC_TRACE_MIX_MAX );
+
+            if( mixCount == 0 )
+            {
+                cerr << "Bad stream list" << endl;
+                return 1;
+            }
+        }
+        else if( !strcmp( argv[i], "-tracecache" ) && i+1 < argc )
+        {
+            traceCache = argv[++i];
+        }
+        else if( !strcmp( argv[i], "-opt" ) && i+1 < argc )
+        {
+            optDir = argv[++i];
+        }
+        else if( !strcmp( argv[i], "-pipeline" ) && i+1 < argc )
+        {
+            inflaters = atoi( argv[++i] );
+        }
+        else if( !strcmp( argv[i], "-shards" ) && i+1 < argc )
+        {
+            shards = atoi( argv[++i] );
+        }
+        else if( !strcmp( argv[i], "-epoch" ) && i+1 < argc )
+        {
+            epoch = strtoull( argv[++i], NULL, 0 );
+        }
+        else if( !strcmp( argv[i], "-drift" ) )
+        {
+            drift = true;
+        }
+        else if( !strcmp( argv[i], "-mrc" ) )
+        {
+            mrc = true;
+        }
+        else if( !strcmp( argv[i], "-sample" ) && i+1 < argc )
+        {
+            sample = true;
+
+            if( sscanf( argv[++i], "%u:%u", &sampleMinKB, &sampleMaxKB ) != 2 ||
+                sampleMinKB == 0 || sampleMinKB > sampleMaxKB )
+            {
+                cerr << "Bad size range: " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else if( !strcmp( argv[i], "-samplesets" ) && i+1 < argc )
+        {
+            sampleSets = atoi( argv[++i] );
+
+            if( sampleSets == 0 || (sampleSets & (sampleSets - 1)) )
+            {
+                cerr << "Bad sample set count (power of two): " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else if( !strcmp( argv[i], "-mrcsets" ) && i+1 < argc )
+        {
+            if( sscanf( argv[++i], "%u:%u", &mrcMinSets, &mrcMaxSets ) != 2 ||
+                mrcMinSets == 0 || (mrcMinSets & (mrcMinSets - 1)) || (mrcMaxSets & (mrcMaxSets - 1)) ||
+                mrcMinSets > mrcMaxSets )
+            {
+                cerr << "Bad set count range (powers of two): " << argv[i] << endl;
+                return 1;
+            }
+        }
+        else if( !strcmp( argv[i], "-seed" ) && i+1 < argc )
+        {
+            seed = argv[++i];
+        }
+        else if( !strcmp( argv[i], "-cache" ) && i+1 < argc )
+        {
+            numConfigs = SplitList( argv[++i], items, LLCSIM_MAX_RUNS );
+
+            if( numConfigs == 0 )
+            {
+                cerr << "Bad cache configuration list" << endl;
+                return 1;
+            }
+
+            for(UINT32 c=0; c<numConfigs; c++)
+            {
+                if( !ParseCacheConfig( items[c], &sizeKB[c], &linesize[c], &assoc[c] ) )
+                {
+                    cerr << "Bad cache configuration: " << items[c] << endl;
+                    return 1;
+                }
+            }
+        }
+        else
+        {
+            Usage( argv[0] );
+            return 1;
+        }
+    }
+
+    if( (traceFile == NULL) == (mixCount == 0) )
+    {
+        Usage( argv[0] );
+        return 1;
+    }
+
+    if( drift && shards <= 1 )
+    {
+        cerr << "llcsim: -drift needs -shards" << endl;
+        return 1;
+    }
+
+    LLC_TRACE_READER reader;
+
+    if( traceCache != NULL ) setenv( "CRC_TRACE_CACHE", traceCache, 1 );
+
+    // Mixes and cached streams are read from decoded images
+    bool cached = (mixCount != 0) || (getenv( "CRC_TRACE_CACHE" ) != NULL);
+
+    if( cached && inflaters > 0 )
+    {
+        cerr << "llcsim: -pipeline cannot be combined with -mix or -tracecache" << endl;
+        return 1;
+    }
+
+    if( mixCount != 0 ? !reader.OpenMix( mixFiles, mixCount ) : !reader.Open( traceFile, inflaters, cached ) )
+    {
+        return 1;
+    }
+
+    if( threads == 0 ) threads = reader.Threads();
+    if( threads == 0 ) threads = 1;
+
+    // Every CRC_CACHE reads CRC_CAPTURE and CRC_CHECKPOINT, so with more
+    // than one cache they would all write the same file
+    bool severalCaches = (shards > 1) || drift || sample || (numConfigs * numPolicies > 1);
+    const char *envCapture    = getenv( "CRC_CAPTURE" );
+    const char *envCheckpoint = getenv( "CRC_CHECKPOINT" );
+
+    if( severalCaches && ((envCapture != NULL && envCapture[0] != '\0') || (envCheckpoint != NULL && envCheckpoint[0] != '\0')) )
+    {
+        cerr << "llcsim: CRC_CAPTURE and CRC_CHECKPOINT need a single cache, not -shards, -drift, -sample or several caches" << endl;
+        return 1;
+    }
+
+    // Checkpoints, warm-up and regions count the accesses of a whole
+    // cache; like set sampling they are handed to it through the
+    // environment
+    if( restoreFile != NULL || checkpointFile != NULL || warmup != NULL || region != NULL )
+    {
+        if( mrc || sample || shards > 1 )
+        {
+            cerr << "llcsim: -restore, -checkpoint, -warmup and -region cannot be combined with -mrc, -sample or -shards" << endl;
+            return 1;
+        }
+
+        if( checkpointFile != NULL && (checkpointAt == NULL || numConfigs * numPolicies > 1) )
+        {
+            cerr << "llcsim: -checkpoint needs -checkpointat and a single cache and policy" << endl;
+            return 1;
+        }
+
+        // Every cache skips the accesses of the first one's checkpoint
+        if( restoreFile != NULL && numConfigs > 1 )
+        {
+            cerr << "llcsim: -restore needs a single cache configuration" << endl;
+            return 1;
+        }
+
+        if( restoreFile != NULL ) setenv( "CRC_RESTORE", restoreFile, 1 );
+        if( checkpointFile != NULL )
+        {
+            setenv( "CRC_CHECKPOINT", checkpointFile, 1 );
+            setenv( "CRC_CHECKPOINT_AT", checkpointAt, 1 );
+        }
+
+        if( warmup != NULL ) setenv( "CRC_WARMUP", warmup, 1 );
+        if( region != NULL ) setenv( "CRC_REGION", region, 1 );
+    }
+
+    // OPT: a first pass over the stream for the next uses, then a rewind;
+    // OPT's caches then run beside the replay
+    LLC_OPT *opt = NULL;
+
+    if( optDir != NULL )
+    {
+        if( mrc || sample || restoreFile != NULL || checkpointFile != NULL || warmup != NULL || region != NULL )
+        {
+            cerr << "llcsim: -opt cannot be combined with -mrc, -sample, -restore, -checkpoint, -warmup or -region" << endl;
+            return 1;
+        }
+
+        for(UINT32 c=1; c<numConfigs; c++)
+        {
+            if( linesize[c] != linesize[0] )
+            {
+                cerr << "llcsim: -opt needs the same line size in every cache" << endl;
+                return 1;
+            }
+        }
+
+        LLC_NEXT_USE *nextUse = new LLC_NEXT_USE( linesize[0] );
+
+        if( !nextUse->Create( optDir ) ) return 1;
+
+        Replay( reader, threads, nextUse, false );
+
+        if( !nextUse->Finish() || !reader.Rewind() ) return 1;
+
+        opt = new LLC_OPT( nextUse, threads, linesize[0], sizeKB, assoc, numConfigs );
+    }
+
+    if( mrc )
+    {
+        if( shards > 1 || drift || captureFile != NULL || numConfigs > 1 )
+        {
+            cerr << "llcsim: -mrc cannot be combined with -shards, -drift, -capture or several caches" << endl;
+            return 1;
+        }
+
+        LLC_MRC curves( linesize[0], mrcMinSets, mrcMaxSets );
+
+        Replay( reader, threads, &curves, true );
+
+        if( outFile != NULL )
+        {
+            ofstream out( outFile );
+            curves.PrintStats( out );
+        }
+        else
+        {
+            curves.PrintStats( cout );
+        }
+
+        return 0;
+    }
+
+    if( sample )
+    {
+        if( shards > 1 || drift || captureFile != NULL || numConfigs > 1 || mrc || numPolicies > LLC_SAMPLE_MAX_POLICIES )
+        {
+            cerr << "llcsim: -sample takes one -cache and cannot be combined with -shards, -drift, -capture or -mrc" << endl;
+            return 1;
+        }
+
+        // 64 bits, so that doubling past the largest UINT32 size ends the loop
+        COUNTER kb       = sampleMinKB;
+        UINT32  numSizes = 0;
+
+        for( ; kb<=sampleMaxKB && numSizes<LLC_SAMPLE_MAX_SIZES; kb*=2, numSizes++)
+        {
+            COUNTER sets = kb * 1024 / (linesize[0] * assoc[0]);
+
+            if( sets == 0 || (sets & (sets - 1)) || sets > 0x80000000ULL )
+            {
+                cerr << "llcsim: -sample needs power of two set counts, " << kb << "KB has " << sets << endl;
+                return 1;
+            }
+        }
+
+        if( kb <= sampleMaxKB )
+        {
+            cerr << "llcsim: -sample takes at most " << LLC_SAMPLE_MAX_SIZES << " cache sizes" << endl;
+            return 1;
+        }
+
+        LLC_SAMPLED_MRC curves( threads, linesize[0], assoc[0], sampleMinKB, sampleMaxKB, policies, numPolicies, sampleSets );
+
+        if( seed != NULL )
+        {
+            curves.SeedRandom( strtoull( seed, NULL, 0 ) );
+        }
+
+        Replay( reader, threads, &curves, true );
+
+        if( outFile != NULL )
+        {
+            ofstream out( outFile );
+            curves.PrintStats( out );
+        }
+        else
+        {
+            curves.PrintStats( cout );
+        }
+
+        return 0;
+    }
+
+    if( numConfigs * numPolicies > 1 )
+    {
+        return ReplayMany( reader, threads, sizeKB, linesize, assoc, numConfigs, policies, numPolicies,
+                           seed, outFile, (shards > 1) || drift || (captureFile != NULL), opt );
+    }
+
+    UINT32 replPolicy = policies[0];
+
+    CRC_CACHE          *llc     = NULL;
+    LLC_SHARDED_REPLAY *sharded = NULL;
+
+    if( shards > 1 )
+    {
+        if( captureFile != NULL )
+        {
+            cerr << "llcsim: -capture needs a serial replay" << endl;
+            return 1;
+        }
+
+        sharded = new LLC_SHARDED_REPLAY( sizeKB[0] * 1024, assoc[0], threads, linesize[0], replPolicy, shards, epoch );
+
+        if( seed != NULL )
+        {
+            sharded->SeedRandom( strtoull( seed, NULL, 0 ) );
+        }
+
+        Replay( reader, threads, sharded, true, 0, opt );
+
+        llc = sharded->Finish();
+    }
+    else
+    {
+        llc = new CRC_CACHE( sizeKB[0] * 1024, assoc[0], threads, linesize[0], replPolicy );
+
+        if( seed != NULL )
+        {
+            llc->SeedRandom( strtoull( seed, NULL, 0 ) );
+        }
+
+        if( captureFile != NULL && !llc->EnableCapture( captureFile ) )
+        {
+            return 1;
+        }
+
+        SERIAL_REPLAY serial( llc );
+
+        Replay( reader, threads, &serial, true, llc->Accesses(), opt );
+
+        serial.Finish();
+
+        llc->DisableCapture();
+    }
+
+    if( outFile != NULL )
+    {
+        ofstream out( outFile );
+        llc->PrintStats( out );
+        if( opt != NULL ) opt->PrintStats( out, 0 );
+    }
+    else
+    {
+        llc->PrintStats( cout );
+        if( opt != NULL ) opt->PrintStats( cout, 0 );
+    }
+
+    if( drift && sharded != NULL && reader.Rewind() )
+    {
+        CRC_CACHE serial( sizeKB[0] * 1024, assoc[0], threads, linesize[0], replPolicy );
+
+        if( seed != NULL )
+        {
+            serial.SeedRandom( strtoull( seed, NULL, 0 ) );
+        }
+
+        SERIAL_REPLAY target( &serial );
+
+        Replay( reader, threads, &target, false );
+
+        target.Finish();
+
+        ReportDrift( llc, &serial, threads );
+    }
+
+    return 0;
+}
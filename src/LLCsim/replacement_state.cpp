@@ -35,13 +35,45 @@ CACHE_REPLACEMENT_STATE::CACHE_REPLACEMENT_STATE( UINT32 _sets, UINT32 _assoc, U
 
     numsets    = _sets;
     assoc      = _assoc;
-    replPolicy = _pol;
+    policyId   = _pol;
+    replPolicy = CRC_PolicyBase(_pol);
 
     mytimer    = 0;
+    lineShift  = 6;
+
+    // Runs are reproducible for a given seed; CRC_SEED overrides the default
+    const char *seed = getenv( "CRC_SEED" );
+    if( seed != NULL && seed[0] != '\0' )
+    {
+        rng.Seed( strtoull( seed, NULL, 0 ) );
+    }
 
     InitReplacementState();
 }
 
+// A plugin's state is not freed: version 1 of the plugin API has no hook
+// for it (see crc_policy.h)
+CACHE_REPLACEMENT_STATE::~CACHE_REPLACEMENT_STATE()
+{
+    free(meta);
+    free(rrpvWays);
+
+    delete [] setDuelingType;
+    delete [] SHCT;
+    delete [] predictor;
+    delete [] optgenSlot;
+
+    delete EAF;
+    delete perceptron;
+    delete sdbp;
+}
+
+void CACHE_REPLACEMENT_STATE::SeedRandom( UINT64 seed )
+{
+    rng.Seed( seed );
+    ChooseLeaderSets();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
 // This function initializes the replacement policy hardware by creating      //
@@ -50,153 +82,561 @@ CACHE_REPLACEMENT_STATE::CACHE_REPLACEMENT_STATE( UINT32 _sets, UINT32 _assoc, U
 ////////////////////////////////////////////////////////////////////////////////
 void CACHE_REPLACEMENT_STATE::InitReplacementState()
 {
-    // Create the state for sets, then create the state for the ways
-    repl  = new LINE_REPLACEMENT_STATE* [ numsets ];
-
-    // ensure that we were able to create replacement state
-    assert(repl);
-
-    // Create the state for the sets
-    for(UINT32 setIndex=0; setIndex<numsets; setIndex++) 
+    bool useRRVP = (replPolicy == CRC_REPL_DRRIP || replPolicy == CRC_REPL_SHIP || replPolicy == CRC_REPL_EAF_RRIP
+                    || replPolicy == CRC_REPL_HAWKEYE || replPolicy == CRC_REPL_PERCEPTRON);
+    bool useSHiP = (replPolicy == CRC_REPL_SHIP || replPolicy == CRC_REPL_HAWKEYE);
+    bool useLRU  = (replPolicy == CRC_REPL_LRU || replPolicy == CRC_REPL_EAF || replPolicy == CRC_REPL_SDBP);
+    bool useDead = (replPolicy == CRC_REPL_SDBP);
+
+    const CRC_POLICY_PARAMS *params = CRC_PolicyParams(policyId);
+
+    plugin = CRC_PolicyOps(policyId);
+    pluginState = NULL;
+
+    setBits = CRC_CeilLog2(numsets);
+
+    // Lay out the per-set block: RRVPs first (16-byte aligned for the
+    // victim search), then the SHiP entries, then the dead ways; a
+    // plugin's line state takes the whole block
+    rrpvStride = (assoc + 15) & ~15;
+    rrpvOffset = 0;
+    shipOffset = useRRVP ? rrpvStride : 0;
+    deadOffset = shipOffset + (useSHiP ? 2 * ((assoc + 7) & ~7) : 0);
+    pluginOffset = 0;
+    metaStride = deadOffset + (useDead ? sizeof(BITVECTOR) : 0);
+    if (plugin != NULL)
+        metaStride = plugin->lineStateBytes * assoc;
+
+    // Round up so that sets do not straddle host cache lines
+    if (metaStride > 32)
+        metaStride = (metaStride + 63) & ~63;
+    else if (metaStride > 16)
+        metaStride = 32;
+
+    meta = NULL;
+    rrpvWays = NULL;
+    if (metaStride != 0)
     {
-        repl[ setIndex ]  = new LINE_REPLACEMENT_STATE[ assoc ];
-
-        for(UINT32 way=0; way<assoc; way++) 
+        size_t bytes = (size_t) numsets * metaStride;
+        if (posix_memalign((void **) &meta, 64, bytes) != 0 || posix_memalign((void **) &rrpvWays, 64, rrpvStride) != 0)
         {
-            // initialize stack position (for true LRU)
-            repl[ setIndex ][ way ].LRUstackposition = way;
-            // initialize RRVP for RRIP policy
-            repl[ setIndex][ way ].RRVP = RRIP_MAX;
-            // initialize outcome bit for SHiP-PC
-            repl[ setIndex][ way ].outcome = false;
+            cout << "CACHE_REPLACEMENT_STATE: cannot allocate " << bytes << " bytes of replacement state" << endl;
+            exit(1);
         }
+        memset(meta, 0, bytes);
+
+        for (UINT32 way=0; way<rrpvStride; way++)
+            rrpvWays[way] = (way < assoc) ? 0xff : 0;
     }
 
-    // PSEL Initialization for DRRIP & D-EAF
-    PSEL = 0;
+    // LRU & D-EAF & SDBP
+    // Recency order, way 0 most recent (see crc_lru.h)
+    if (useLRU)
+        lru.Init(numsets, assoc);
+
+    // DRRIP & SHiP-PC & EAF_RRIP & Hawkeye & perceptron
+    // initialize RRVP for RRIP policy; padding ways stay at 0
+    // SHiP-PC outcome bits and signatures start at 0 from the memset
+    if (useRRVP)
+    {
+        UINT8 rrpvInit = (replPolicy == CRC_REPL_HAWKEYE) ? HAWKEYE_RRPV_MAX : RRIP_MAX;
+        for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
+            for (UINT32 way=0; way<assoc; way++)
+                RRVP(setIndex, way) = rrpvInit;
+    }
+
+    // PSEL Initialization for DRRIP & D-EAF & SDBP
+    PSEL = (replPolicy == CRC_REPL_SDBP) ? PSEL_MAX_SDBP/2 : 0;
+    if (params->bimodal != 0)
+        bimodal = params->bimodal;
+    else if (replPolicy == CRC_REPL_EAF)
+        bimodal = BIOMODAL_PROBABILITY_EAF;
+    else if (replPolicy == CRC_REPL_EAF_RRIP)
+        bimodal = BIOMODAL_PROBABILITY_EAF_RRIP;
+    else
+        bimodal = BIOMODAL_PROBABILITY;
     
     // ------------------------Private Variables per Policy
-    // DRRIP
+    // DRRIP & D-EAF & SDBP
     // Set Dueling Initialization
-    if (replPolicy == CRC_REPL_DRRIP) 
+    // At most half the sets lead, so that tiny caches still have followers
+    setDuelingType = NULL;
+    leaderSets = (replPolicy == CRC_REPL_DRRIP) ? NumLeaderSets : ((replPolicy == CRC_REPL_SDBP) ? NumLeaderSetsSDBP : NumLeaderSetsEAF);
+    if (leaderSets > numsets / 2)
+        leaderSets = numsets / 2;
+    if (replPolicy == CRC_REPL_DRRIP || replPolicy == CRC_REPL_EAF || replPolicy == CRC_REPL_SDBP) 
     {
-        setDuelingType = new UINT32 [numsets];
-        std::map<UINT32,UINT32> duel;
-
-        for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
-            setDuelingType[setIndex] = SDM_FOLLOWER;
-
-        // Create Leader Sets Randomely
-        for (UINT32 iteration=0; iteration<NumLeaderSets; iteration++) {
-            UINT32 setNo;
-            do { setNo = rand() % numsets;
-            } while(duel.find(setNo)!=duel.end());
-            if (iteration%2) {
-                duel[setNo] = SDM_LEADER_SRRIP;
-                setDuelingType[setNo] = SDM_LEADER_SRRIP; 
-            }
-            else {
-                duel[setNo] = SDM_LEADER_BRRIP;
-                setDuelingType[setNo] = SDM_LEADER_BRRIP;
-            }
-        }
+        setDuelingType = new UINT8 [numsets];
+        ChooseLeaderSets();
     }
 
     // SHiP-PC
-    // This assignment is based on that all signatures 
-    // will fill the SHCT - or NumSHCTEnties = 2^NumSigBits
+    // Flat table with one saturating counter per signature
+    // 2^sigBits entries, so every signature has an entry
+    SHCT = NULL;
+    sigBits = (params->sigBits != 0) ? params->sigBits : ((replPolicy == CRC_REPL_HAWKEYE) ? HAWKEYE_SIG_BITS : NumSigBits);
+    shctEntries = 1U << sigBits;
+    shctMask = shctEntries - 1;
     if (replPolicy == CRC_REPL_SHIP) 
     {
-        for (UINT32 entry=0; entry<NumSHCTEnties; entry++)
+        SHCT = new UINT8 [shctEntries];
+        for (UINT32 entry=0; entry<shctEntries; entry++)
             SHCT[entry] = 0;
     }
 
     // D-EAF & EAF_RRIP
-    // for the bloom filter, we will use a map, and the key is the counter
-    // it is easier to do a search
-    counter_EAF = 0; 
+    // The EAF is a Bloom filter sized for BLOOM_MAX_COUNTER addresses
+    EAF = NULL;
+    if (replPolicy == CRC_REPL_EAF || replPolicy == CRC_REPL_EAF_RRIP)
+        EAF = new BLOOM_FILTER(BLOOM_MAX_COUNTER, BLOOM_BITS_PER_ELEMENT, BLOOM_NUM_HASHES);
+
+    // Hawkeye
+    // Signatures start friendly; OPTgen follows evenly spaced sets
+    predictor = NULL;
+    optgenSlot = NULL;
+    sampledSets = 0;
+    friendlyFills = averseFills = friendlyEvictions = 0;
+    if (replPolicy == CRC_REPL_HAWKEYE)
+    {
+        predictor = new UINT8 [shctEntries];
+        for (UINT32 entry=0; entry<shctEntries; entry++)
+            predictor[entry] = HAWKEYE_FRIENDLY;
+
+        sampledSets = (numsets < HAWKEYE_SAMPLED_SETS) ? numsets : HAWKEYE_SAMPLED_SETS;
+        optgenSlot = new UINT8 [numsets];
+        memset(optgenSlot, HAWKEYE_NOT_SAMPLED, numsets);
+        for (UINT32 slot=0; slot<sampledSets; slot++)
+            optgenSlot[(size_t) slot * numsets / sampledSets] = slot;
+        optgen.Init(sampledSets, assoc);
+    }
 
-    // D-EAF
-    // Set Dueling Initialization
-    // Duel between LRU and EAF
-    if (replPolicy == CRC_REPL_EAF) 
+    // Perceptron
+    // Weights start at 0: nothing is predicted dead until the sampler says so
+    perceptron = NULL;
+    perceptronPending = false;
+    deadFills = liveFills = 0;
+    if (replPolicy == CRC_REPL_PERCEPTRON)
+        perceptron = new CRC_PERCEPTRON(numsets, assoc);
+
+    // SDBP
+    // Counters start at 0, predicting every block live; the dead ways
+    // start clear from the memset above
+    sdbp = NULL;
+    deadVictims = lruVictims = 0;
+    if (replPolicy == CRC_REPL_SDBP)
+        sdbp = new CRC_SDBP(numsets);
+
+    bypassedFills = 0;
+
+    // Plugin
+    if (plugin != NULL)
+        pluginState = plugin->Create(numsets, assoc, CRC_PolicyArgs(policyId));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Sampled simulation (llcsim -sample): a cache with 1/2^shift of the sets    //
+// of the one it models, seeing 1/2^shift of the lines. The leader sets       //
+// keep their share of the sets, one per policy at least, and the EAF         //
+// tracks as many addresses as the small cache has blocks.                    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CACHE_REPLACEMENT_STATE::ScaleDown( UINT32 shift )
+{
+    if (setDuelingType != NULL)
+    {
+        UINT32 leaders = (replPolicy == CRC_REPL_DRRIP) ? NumLeaderSets : ((replPolicy == CRC_REPL_SDBP) ? NumLeaderSetsSDBP : NumLeaderSetsEAF);
+
+        leaderSets = (leaders >> shift < 2) ? 2 : leaders >> shift;
+        if (leaderSets > numsets / 2)
+            leaderSets = numsets / 2;
+
+        ChooseLeaderSets();
+    }
+
+    if (EAF != NULL)
+    {
+        UINT32 capacity = BLOOM_MAX_COUNTER >> shift;
+
+        delete EAF;
+        EAF = new BLOOM_FILTER((capacity != 0) ? capacity : 1, BLOOM_BITS_PER_ELEMENT, BLOOM_NUM_HASHES);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Checkpoint sections are per component and independent of the in-memory     //
+// layout: the LRU order as ways from MRU to LRU whatever LRU_IMPL is, and    //
+// RRPVs and SHiP entries as plain per-line arrays rather than the packed     //
+// per-set blocks. DRRIP and EAF-RRIP can thus share RRPVs, and a cache       //
+// warmed under any policy gives every other policy its tags.                 //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CACHE_REPLACEMENT_STATE::SaveState( CRC_CHECKPOINT_WRITER &writer )
+{
+    UINT64 random = rng.State();
+    size_t lines  = (size_t) numsets * assoc;
+
+    writer.Section(CKPT_REPL_TIMER, &mytimer, sizeof(mytimer));
+    writer.Section(CKPT_REPL_RANDOM, &random, sizeof(random));
+
+    if (replPolicy == CRC_REPL_LRU || replPolicy == CRC_REPL_EAF || replPolicy == CRC_REPL_SDBP)
     {
-        setDuelingType = new UINT32 [numsets];
-        std::map<UINT32,UINT32> duel;
+        UINT8 *order = new UINT8 [lines];
+        for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
+            lru.GetOrder(setIndex, &order[(size_t) setIndex * assoc]);
+        writer.Section(CKPT_REPL_LRU_ORDER, order, lines);
+        delete [] order;
+    }
 
+    if (replPolicy == CRC_REPL_DRRIP || replPolicy == CRC_REPL_SHIP || replPolicy == CRC_REPL_EAF_RRIP
+        || replPolicy == CRC_REPL_HAWKEYE || replPolicy == CRC_REPL_PERCEPTRON)
+    {
+        UINT8 *rrpv = new UINT8 [lines];
         for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
-            setDuelingType[setIndex] = SDM_FOLLOWER;
-
-        // Create Leader Sets Randomely
-        for (UINT32 iteration=0; iteration<NumLeaderSetsEAF; iteration++) {
-            UINT32 setNo;
-            do { setNo = rand() % numsets;
-            } while(duel.find(setNo)!=duel.end());
-            if (iteration%2) {
-                duel[setNo] = SDM_LEADER_LRU;
-                setDuelingType[setNo] = SDM_LEADER_LRU; 
-            }
-            else {
-                duel[setNo] = SDM_LEADER_EAF;
-                setDuelingType[setNo] = SDM_LEADER_EAF;
-            }
+            for (UINT32 way=0; way<assoc; way++)
+                rrpv[(size_t) setIndex * assoc + way] = RRVP(setIndex, way);
+        writer.Section(CKPT_REPL_RRPV, rrpv, lines);
+        delete [] rrpv;
+    }
+
+    if (SHCT != NULL)
+    {
+        UINT16 *ship = new UINT16 [lines];
+        for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
+            for (UINT32 way=0; way<assoc; way++)
+                ship[(size_t) setIndex * assoc + way] = SHiPEntry(setIndex, way);
+        writer.Section(CKPT_REPL_SHIP, ship, lines * sizeof(UINT16));
+        delete [] ship;
+
+        writer.Section(CKPT_REPL_SHCT, SHCT, shctEntries);
+    }
+
+    if (predictor != NULL)
+    {
+        UINT16 *signatures = new UINT16 [lines];
+        for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
+            for (UINT32 way=0; way<assoc; way++)
+                signatures[(size_t) setIndex * assoc + way] = SHiPEntry(setIndex, way);
+        writer.Section(CKPT_REPL_HAWKEYE, predictor, shctEntries, signatures, lines * sizeof(UINT16));
+        delete [] signatures;
+
+        optgen.Save(writer, CKPT_REPL_OPTGEN, CKPT_REPL_OPTGEN_SAMPLER);
+    }
+
+    if (perceptron != NULL)
+    {
+        perceptron->Save(writer, CKPT_REPL_PERCEPTRON);
+        perceptron->SaveSampler(writer, CKPT_REPL_PERCEPTRON_SAMPLER, CKPT_REPL_PERCEPTRON_HISTORY);
+    }
+
+    if (sdbp != NULL)
+    {
+        BITVECTOR *dead = new BITVECTOR [numsets];
+        for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
+            dead[setIndex] = DeadWays(setIndex);
+        sdbp->Save(writer, CKPT_REPL_SDBP, dead, numsets * sizeof(BITVECTOR));
+        delete [] dead;
+
+        sdbp->SaveSampler(writer, CKPT_REPL_SDBP_SAMPLER);
+    }
+
+    if (setDuelingType != NULL)
+    {
+        CRC_CHECKPOINT_DUELING dueling;
+        dueling.replPolicy = replPolicy;
+        dueling.PSEL       = PSEL;
+        dueling.leaderSets = leaderSets;
+        dueling.numsets    = numsets;
+        writer.Section(CKPT_REPL_DUELING, &dueling, sizeof(dueling), setDuelingType, numsets);
+    }
+
+    if (EAF != NULL)
+        EAF->Save(writer, CKPT_REPL_EAF);
+}
+
+void CACHE_REPLACEMENT_STATE::LoadState( CRC_CHECKPOINT_READER &reader )
+{
+    UINT64 random = 0;
+    size_t lines  = (size_t) numsets * assoc;
+    size_t bytes  = 0;
+
+    // The timer first: the timestamp LRU encoding is relative to it
+    if (!reader.Read(CKPT_REPL_TIMER, &mytimer, sizeof(mytimer)))
+        cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no timer" << endl;
+
+    if (reader.Read(CKPT_REPL_RANDOM, &random, sizeof(random)))
+        rng.Seed(random);
+
+    if (replPolicy == CRC_REPL_LRU || replPolicy == CRC_REPL_EAF || replPolicy == CRC_REPL_SDBP)
+    {
+        const UINT8 *order = (const UINT8 *) reader.Find(CKPT_REPL_LRU_ORDER, &bytes);
+        if (order != NULL && bytes == lines)
+        {
+            for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
+                lru.SetOrder(setIndex, &order[(size_t) setIndex * assoc], mytimer);
+        }
+        else
+            cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no LRU order, starting it cold" << endl;
+    }
+
+    if (replPolicy == CRC_REPL_DRRIP || replPolicy == CRC_REPL_SHIP || replPolicy == CRC_REPL_EAF_RRIP
+        || replPolicy == CRC_REPL_HAWKEYE || replPolicy == CRC_REPL_PERCEPTRON)
+    {
+        // Hawkeye's RRPVs go to 7, the others' to 3
+        UINT8 rrpvMax = (replPolicy == CRC_REPL_HAWKEYE) ? HAWKEYE_RRPV_MAX : RRIP_MAX;
+        const UINT8 *rrpv = (const UINT8 *) reader.Find(CKPT_REPL_RRPV, &bytes);
+        if (rrpv != NULL && bytes == lines)
+        {
+            for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
+                for (UINT32 way=0; way<assoc; way++)
+                {
+                    UINT8 value = rrpv[(size_t) setIndex * assoc + way];
+                    RRVP(setIndex, way) = (value > rrpvMax) ? rrpvMax : value;
+                }
+        }
+        else
+            cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no RRPVs, starting them cold" << endl;
+    }
+
+    if (SHCT != NULL)
+    {
+        const UINT16 *ship = (const UINT16 *) reader.Find(CKPT_REPL_SHIP, &bytes);
+        if (ship != NULL && bytes == lines * sizeof(UINT16))
+        {
+            for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
+                for (UINT32 way=0; way<assoc; way++)
+                    SHiPEntry(setIndex, way) = ship[(size_t) setIndex * assoc + way];
+        }
+        else
+            cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no SHiP line state, starting it cold" << endl;
+
+        if (!reader.Read(CKPT_REPL_SHCT, SHCT, shctEntries))
+            cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no SHCT, starting it cold" << endl;
+    }
+
+    if (predictor != NULL)
+    {
+        const UINT8 *payload = (const UINT8 *) reader.Find(CKPT_REPL_HAWKEYE, &bytes);
+        if (payload != NULL && bytes == shctEntries + lines * sizeof(UINT16))
+        {
+            const UINT16 *signatures = (const UINT16 *) (payload + shctEntries);
+
+            memcpy(predictor, payload, shctEntries);
+            for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
+                for (UINT32 way=0; way<assoc; way++)
+                    SHiPEntry(setIndex, way) = signatures[(size_t) setIndex * assoc + way];
+        }
+        else
+            cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no Hawkeye predictor, starting it cold" << endl;
+
+        if (!optgen.Load(reader, CKPT_REPL_OPTGEN, CKPT_REPL_OPTGEN_SAMPLER))
+            cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no OPTgen history, starting it cold" << endl;
+    }
+
+    if (perceptron != NULL)
+    {
+        if (!perceptron->Load(reader, CKPT_REPL_PERCEPTRON))
+            cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no perceptron weights, starting them cold" << endl;
+
+        if (!perceptron->LoadSampler(reader, CKPT_REPL_PERCEPTRON_SAMPLER, CKPT_REPL_PERCEPTRON_HISTORY))
+            cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no perceptron sampler, starting it and the PC histories cold" << endl;
+    }
+
+    if (sdbp != NULL)
+    {
+        const BITVECTOR *dead = (const BITVECTOR *) sdbp->Load(reader, CKPT_REPL_SDBP, numsets * sizeof(BITVECTOR));
+        if (dead != NULL)
+        {
+            for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
+                DeadWays(setIndex) = dead[setIndex];
+        }
+        else
+            cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no SDBP predictor, starting it cold" << endl;
+
+        if (!sdbp->LoadSampler(reader, CKPT_REPL_SDBP_SAMPLER))
+            cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no SDBP sampler, starting it cold" << endl;
+    }
+
+    // Leader sets and PSEL only carry over between runs of the same policy
+    if (setDuelingType != NULL)
+    {
+        const UINT8 *payload = (const UINT8 *) reader.Find(CKPT_REPL_DUELING, &bytes);
+        CRC_CHECKPOINT_DUELING dueling;
+
+        if (payload != NULL && bytes == sizeof(dueling) + numsets)
+            memcpy(&dueling, payload, sizeof(dueling));
+
+        if (payload != NULL && bytes == sizeof(dueling) + numsets && dueling.replPolicy == replPolicy && dueling.numsets == numsets)
+        {
+            PSEL       = dueling.PSEL;
+            leaderSets = dueling.leaderSets;
+            memcpy(setDuelingType, payload + sizeof(dueling), numsets);
         }
+        else
+            cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no set dueling state for this policy, starting it cold" << endl;
     }
 
+    if (EAF != NULL && !EAF->Load(reader, CKPT_REPL_EAF))
+        cerr << "CACHE_REPLACEMENT_STATE: checkpoint has no matching EAF, starting it cold" << endl;
+
+    // Checkpoints do not hold plugin state
+    if (plugin != NULL)
+        cerr << "CACHE_REPLACEMENT_STATE: starting plugin " << plugin->name << " cold" << endl;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
-// This function is called by the cache on every cache miss. The input        //
-// arguments are the thread id, set index, pointers to ways in current set    //
-// and the associativity.  We are also providing the PC, physical address,    //
-// and accesstype should you wish to use them at victim selection time.       //
-// The return value is the physical way index for the line being replaced.    //
-// Return -1 if you wish to bypass LLC.                                       //
+// This function picks the leader sets for set dueling at random: half of     //
+// them lead for each of the two competing policies, the rest follow PSEL.    //
+// DRRIP duels SRRIP against BRRIP, D-EAF LRU against EAF and SDBP LRU        //
+// against SDBP.                                                              //
 //                                                                            //
-// vicSet is the current set. You can access the contents of the set by       //
-// indexing using the wayID which ranges from 0 to assoc-1 e.g. vicSet[0]     //
-// is the first way and vicSet[4] is the 4th physical way of the cache.       //
-// Elements of LINE_STATE are defined in crc_cache_defs.h                     //
+////////////////////////////////////////////////////////////////////////////////
+void CACHE_REPLACEMENT_STATE::ChooseLeaderSets()
+{
+    if (setDuelingType == NULL)
+        return;
+
+    UINT32 leaderOdd  = (replPolicy == CRC_REPL_DRRIP) ? SDM_LEADER_SRRIP : SDM_LEADER_LRU;
+    UINT32 leaderEven = (replPolicy == CRC_REPL_DRRIP) ? SDM_LEADER_BRRIP : ((replPolicy == CRC_REPL_SDBP) ? SDM_LEADER_SDBP : SDM_LEADER_EAF);
+
+    for (UINT32 setIndex=0; setIndex<numsets; setIndex++)
+        setDuelingType[setIndex] = SDM_FOLLOWER;
+
+    // Create Leader Sets Randomely
+    for (UINT32 iteration=0; iteration<leaderSets; iteration++) {
+        UINT32 setNo;
+        do { setNo = rng.Below(numsets);
+        } while(setDuelingType[setNo] != SDM_FOLLOWER);
+        if (iteration%2)
+            setDuelingType[setNo] = leaderOdd;
+        else
+            setDuelingType[setNo] = leaderEven;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Epoch synchronization for sharded replay. Every shard started the epoch    //
+// with this state's PSEL, SHCT, Hawkeye predictor, perceptron weights, SDBP  //
+// tables and EAF. The changes each shard made are added up as if the shards  //
+// had shared the structures, saturating as the counters would, and the       //
+// result is copied back to every shard. Per-set state is private to the      //
+// shard owning the set and is left alone; so are OPTgen and the samplers,    //
+// which only see the sampled sets a shard owns, and the PC histories.        //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-INT32 CACHE_REPLACEMENT_STATE::GetVictimInSet( UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet, UINT32 assoc,
-                                               Addr_t PC, Addr_t paddr, UINT32 accessType )
+void CACHE_REPLACEMENT_STATE::SynchronizeShared( CACHE_REPLACEMENT_STATE **shards, UINT32 numShards )
 {
-    // If no invalid lines, then replace based on replacement policy
-    if( replPolicy == CRC_REPL_LRU ) 
+    // PSEL: DRRIP & D-EAF & SDBP
+    if (setDuelingType != NULL)
     {
-        return Get_LRU_Victim( setIndex );
+        INT32 pselMax = (replPolicy == CRC_REPL_EAF) ? PSEL_MAX_EAF : ((replPolicy == CRC_REPL_SDBP) ? PSEL_MAX_SDBP : PSEL_MAX);
+        INT32 psel    = PSEL;
+
+        for (UINT32 s=0; s<numShards; s++)
+            psel += (INT32) shards[s]->PSEL - (INT32) PSEL;
+
+        PSEL = (psel < 0) ? 0 : ((psel > pselMax) ? pselMax : psel);
+
+        for (UINT32 s=0; s<numShards; s++)
+            shards[s]->PSEL = PSEL;
     }
-    else if( replPolicy == CRC_REPL_RANDOM )
+
+    // SHiP-PC
+    if (SHCT != NULL)
     {
-        return Get_Random_Victim( setIndex );
+        for (UINT32 entry=0; entry<shctEntries; entry++)
+        {
+            INT32 counter = SHCT[entry];
+
+            for (UINT32 s=0; s<numShards; s++)
+                counter += (INT32) shards[s]->SHCT[entry] - (INT32) SHCT[entry];
+
+            SHCT[entry] = (counter < 0) ? 0 : ((counter > SHCTCtrMax) ? SHCTCtrMax : counter);
+
+            for (UINT32 s=0; s<numShards; s++)
+                shards[s]->SHCT[entry] = SHCT[entry];
+        }
     }
-    else if ( replPolicy == CRC_REPL_DRRIP ) 
+
+    // Hawkeye
+    if (predictor != NULL)
     {
-    	// Victim Selection is Same Acorss all Dueling Policies
-    	return Get_RRIP_Victim(setIndex);
+        for (UINT32 entry=0; entry<shctEntries; entry++)
+        {
+            INT32 counter = predictor[entry];
+
+            for (UINT32 s=0; s<numShards; s++)
+                counter += (INT32) shards[s]->predictor[entry] - (INT32) predictor[entry];
+
+            predictor[entry] = (counter < 0) ? 0 : ((counter > HAWKEYE_CTR_MAX) ? HAWKEYE_CTR_MAX : counter);
+
+            for (UINT32 s=0; s<numShards; s++)
+                shards[s]->predictor[entry] = predictor[entry];
+        }
     }
-    else if ( replPolicy == CRC_REPL_SHIP ) 
+
+    // Perceptron
+    if (perceptron != NULL)
     {
-        // This is the same as SRRIP or above function
-        return Get_SHiP_Victim(setIndex);	
+        CRC_PERCEPTRON **copies = new CRC_PERCEPTRON* [numShards];
+
+        for (UINT32 s=0; s<numShards; s++)
+            copies[s] = shards[s]->perceptron;
+
+        perceptron->Synchronize(copies, numShards);
+
+        delete [] copies;
     }
-    else if ( replPolicy == CRC_REPL_EAF ) 
-    {
-        // Victim Selection is the same as LRU, but we need to update EAF
-        return Get_EAF_Victim( setIndex, paddr );   
-    } 
-    else if( replPolicy == CRC_REPL_EAF_RRIP )
+
+    // SDBP
+    if (sdbp != NULL)
     {
-        // Victim Selection is the same as RRIP, but we need to update EAF
-        return Get_EAF_RRIP_Victim( setIndex, paddr ); 
+        CRC_SDBP **copies = new CRC_SDBP* [numShards];
+
+        for (UINT32 s=0; s<numShards; s++)
+            copies[s] = shards[s]->sdbp;
+
+        sdbp->Synchronize(copies, numShards);
+
+        delete [] copies;
     }
 
-    // We should never get here
-    assert(0);
+    // D-EAF & EAF_RRIP
+    if (EAF != NULL)
+    {
+        BLOOM_FILTER **filters = new BLOOM_FILTER* [numShards];
+
+        for (UINT32 s=0; s<numShards; s++)
+            filters[s] = shards[s]->EAF;
+
+        EAF->Synchronize(filters, numShards);
 
-    return -1; // Returning -1 bypasses the LLC
+        delete [] filters;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This function is called by the cache on every cache miss. The input        //
+// arguments are the thread id, set index, pointers to ways in current set    //
+// and the associativity.  We are also providing the PC, physical address,    //
+// and accesstype should you wish to use them at victim selection time.       //
+// The return value is the physical way index for the line being replaced.    //
+// Return -1 if you wish to bypass LLC.                                       //
+//                                                                            //
+// vicSet is the current set. You can access the contents of the set by       //
+// indexing using the wayID which ranges from 0 to assoc-1 e.g. vicSet[0]     //
+// is the first way and vicSet[4] is the 4th physical way of the cache.       //
+// Elements of LINE_STATE are defined in crc_cache_defs.h                     //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+INT32 CACHE_REPLACEMENT_STATE::GetVictimInSet( UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet, UINT32 assoc,
+                                               Addr_t PC, Addr_t paddr, UINT32 accessType )
+{
+    return GetVictimInSetT<CRC_REPL_DYNAMIC>( tid, setIndex, vicSet, assoc, PC, paddr, accessType );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -208,52 +648,120 @@ INT32 CACHE_REPLACEMENT_STATE::GetVictimInSet( UINT32 tid, UINT32 setIndex, cons
 // of the request, the PC of the request, the accesstype, and finall          //
 // whether the line was a cachehit or not (cacheHit=true implies hit)         //
 //                                                                            //
+// The address is not part of this interface; policies that want it get the   //
+// line address rebuilt from the tag and the set index.                       //
+//                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 void CACHE_REPLACEMENT_STATE::UpdateReplacementState( 
     UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine, 
     UINT32 tid, Addr_t PC, UINT32 accessType, bool cacheHit )
 {
-    // What replacement policy?
-    if( replPolicy == CRC_REPL_LRU ) 
-    {
-        UpdateLRU( setIndex, updateWayID );
-    }
-    else if( replPolicy == CRC_REPL_RANDOM )
-    {
-        // Random replacement requires no replacement state update
-    }
-    else if ( replPolicy == CRC_REPL_DRRIP ) 
-    {
-		//Monitoring Set Dueling
-		SetDuelingMonitorDRRIP(setIndex, cacheHit);
-		//Update RRIP (both SRRIP and BRRIP)
-		UpdateRRIP( setIndex, updateWayID, cacheHit );
-    }
-    else if ( replPolicy == CRC_REPL_SHIP ) 
-    {
-    	UpdateSHiP( setIndex, updateWayID, PC, cacheHit );
-    }
-    else if ( replPolicy == CRC_REPL_EAF ) 
+    Addr_t paddr = LineKey( setIndex, currLine->tag ) << lineShift;
+
+    UpdateReplacementStateT<CRC_REPL_DYNAMIC>( setIndex, updateWayID, currLine, tid, PC, paddr, accessType, cacheHit );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//////// HELPER FUNCTIONS FOR REPLACEMENT UPDATE AND VICTIM SELECTION //////////
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Hawkeye victim selection: a cache-averse line (RRPV 7) if the set has      //
+// one, else the friendly line that has gone longest without a hit. Evicting  //
+// a friendly line means the predictor was wrong about its signature, so      //
+// the signature is detrained.                                                //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+INT32 CACHE_REPLACEMENT_STATE::Get_Hawkeye_Victim( UINT32 setIndex )
+{
+    INT32 victim = CRC_MaxByteIndex( &RRVP( setIndex, 0 ), rrpvStride );
+
+    if (RRVP( setIndex, victim ) != HAWKEYE_RRPV_MAX)
     {
-        //Monitoring Set Dueling
-        SetDuelingMonitorEAF(setIndex, cacheHit);
-        //Update both LRU and EAF
-        UpdateEAF ( setIndex, updateWayID, cacheHit );
+        TrainHawkeye(SHiPEntry( setIndex, victim ) & shctMask, false);
+        friendlyEvictions++;
     }
-    else if( replPolicy == CRC_REPL_EAF_RRIP )
+
+    return victim;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Perceptron victim selection. A fill predicted dead with enough confidence  //
+// (yout at or above PERCEPTRON_BYPASS) is bypassed. No update follows a      //
+// bypass, so the access trains the sampler and enters the PC history here.   //
+// Otherwise the victim is RRIP's, and the prediction is kept for the fill.   //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+INT32 CACHE_REPLACEMENT_STATE::Get_Perceptron_Victim( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t paddr, UINT32 accessType )
+{
+    Addr_t line = paddr >> lineShift;
+
+    perceptronYout = perceptron->Predict(tid, PC, line, accessType, perceptronIndex);
+
+    if (perceptronYout >= PERCEPTRON_BYPASS)
     {
-        UpdateEAF_RRIP ( setIndex, updateWayID, cacheHit );
+        perceptron->Train(setIndex, line, perceptronIndex, perceptronYout);
+        perceptron->Record(tid, PC);
+        bypassedFills++;
+        return -1;
     }
-    
-    
+
+    perceptronPending = true;
+
+    return Get_RRIP_Victim(setIndex);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
-//////// HELPER FUNCTIONS FOR REPLACEMENT UPDATE AND VICTIM SELECTION //////////
+// SDBP victim selection. A fill whose PC predicts it dead on arrival is      //
+// bypassed; as no update follows, the access trains the sampler here.        //
+// Otherwise the victim is the lowest way predicted dead, or the LRU way      //
+// if the set has none.                                                       //
+//                                                                            //
+// The predictions go wrong on some streams (strided sweeps whose lines       //
+// come back after the sampler has let them go), and acting on them then      //
+// misses more than LRU. The policy therefore duels with LRU: the LRU         //
+// leaders, and the followers while PSEL says LRU misses less, take the LRU   //
+// line.                                                                      //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
+INT32 CACHE_REPLACEMENT_STATE::Get_SDBP_Victim( UINT32 setIndex, Addr_t PC, Addr_t paddr )
+{
+    UINT32 signature = CRC_SDBP::Signature(PC);
+
+    SetDuelingMonitorSDBP(setIndex);
+
+    //PSEL high shows high misses in LRU so followers use SDBP
+    if (setDuelingType[setIndex] == SDM_LEADER_LRU ||
+        (setDuelingType[setIndex] == SDM_FOLLOWER && PSEL <= PSEL_MAX_SDBP/2))
+    {
+        lruVictims++;
+        return Get_LRU_Victim(setIndex);
+    }
+
+    if (sdbp->Dead(signature))
+    {
+        sdbp->Train(setIndex, paddr >> lineShift, signature);
+        bypassedFills++;
+        return -1;
+    }
+
+    BITVECTOR dead = DeadWays( setIndex );
+
+    if (dead != 0)
+    {
+        deadVictims++;
+        return CRC_Ctz(dead);
+    }
 
+    lruVictims++;
+    return Get_LRU_Victim(setIndex);
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
@@ -264,23 +772,8 @@ void CACHE_REPLACEMENT_STATE::UpdateReplacementState(
 ////////////////////////////////////////////////////////////////////////////////
 INT32 CACHE_REPLACEMENT_STATE::Get_LRU_Victim( UINT32 setIndex )
 {
-    // Get pointer to replacement state of current set
-    LINE_REPLACEMENT_STATE *replSet = repl[ setIndex ];
-
-    INT32   lruWay   = 0;
-
-    // Search for victim whose stack position is assoc-1
-    for(UINT32 way=0; way<assoc; way++) 
-    {
-        if( replSet[way].LRUstackposition == (assoc-1) ) 
-        {
-            lruWay = way;
-            break;
-        }
-    }
-
-    // return lru way
-    return lruWay;
+    // Bottom of the LRU stack
+    return lru.Victim( setIndex );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -290,7 +783,7 @@ INT32 CACHE_REPLACEMENT_STATE::Get_LRU_Victim( UINT32 setIndex )
 ////////////////////////////////////////////////////////////////////////////////
 INT32 CACHE_REPLACEMENT_STATE::Get_Random_Victim( UINT32 setIndex )
 {
-    INT32 way = (rand() % assoc);
+    INT32 way = rng.Below(assoc);
     
     return way;
 }
@@ -368,40 +861,35 @@ void CACHE_REPLACEMENT_STATE::SetDuelingMonitorEAF( UINT32 setIndex, bool cacheH
 
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
-// This function finds a the victim in RRIP policies. It searches for the 	  //
-// RRVP value of RRIP_MAX, if it was find that is the victim. If not it 	  //
-// increases all RRVP by one and try again									  //
-//																		      //                                                                           
+// SDBP set dueling: PSEL counts the misses of the LRU leaders up and those   //
+// of the SDBP leaders down. It is called at victim selection, as bypassed    //
+// misses have no update.                                                     //
+//                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-INT32 CACHE_REPLACEMENT_STATE::Get_RRIP_Victim( UINT32 setIndex )
+void CACHE_REPLACEMENT_STATE::SetDuelingMonitorSDBP( UINT32 setIndex )
 {
-    // Get pointer to replacement state of current set
-    LINE_REPLACEMENT_STATE *replSet = repl[ setIndex ];
+    if (setDuelingType[setIndex] == SDM_LEADER_LRU && PSEL < PSEL_MAX_SDBP)
+        PSEL++;
+    else if (setDuelingType[setIndex] == SDM_LEADER_SDBP && PSEL > 0)
+        PSEL--;
+}
 
-    INT32 rripway = 0;
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This function finds a the victim in RRIP policies. It searches for the     //
+// RRVP value of RRIP_MAX, if it was find that is the victim. If not it       //
+// increases all RRVP by one and try again. CRC_RripVictim does the           //
+// increments that the retries would do in one step.                          //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+INT32 CACHE_REPLACEMENT_STATE::Get_RRIP_Victim( UINT32 setIndex )
+{
+    return Get_RRIP_Victim( setIndex, RRIP_MAX );
+}
 
-    // Search for the Victim
-    for(UINT32 way=0; way<assoc;)
-    {	
-    	// Find if there is a Line with RRIP_MAX
-    	if( replSet[way].RRVP == RRIP_MAX ) 
-    	{
-    		rripway = way;
-    		break;
-    	}
-
-    	way++;
-    	// If reaches here, Means There is no RRIP_MAX
-    	// So Increase all by One and Retry
-    	if (way == assoc) 
-    	{
-    		for(UINT32 way_second=0; way_second<assoc; way_second++)
-    			replSet[way_second].RRVP++;
- 			way=0;
-    	}
-    }
-    
-    return rripway;
+INT32 CACHE_REPLACEMENT_STATE::Get_RRIP_Victim( UINT32 setIndex, UINT8 rrpvMax )
+{
+    return CRC_RripVictim( &RRVP( setIndex, 0 ), rrpvWays, rrpvStride, rrpvMax );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -417,42 +905,16 @@ INT32 CACHE_REPLACEMENT_STATE::Get_RRIP_Victim( UINT32 setIndex )
 ////////////////////////////////////////////////////////////////////////////////
 INT32 CACHE_REPLACEMENT_STATE::Get_SHiP_Victim( UINT32 setIndex )
 {
-    // Get pointer to replacement state of current set
-    LINE_REPLACEMENT_STATE *replSet = repl[ setIndex ];
-
-    INT32 rripway = 0;
-
     // Search for the Victim
-    for(UINT32 way=0; way<assoc;)
-    {   
-        // Find if there is a Line with RRIP_MAX
-        if( replSet[way].RRVP == RRIP_MAX_SHiP ) 
-        {
-            rripway = way;
-            break;
-        }
-
-        way++;
-        // If reaches here, Means There is no RRIP_MAX
-        // So Increase all by One and Retry
-        if (way == assoc) 
-        {
-            for(UINT32 way_second=0; way_second<assoc; way_second++)
-                replSet[way_second].RRVP++;
-            way=0;
-        }
-    }
+    INT32 rripway = Get_RRIP_Victim( setIndex, RRIP_MAX_SHiP );
 
     // Now update the SHCT based on Victim outcome
-    if (repl[ setIndex][ rripway ].outcome == false)
+    UINT16 entry = SHiPEntry( setIndex, rripway );
+    if ((entry & SHiP_OUTCOME) == 0)
     {
-        if (SHCT.find(repl[setIndex][rripway].signature) != SHCT.end())
-        {
-            if (SHCT[repl[setIndex][rripway].signature] != 0)
-                SHCT[repl[setIndex][rripway].signature]--;
-        }
-        else
-            cout << "\tTHERE WAS AND ERROR IN SHiP VICTIM SELECTION" << endl;
+        UINT8 &counter = SHCT[entry & shctMask];
+        if (counter != 0)
+            counter--;
     }
     
     return rripway;
@@ -463,40 +925,16 @@ INT32 CACHE_REPLACEMENT_STATE::Get_SHiP_Victim( UINT32 setIndex )
 // This function finds the LRU victim in the cache set by returning the       //
 // cache block at the bottom of the LRU stack. Top of LRU stack is '0'        //
 // while bottom of LRU stack is 'assoc-1'                                     //
-// For simplicity when we insert a new line, we save its physical address,    //
-// then when we are evicting it, we will insert this in EAF.                  //
+// The address of the evicted line, rebuilt from its tag, goes in the EAF.    //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-INT32 CACHE_REPLACEMENT_STATE::Get_EAF_Victim( UINT32 setIndex, Addr_t PhysicalAddr )
+INT32 CACHE_REPLACEMENT_STATE::Get_EAF_Victim( UINT32 setIndex, const LINE_STATE *vicSet )
 {
-    // Get pointer to replacement state of current set
-    LINE_REPLACEMENT_STATE *replSet = repl[ setIndex ];
-
-    INT32   lruWay   = 0;
-
-    // Search for victim whose stack position is assoc-1
-    for(UINT32 way=0; way<assoc; way++) 
-    {
-        if( replSet[way].LRUstackposition == (assoc-1) ) 
-        {
-            lruWay = way;
-            break;
-        }
-    }
+    // Bottom of the LRU stack
+    INT32   lruWay   = lru.Victim( setIndex );
 
-    //Insert the evicted line paddr in EAF
-    Addr_t paddr_evicted = replSet[lruWay].paddr;
-    EAF[paddr_evicted] = counter_EAF;
-    counter_EAF++;
-
-    if (counter_EAF == BLOOM_MAX_COUNTER)
-    {
-        EAF.clear();
-        counter_EAF = 0;
-    }
-
-    //Assign the physical address to the line
-    replSet[lruWay].paddr = PhysicalAddr;
+    //Insert the evicted line address in EAF (cleared when full)
+    EAF->Insert(LineKey(setIndex, vicSet[lruWay].tag));
 
     return lruWay;
 }
@@ -507,47 +945,13 @@ INT32 CACHE_REPLACEMENT_STATE::Get_EAF_Victim( UINT32 setIndex, Addr_t PhysicalA
 // Also updating the EAF-Bloom-Filter is done in this function.               //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-INT32 CACHE_REPLACEMENT_STATE::Get_EAF_RRIP_Victim( UINT32 setIndex, Addr_t PhysicalAddr )
+INT32 CACHE_REPLACEMENT_STATE::Get_EAF_RRIP_Victim( UINT32 setIndex, const LINE_STATE *vicSet )
 {
-    // Get pointer to replacement state of current set
-    LINE_REPLACEMENT_STATE *replSet = repl[ setIndex ];
-
-    INT32 rripway = 0;
-
     // Search for the Victim
-    for(UINT32 way=0; way<assoc;)
-    {   
-        // Find if there is a Line with RRIP_MAX
-        if( replSet[way].RRVP == RRIP_MAX ) 
-        {
-            rripway = way;
-            break;
-        }
-
-        way++;
-        // If reaches here, Means There is no RRIP_MAX
-        // So Increase all by One and Retry
-        if (way == assoc) 
-        {
-            for(UINT32 way_second=0; way_second<assoc; way_second++)
-                replSet[way_second].RRVP++;
-            way=0;
-        }
-    }
+    INT32 rripway = Get_RRIP_Victim( setIndex, RRIP_MAX );
 
-    //Insert the evicted line paddr in EAF
-    Addr_t paddr_evicted = replSet[rripway].paddr;
-    EAF[paddr_evicted] = counter_EAF;
-    counter_EAF++;
-
-    if (counter_EAF == BLOOM_MAX_COUNTER)
-    {
-        EAF.clear();
-        counter_EAF = 0;
-    }
-
-    //Assign the physical address to the line
-    replSet[rripway].paddr = PhysicalAddr;
+    //Insert the evicted line address in EAF (cleared when full)
+    EAF->Insert(LineKey(setIndex, vicSet[rripway].tag));
 
     return rripway;
 }
@@ -561,27 +965,14 @@ INT32 CACHE_REPLACEMENT_STATE::Get_EAF_RRIP_Victim( UINT32 setIndex, Addr_t Phys
 ////////////////////////////////////////////////////////////////////////////////
 void CACHE_REPLACEMENT_STATE::UpdateLRU( UINT32 setIndex, INT32 updateWayID )
 {
-    // Determine current LRU stack position
-    UINT32 currLRUstackposition = repl[ setIndex ][ updateWayID ].LRUstackposition;
-
-    // Update the stack position of all lines before the current line
-    // Update implies incremeting their stack positions by one
-    for(UINT32 way=0; way<assoc; way++) 
-    {
-        if( repl[setIndex][way].LRUstackposition < currLRUstackposition ) 
-        {
-            repl[setIndex][way].LRUstackposition++;
-        }
-    }
-
-    // Set the LRU stack position of new line to be zero
-    repl[ setIndex ][ updateWayID ].LRUstackposition = 0;
+    // Move the line to the top of the LRU stack
+    lru.Touch( setIndex, updateWayID, mytimer );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
 // This function implements the RRIP update routine with Hit Priority (HP).	  //
-// Also BRRIP with BIOMODAL_PROBABILITY constant.   						  //
+// Also BRRIP with the bimodal chance (BIOMODAL_PROBABILITY by default).      //
 // On a hit RRPV will be 0. On a miss it will based on Viction selection we   //
 // kick-out the line and insert the new line with RRIP_MAX or with Biomodal   //
 // probability with RRIP_MAX-1. We update all type of set in this function.	  //
@@ -592,7 +983,7 @@ void CACHE_REPLACEMENT_STATE::UpdateRRIP( UINT32 setIndex, INT32 updateWayID, bo
 	//On Hit all Dueling Policies to the same
 	if (cacheHit)
 	{
-		repl[ setIndex ][ updateWayID ].RRVP = 0;
+		RRVP( setIndex, updateWayID ) = 0;
 		return;
 	}  
 
@@ -602,17 +993,17 @@ void CACHE_REPLACEMENT_STATE::UpdateRRIP( UINT32 setIndex, INT32 updateWayID, bo
 	//1.Leader Set
 	if (setDuelingType[setIndex] == SDM_LEADER_SRRIP)
 	{
-		repl[ setIndex ][ updateWayID ].RRVP = RRIP_MAX-1;
+		RRVP( setIndex, updateWayID ) = RRIP_MAX-1;
 		return;	
 	}
 
 	//2.Leader Set
 	if (setDuelingType[setIndex] == SDM_LEADER_BRRIP)
 	{
-		if (rand()%1000 < BIOMODAL_PROBABILITY)
-			repl[ setIndex ][ updateWayID ].RRVP = RRIP_MAX-1;
+		if (rng.Chance(bimodal))
+			RRVP( setIndex, updateWayID ) = RRIP_MAX-1;
 		else
-			repl[ setIndex ][ updateWayID ].RRVP = RRIP_MAX;
+			RRVP( setIndex, updateWayID ) = RRIP_MAX;
 		return;
 	}
 
@@ -623,16 +1014,16 @@ void CACHE_REPLACEMENT_STATE::UpdateRRIP( UINT32 setIndex, INT32 updateWayID, bo
 		//BRRIP
 		if (PSEL > PSEL_MAX/2)
 		{
-			if (rand()%1000 < BIOMODAL_PROBABILITY)
-				repl[ setIndex ][ updateWayID ].RRVP = RRIP_MAX-1;
+			if (rng.Chance(bimodal))
+				RRVP( setIndex, updateWayID ) = RRIP_MAX-1;
 			else
-				repl[ setIndex ][ updateWayID ].RRVP = RRIP_MAX;
+				RRVP( setIndex, updateWayID ) = RRIP_MAX;
 			return;
 		}
 		//SRRIP
 		else
 		{
-			repl[ setIndex ][ updateWayID ].RRVP = RRIP_MAX-1;
+			RRVP( setIndex, updateWayID ) = RRIP_MAX-1;
 			return;	
 		}
 
@@ -643,34 +1034,41 @@ void CACHE_REPLACEMENT_STATE::UpdateRRIP( UINT32 setIndex, INT32 updateWayID, bo
 //                                                                            //
 //  This function implement SHiP-PC update routine which is based on SRRIP    //
 //  and signature tracking. Hit Priority (HP) is impelemented. So, on every   //
-//  hit RRVP is updated to 0. On a miss after eviction we will update to      //
-//  outcome bit of the line and based on the signature counter insert it with //
-//  different RRVP.                                                           //
+//  hit RRVP is updated to 0; the first hit of a line sets its outcome bit    //
+//  and increments its signature's counter. On a miss after eviction we       //
+//  clear the outcome bit of the line and based on the signature counter      //
+//  insert it with different RRVP.                                            //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 void CACHE_REPLACEMENT_STATE::UpdateSHiP( UINT32 setIndex, INT32 updateWayID, Addr_t PC, bool cacheHit ) {
-    //On Hit update RRVP to 0 and increment SHCT
+    //On Hit update RRVP to 0, and on the line's first hit set its outcome
+    //bit and increment SHCT
     if (cacheHit)
     {
         //RRVP update
-        repl[ setIndex ][ updateWayID ].RRVP = 0;
+        RRVP( setIndex, updateWayID ) = 0;
 
-        //SHCT coutner update
-        if (SHCT[repl[ setIndex ][ updateWayID ].signature] == SHCTCtrMax)
+        UINT16 &entry = SHiPEntry( setIndex, updateWayID );
+        if (entry & SHiP_OUTCOME)
             return;
-        else
-            SHCT[repl[ setIndex ][ updateWayID ].signature]++;
+        entry |= SHiP_OUTCOME;
+
+        //SHCT coutner update
+        UINT8 &counter = SHCT[entry & shctMask];
+        if (counter != SHCTCtrMax)
+            counter++;
 
         return;
     } 
 
     // If miss
-    repl[ setIndex ][ updateWayID ].outcome = false;
-    repl[ setIndex ][ updateWayID ].signature = SHiP_HASH_FUNC (PC);
-    if (SHCT[repl[setIndex][updateWayID].signature] == 0)
-        repl[ setIndex ][ updateWayID ].RRVP = RRIP_MAX;
+    // outcome bit cleared, new signature
+    UINT32 signature = SHiP_HASH_FUNC (PC);
+    SHiPEntry( setIndex, updateWayID ) = signature;
+    if (SHCT[signature] == 0)
+        RRVP( setIndex, updateWayID ) = RRIP_MAX;
     else
-        repl[ setIndex ][ updateWayID ].RRVP = RRIP_MAX-1;
+        RRVP( setIndex, updateWayID ) = RRIP_MAX-1;
 
 }
 
@@ -678,32 +1076,18 @@ void CACHE_REPLACEMENT_STATE::UpdateSHiP( UINT32 setIndex, INT32 updateWayID, Ad
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
 // This function implements EAF update procedure. If there was a miss, we     //
-// will look at the new paddr, and based on EAF table insert the line. However//
-// EAF table lookup will be based on bloom filters. Bloom filters has a false //
-// positive probability which we will implement.                              //
+// will look at the new line address, and based on EAF table insert the       //
+// line. EAF table lookup is a Bloom filter test, so false positives come     //
+// from the filter itself.                                                    //
 // If there was a hit, will be like LRU.                                      //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-void CACHE_REPLACEMENT_STATE::UpdateEAF( UINT32 setIndex, INT32 updateWayID, bool cacheHit )
+void CACHE_REPLACEMENT_STATE::UpdateEAF( UINT32 setIndex, INT32 updateWayID, Addr_t lineKey, bool cacheHit )
 {
-    // Determine current LRU stack position
-    UINT32 currLRUstackposition = repl[ setIndex ][ updateWayID ].LRUstackposition;
-
     // On Hit all Dueling policies are same
     if (cacheHit)
     {
-        // Update the stack position of all lines before the current line
-        // Update implies incremeting their stack positions by one
-        for(UINT32 way=0; way<assoc; way++) 
-        {
-            if( repl[setIndex][way].LRUstackposition < currLRUstackposition ) 
-            {
-                repl[setIndex][way].LRUstackposition++;
-            }
-        }
-
-        // Set the LRU stack position of new line to be zero
-        repl[ setIndex ][ updateWayID ].LRUstackposition = 0;
+        UpdateLRU( setIndex, updateWayID );
         return;
     }
 
@@ -711,146 +1095,240 @@ void CACHE_REPLACEMENT_STATE::UpdateEAF( UINT32 setIndex, INT32 updateWayID, boo
     // We need to decide based on dueling
     // 1.EAF
     if (setDuelingType[setIndex] == SDM_LEADER_EAF)
-    {    
-        Addr_t paddr_new = repl[ setIndex ][ updateWayID ].paddr;
-        // check for paddr in EAF
-        if (EAF.find(paddr_new)!=EAF.end())
-        {
-            // if there is a hit insert as MRU with porbability bloom filter
-            if (rand()%1000 > BLOOM_FALSE_POS_PROB) 
-            {
-                for(UINT32 way=0; way<assoc; way++) 
-                    if( repl[setIndex][way].LRUstackposition < currLRUstackposition ) 
-                        repl[setIndex][way].LRUstackposition++;
-
-                repl[ setIndex ][ updateWayID ].LRUstackposition = 0;
-
-                return;
-            }
-        }
-        // Both cases:
-        // else improt as biomodal policy as MRU
-        if (rand()%1000 < BIOMODAL_PROBABILITY_EAF)
-        {
-            for(UINT32 way=0; way<assoc; way++) 
-                if( repl[setIndex][way].LRUstackposition < currLRUstackposition ) 
-                    repl[setIndex][way].LRUstackposition++;
-
-            repl[ setIndex ][ updateWayID ].LRUstackposition = 0;
-        } 
-        // else as LRU - Nothing to do
-    }
+        InsertEAF( setIndex, updateWayID, lineKey );
     // 2.LRU
     if (setDuelingType[setIndex] == SDM_LEADER_LRU)
-    {
-        for(UINT32 way=0; way<assoc; way++) 
-                if( repl[setIndex][way].LRUstackposition < currLRUstackposition ) 
-                    repl[setIndex][way].LRUstackposition++;
-
-            repl[ setIndex ][ updateWayID ].LRUstackposition = 0;   
-    }
+        UpdateLRU( setIndex, updateWayID );
     // 2.Follower
+    // As in the kit, this matches the LRU leaders. Their line is already
+    // MRU, so the second update leaves the order as it is.
     if (setDuelingType[setIndex] == SDM_LEADER_LRU)
     {
         //PSEL high shows high misses in LRU so we choose
         //EAF
         if (PSEL > PSEL_MAX_EAF/2)
-        {
-            Addr_t paddr_new = repl[ setIndex ][ updateWayID ].paddr;
-            // check for paddr in EAF
-            if (EAF.find(paddr_new)!=EAF.end())
-            {
-                // if there is a hit insert as MRU with porbability bloom filter
-                if (rand()%1000 > BLOOM_FALSE_POS_PROB) 
-                {
-                    for(UINT32 way=0; way<assoc; way++) 
-                        if( repl[setIndex][way].LRUstackposition < currLRUstackposition ) 
-                            repl[setIndex][way].LRUstackposition++;
-
-                    repl[ setIndex ][ updateWayID ].LRUstackposition = 0;
-
-                    return;
-                }
-        }
-        // Both cases:
-        // else improt as biomodal policy as MRU
-        if (rand()%1000 < BIOMODAL_PROBABILITY_EAF)
-        {
-            for(UINT32 way=0; way<assoc; way++) 
-                if( repl[setIndex][way].LRUstackposition < currLRUstackposition ) 
-                    repl[setIndex][way].LRUstackposition++;
-
-            repl[ setIndex ][ updateWayID ].LRUstackposition = 0;
-        } 
-        // else as LRU - Nothing to do
-        }
+            InsertEAF( setIndex, updateWayID, lineKey );
         //LRU
         else
-        {
-            for(UINT32 way=0; way<assoc; way++) 
-                if( repl[setIndex][way].LRUstackposition < currLRUstackposition ) 
-                    repl[setIndex][way].LRUstackposition++;
-
-            repl[ setIndex ][ updateWayID ].LRUstackposition = 0; 
-        }
+            UpdateLRU( setIndex, updateWayID );
+    }
+}
 
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// EAF insertion of a missing line: if its address is in the EAF (true or     //
+// false positive) it is inserted as MRU, otherwise it is inserted as MRU     //
+// with the bimodal probability and left at the LRU position the rest of      //
+// the time.                                                                  //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CACHE_REPLACEMENT_STATE::InsertEAF( UINT32 setIndex, INT32 updateWayID, Addr_t lineKey )
+{
+    // check for the line address in EAF
+    if (EAF->Test(lineKey))
+    {
+        UpdateLRU( setIndex, updateWayID );
+        return;
     }
+    // else improt as biomodal policy as MRU
+    if (rng.Chance(bimodal))
+        UpdateLRU( setIndex, updateWayID );
+    // else as LRU - Nothing to do
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
 // This function implements EAF update procedure. If there was a miss, we     //
-// will look at the new paddr, and based on EAF table insert the line. However//
-// EAF table lookup will be based on bloom filters. Bloom filters has a false //
-// positive probability which we will implement.                              //
+// will look at the new line address, and based on EAF table insert the       //
+// line. EAF table lookup is a Bloom filter test, so false positives come     //
+// from the filter itself.                                                    //
 // If there was a hit, will be like LRU.                                      //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-void CACHE_REPLACEMENT_STATE::UpdateEAF_RRIP( UINT32 setIndex, INT32 updateWayID, bool cacheHit )
+void CACHE_REPLACEMENT_STATE::UpdateEAF_RRIP( UINT32 setIndex, INT32 updateWayID, Addr_t lineKey, bool cacheHit )
 {
     //On Hit all Dueling Policies to the same
     if (cacheHit)
     {
-        repl[ setIndex ][ updateWayID ].RRVP = 0;
+        RRVP( setIndex, updateWayID ) = 0;
         return;
     } 
 
     // Miss
-    Addr_t paddr_new = repl[ setIndex ][ updateWayID ].paddr;
-    // check for paddr in EAF
-    if (EAF.find(paddr_new)!=EAF.end())
+    // check for the line address in EAF
+    if (EAF->Test(lineKey))
     {
-        // if there is a hit insert as RRIP_MAX-1 with porbability bloom filter
-        if (rand()%1000 > BLOOM_FALSE_POS_PROB) 
-        {
-            if (LIVE_PLUS)
-                repl[ setIndex ][ updateWayID ].RRVP = 0;
-            else
-                repl[ setIndex ][ updateWayID ].RRVP = RRIP_MAX-1;
-            return;
-        }
+        // if there is a hit (true or false positive) insert as RRIP_MAX-1
+        if (LIVE_PLUS)
+            RRVP( setIndex, updateWayID ) = 0;
+        else
+            RRVP( setIndex, updateWayID ) = RRIP_MAX-1;
+        return;
     }
     // Both cases:
     // else improt as biomodal policy as RRIP_MAX-1;
-    if (rand()%1000 < BIOMODAL_PROBABILITY_EAF_RRIP)
+    if (rng.Chance(bimodal))
     {
-        repl[ setIndex ][ updateWayID ].RRVP = RRIP_MAX-1;
+        RRVP( setIndex, updateWayID ) = RRIP_MAX-1;
         return;
     } 
     // else as RRIP_MAXs
-    repl[ setIndex ][ updateWayID ].RRVP = RRIP_MAX;
+    RRVP( setIndex, updateWayID ) = RRIP_MAX;
 }
 
 
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
-//  This is the hash fucntion for the SHiP-PC                                 //
-//  Implemented in the simplest way - LSB bits                                //
+// Hawkeye update. On the sampled sets OPTgen first says whether OPT would    //
+// have hit the line's previous access, and that access's signature is        //
+// trained on it. The access is then predicted from its own signature:        //
+// averse lines go in at RRPV 7, first in line for eviction; friendly lines   //
+// at 0, aging the other friendly lines so that they stay ordered by age.     //
+// Writebacks are not demand accesses: they are neither trained on nor        //
+// predicted, and fill averse.                                                //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-UINT32 CACHE_REPLACEMENT_STATE::SHiP_HASH_FUNC (Addr_t PC)
+void CACHE_REPLACEMENT_STATE::TrainHawkeye( UINT32 signature, bool friendly )
 {
-    return int(PC & int(pow(2,NumSigBits+1)-1));
+    UINT8 &counter = predictor[signature];
+
+    if (friendly && counter < HAWKEYE_CTR_MAX)
+        counter++;
+    else if (!friendly && counter != 0)
+        counter--;
+}
+
+void CACHE_REPLACEMENT_STATE::UpdateHawkeye( UINT32 setIndex, INT32 updateWayID, Addr_t tag, Addr_t PC, UINT32 accessType, bool cacheHit )
+{
+    if (accessType == ACCESS_WRITEBACK)
+    {
+        if (!cacheHit)
+            RRVP( setIndex, updateWayID ) = HAWKEYE_RRPV_MAX;
+        return;
+    }
+
+    UINT32 signature = SHiP_HASH_FUNC (PC);
+
+    if (optgenSlot[setIndex] != HAWKEYE_NOT_SAMPLED)
+    {
+        CRC_OPTGEN_RESULT result;
+
+        optgen.Access(optgenSlot[setIndex], tag, signature, &result);
+        if (result.reused)
+            TrainHawkeye(result.reuseSignature, result.optHit);
+        if (result.evicted)
+            TrainHawkeye(result.evictedSignature, false);
+    }
+
+    SHiPEntry( setIndex, updateWayID ) = signature;
+
+    if (predictor[signature] < HAWKEYE_FRIENDLY)
+    {
+        RRVP( setIndex, updateWayID ) = HAWKEYE_RRPV_MAX;
+        if (!cacheHit)
+            averseFills++;
+        return;
+    }
+
+    if (!cacheHit)
+    {
+        UINT8 *rrpv = &RRVP( setIndex, 0 );
+        for (UINT32 way=0; way<assoc; way++)
+        {
+            if (rrpv[way] < HAWKEYE_RRPV_MAX - 1)
+                rrpv[way]++;
+        }
+        friendlyFills++;
+    }
+
+    RRVP( setIndex, updateWayID ) = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Perceptron update, SRRIP with the insertion and promotion predicted.       //
+// Lines predicted dead are inserted at RRIP_MAX and are not promoted on a    //
+// hit; the others are inserted at RRIP_MAX-1 and promoted to 0. Every        //
+// access trains the sampler, if its set is sampled, and is then added to     //
+// the PC history of its thread.                                              //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CACHE_REPLACEMENT_STATE::UpdatePerceptron( UINT32 setIndex, INT32 updateWayID, UINT32 tid, Addr_t PC, Addr_t paddr,
+                                                UINT32 accessType, bool cacheHit )
+{
+    Addr_t line = paddr >> lineShift;
+
+    // A fill into a free way had no victim selection to predict it
+    if (cacheHit || !perceptronPending)
+        perceptronYout = perceptron->Predict(tid, PC, line, accessType, perceptronIndex);
+    perceptronPending = false;
+
+    perceptron->Train(setIndex, line, perceptronIndex, perceptronYout);
+    perceptron->Record(tid, PC);
+
+    bool dead = (perceptronYout >= PERCEPTRON_DEAD);
+
+    if (cacheHit)
+    {
+        if (!dead)
+            RRVP( setIndex, updateWayID ) = 0;
+        return;
+    }
+
+    if (dead)
+    {
+        RRVP( setIndex, updateWayID ) = RRIP_MAX;
+        deadFills++;
+    }
+    else
+    {
+        RRVP( setIndex, updateWayID ) = RRIP_MAX-1;
+        liveFills++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// SDBP update. The access trains the sampler, if its set is sampled, and     //
+// the line is marked dead or live from the PC of this, its last, access.     //
+// The LRU stack is kept as for LRU.                                          //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CACHE_REPLACEMENT_STATE::UpdateSDBP( UINT32 setIndex, INT32 updateWayID, Addr_t PC, Addr_t paddr )
+{
+    UINT32    signature = CRC_SDBP::Signature(PC);
+    BITVECTOR wayBit    = 1ULL << updateWayID;
+    bool      dead      = sdbp->Dead(signature);
+
+    sdbp->Train(setIndex, paddr >> lineShift, signature);
+
+    DeadWays( setIndex ) = dead ? (DeadWays( setIndex ) | wayBit) : (DeadWays( setIndex ) & ~wayBit);
+
+    UpdateLRU( setIndex, updateWayID );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Statistics reset at the end of warm-up and at region boundaries. Only      //
+// the counters PrintStats reports are zeroed; predictors, samplers and       //
+// OPTgen keep what they learned.                                             //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void CACHE_REPLACEMENT_STATE::ResetStats()
+{
+    // Hawkeye
+    friendlyFills = averseFills = friendlyEvictions = 0;
+    optgen.accesses = optgen.optHits = 0;
+
+    // Perceptron
+    if (perceptron != NULL)
+        perceptron->samplerAccesses = perceptron->samplerHits = perceptron->trainedLive = perceptron->trainedDead = 0;
+    deadFills = liveFills = bypassedFills = 0;
+
+    // SDBP
+    if (sdbp != NULL)
+        sdbp->samplerAccesses = sdbp->samplerHits = sdbp->trainedLive = sdbp->trainedDead = 0;
+    deadVictims = lruVictims = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -866,6 +1344,49 @@ ostream & CACHE_REPLACEMENT_STATE::PrintStats(ostream &out)
     out<<"=========================================================="<<endl;
 
     // CONTESTANTS:  Insert your statistics printing here
+    if (predictor != NULL)
+    {
+        out << "Hawkeye OPTgen sampled sets: " << sampledSets << endl;
+        out << "Hawkeye OPTgen accesses: " << optgen.accesses << endl;
+        out << "Hawkeye OPTgen OPT hits: " << optgen.optHits << endl;
+        out << "Hawkeye OPTgen OPT hit rate: "
+            << ((optgen.accesses != 0) ? (double) optgen.optHits / optgen.accesses : 0.0) << endl;
+        out << "Hawkeye friendly fills: " << friendlyFills << endl;
+        out << "Hawkeye averse fills: " << averseFills << endl;
+        out << "Hawkeye friendly evictions: " << friendlyEvictions << endl;
+    }
+
+    if (perceptron != NULL)
+    {
+        out << "Perceptron sampled sets: " << ((numsets < PERCEPTRON_SAMPLED_SETS) ? numsets : PERCEPTRON_SAMPLED_SETS) << endl;
+        out << "Perceptron sampler accesses: " << perceptron->samplerAccesses << endl;
+        out << "Perceptron sampler hits: " << perceptron->samplerHits << endl;
+        out << "Perceptron trained live: " << perceptron->trainedLive << endl;
+        out << "Perceptron trained dead: " << perceptron->trainedDead << endl;
+        out << "Perceptron live fills: " << liveFills << endl;
+        out << "Perceptron dead fills: " << deadFills << endl;
+        out << "Perceptron bypassed fills: " << bypassedFills << endl;
+    }
+
+    if (sdbp != NULL)
+    {
+        COUNTER misses = bypassedFills + deadVictims + lruVictims;
+
+        out << "SDBP sampled sets: " << ((numsets < SDBP_SAMPLED_SETS) ? numsets : SDBP_SAMPLED_SETS) << endl;
+        out << "SDBP sampler accesses: " << sdbp->samplerAccesses << endl;
+        out << "SDBP sampler hits: " << sdbp->samplerHits << endl;
+        out << "SDBP trained live: " << sdbp->trainedLive << endl;
+        out << "SDBP trained dead: " << sdbp->trainedDead << endl;
+        out << "SDBP misses to full sets: " << misses << endl;
+        out << "SDBP dead block victims: " << deadVictims << endl;
+        out << "SDBP LRU victims: " << lruVictims << endl;
+        out << "SDBP bypassed fills: " << bypassedFills << endl;
+        out << "SDBP bypass rate: " << ((misses != 0) ? (double) bypassedFills / misses : 0.0) << endl;
+        out << "SDBP PSEL: " << PSEL << " (followers use " << ((PSEL > PSEL_MAX_SDBP/2) ? "SDBP" : "LRU") << ")" << endl;
+    }
+
+    if (plugin != NULL && plugin->PrintStats != NULL)
+        plugin->PrintStats(pluginState, out);
 
     return out;
     
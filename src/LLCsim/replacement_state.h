@@ -17,11 +17,20 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
 #include <map>
 #include <cmath>
 #include "utils.h"
 #include "crc_cache_defs.h"
+#include "bloom_filter.h"
+#include "crc_simd.h"
+#include "crc_random.h"
+#include "crc_lru.h"
+#include "crc_policy.h"
+#include "crc_optgen.h"
+#include "crc_perceptron.h"
+#include "crc_sdbp.h"
 
 //General Defines
 #define K   1024
@@ -31,27 +40,53 @@
 #define NumLeaderSets   64
 #define RRIP_MAX        3            // Also used in SHiP & EAF_RRIP
 #define PSEL_MAX        15
-#define BIOMODAL_PROBABILITY    31   //[1 means 0.1%/10 means 1%] of all times
+#define BIOMODAL_PROBABILITY    32   //out of 1024 (CRC_RANDOM_CHANCE_BITS): 32 means ~3%
 
 //SHiP Defines
 #define RRIP_MAX_SHiP   3
-#define NumSHCTEnties   16 * K 		//As paper: it uses direct mapping - Also following paper all comparison is done with unlimited SHCT
-#define NumSigBits      14  		//As paper said: 14 bit PC (I used LSB)
+#define NumSigBits      14  		//As paper said: 14 bit PC signature
+#define NumSHCTEnties   (1 << NumSigBits) 	//As paper: it uses direct mapping - one counter per signature
+#define SHCTMask        (NumSHCTEnties - 1)
 #define SHCTCtrMax  	3 			//As paper said: 3-bit saturating counter for default config
 
+// SHiP signature hash, selected with SHiP_HASH
+#define SHiP_HASH_PC_LSB    0       // low NumSigBits bits of the PC
+#define SHiP_HASH_XOR_FOLD  1       // PC folded onto NumSigBits bits with XOR
+#define SHiP_HASH_CRC32     2       // CRC32-C of the PC (SSE4.2 crc32 instruction)
+#ifndef SHiP_HASH
+#define SHiP_HASH           SHiP_HASH_PC_LSB
+#endif
+
 //EAF & EAF-RRIP Defines
-#define BLOOM_FALSE_POS_PROB        21      //Based on paper alpha=8 - [1 means 0.1%/10 means 1%] of all times
+#define BLOOM_BITS_PER_ELEMENT      8       //Based on paper alpha=8
+#define BLOOM_NUM_HASHES            5       //Optimal for alpha=8 (~ln2*8) - gives ~2.2% false positives
 #define BLOOM_MAX_COUNTER           64 * K  //Based on paper is the same as number of blocks in the cache
 
 //EAF Defines
-#define BIOMODAL_PROBABILITY_EAF	15		//Based on paper 1/64 - [1 means 0.1%/10 means 1%] of all times
+#define BIOMODAL_PROBABILITY_EAF	16		//Based on paper 1/64 - out of 1024 (CRC_RANDOM_CHANCE_BITS)
 #define NumLeaderSetsEAF   			64
 #define PSEL_MAX_EAF        		15
 
 //EAF-RRIP
-#define BIOMODAL_PROBABILITY_EAF_RRIP   31  //[1 means 0.1%/10 means 1%] of all times
+#define BIOMODAL_PROBABILITY_EAF_RRIP   32  //out of 1024 (CRC_RANDOM_CHANCE_BITS): 32 means ~3%
 #define LIVE_PLUS 1                         // This insert cache lines on hit at 0 instead of RRIP_MAX-1
 
+//Hawkeye Defines
+#define HAWKEYE_RRPV_MAX        7           // 3-bit RRPVs; averse lines sit at the top
+#define HAWKEYE_SIG_BITS        13          // PC signatures the predictor tells apart
+#define HAWKEYE_CTR_MAX         7           // 3-bit saturating predictor counters
+#define HAWKEYE_FRIENDLY        4           // counter at or above: cache friendly
+#define HAWKEYE_SAMPLED_SETS    64          // sets OPTgen follows
+#define HAWKEYE_NOT_SAMPLED     0xff
+
+//Perceptron Defines (predictor geometry in crc_perceptron.h)
+#define PERCEPTRON_DEAD         16          // yout at or above: insert at RRIP_MAX, do not promote
+#define PERCEPTRON_BYPASS       96          // yout at or above: do not fill
+
+//SDBP Defines (predictor geometry in crc_sdbp.h)
+#define NumLeaderSetsSDBP       64          // half lead for LRU, half for SDBP
+#define PSEL_MAX_SDBP           255         // 8-bit; starts halfway, as neither policy is known better
+
 // Replacement Policies Supported
 typedef enum 
 {
@@ -60,9 +95,16 @@ typedef enum
     CRC_REPL_DRRIP      = 2,
     CRC_REPL_SHIP       = 3,
     CRC_REPL_EAF		= 4,	//D-EAF
-    CRC_REPL_EAF_RRIP   = 5
+    CRC_REPL_EAF_RRIP   = 5,
+    CRC_REPL_HAWKEYE    = 6,
+    CRC_REPL_PERCEPTRON = 7,
+    CRC_REPL_SDBP       = 8,
+    CRC_REPL_PLUGIN     = 32    // loaded from a shared object, see crc_policy.h
 } ReplacemntPolicy;
 
+// Policy template argument meaning "dispatch on replPolicy at run time"
+#define CRC_REPL_DYNAMIC    0xff
+
 // Set Type for Dueling DRRIP
 typedef enum
 {
@@ -70,27 +112,32 @@ typedef enum
     SDM_LEADER_BRRIP    = 1,
     SDM_FOLLOWER        = 2,
     SDM_LEADER_LRU	    = 3,
-    SDM_LEADER_EAF		= 4
+    SDM_LEADER_EAF		= 4,
+    SDM_LEADER_SDBP     = 5
 } TypeSetForDuelingDRRIP;
 
-// Replacement State Per Cache Line
-typedef struct
-{
-    UINT32  LRUstackposition;
-
-    // DRRIP & SHiP-PC & EAF_RRIP
-    UINT32 RRVP;
-
-    // SHiP-PC
-    bool outcome;
-    UINT32 signature;
-
-    // D-EAF & EAF_RRIP
-    Addr_t paddr;
-
-
-} LINE_REPLACEMENT_STATE;
-
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Replacement state per set. Each policy allocates only the fields it        //
+// uses, packed in one block of metaStride bytes per set (64-byte aligned):   //
+//                                                                            //
+//   RRVPs    DRRIP, SHiP-PC, EAF_RRIP,  one byte per way at rrpvOffset       //
+//            Hawkeye, perceptron                                             //
+//   SHiP     SHiP-PC                    one UINT16 per way at shipOffset:    //
+//                                       signature, plus SHiP_OUTCOME         //
+//            Hawkeye                    the signature of the last access     //
+//   dead     SDBP                       one BITVECTOR at deadOffset: the     //
+//                                       ways predicted dead                  //
+//   plugin   a plugin policy            lineStateBytes per way at            //
+//                                       pluginOffset                         //
+//                                                                            //
+// A 16-way SHiP set is 48 bytes, so every set fits in one host cache line.   //
+// LRU order is kept by CRC_LRU, 8 bytes per set up to 16 ways. D-EAF and     //
+// EAF_RRIP key the EAF with the line address rebuilt from the tag, so no     //
+// address is stored per line.                                                //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+#define SHiP_OUTCOME    0x8000      // set in a SHiP entry if the line was reused
 
 // The implementation for the cache replacement policy
 class CACHE_REPLACEMENT_STATE
@@ -99,26 +146,79 @@ class CACHE_REPLACEMENT_STATE
   private:
     UINT32 numsets;
     UINT32 assoc;
-    UINT32 replPolicy;
+    UINT32 replPolicy;  // built-in policy, or CRC_REPL_PLUGIN
+    UINT32 policyId;    // as registered, see crc_policy.h
+    UINT32 setBits;   // bits of the set index in an EAF line key
+    UINT32 lineShift; // log2 of the line size, see SetLineSize
     
-    LINE_REPLACEMENT_STATE   **repl;
+    // Per-set metadata block, see above
+    UINT8   *meta;
+    UINT32  metaStride;
+    UINT32  rrpvOffset;
+    UINT32  shipOffset;
+    UINT32  deadOffset;
+    UINT32  pluginOffset;
 
     COUNTER mytimer;  // tracks # of references to the cache
 
+    // Private generator for bimodal insertion, random victims and leader sets
+    CRC_RANDOM rng;
+
+    // LRU & D-EAF & SDBP
+    CRC_LRU lru;					// recency order of every set, see crc_lru.h
+
+    // DRRIP & SHiP-PC & EAF_RRIP
+    UINT8   *rrpvWays;				// 0xff for the ways of a set, 0 for padding
+    UINT32  rrpvStride;				// assoc rounded up to 16
+
     // DRRIP
-    UINT32  *setDuelingType;		// keep the leader sets and follower based on above enum
+    UINT8   *setDuelingType;		// keep the leader sets and follower based on above enum
+    UINT32  leaderSets;				// leader sets of both policies together
     UINT32  PSEL;					// counter for set dueling
+    UINT32  bimodal;				// BRRIP / BIP insertion chance out of 1024
 
     // SHiP-PC
-    std::map<UINT32, UINT32> SHCT;	// signature history counter table <signature, counter>
+    UINT8 *SHCT;					// signature history counter table, indexed by signature
+    UINT32 sigBits;					// signature bits, NumSigBits unless configured
+    UINT32 shctEntries;				// 2^sigBits
+    UINT32 shctMask;
 
     //EAF & EAF_RRIP
-    std::map<Addr_t,UINT32> EAF;	// Evicted address buffer - we use this to simulate Bloom filter in EAF
-    UINT32 counter_EAF;
+    BLOOM_FILTER *EAF;				// Evicted address filter - cleared every BLOOM_MAX_COUNTER insertions
+
+    // Hawkeye
+    UINT8   *predictor;				// saturating counter per signature: friendly or averse
+    CRC_OPTGEN optgen;				// what OPT did on the sampled sets
+    UINT8   *optgenSlot;			// sampled set number, HAWKEYE_NOT_SAMPLED for the others
+    UINT32  sampledSets;
+    COUNTER friendlyFills;
+    COUNTER averseFills;
+    COUNTER friendlyEvictions;		// friendly lines evicted: detrained
+
+    // Perceptron
+    CRC_PERCEPTRON *perceptron;		// weights, PC histories and training sampler
+    UINT32  perceptronIndex[ PERCEPTRON_FEATURES ];	// features of the last prediction
+    INT32   perceptronYout;			// and its output
+    bool    perceptronPending;		// made at victim selection, for the fill that follows
+    COUNTER deadFills;
+    COUNTER liveFills;
+
+    // SDBP
+    CRC_SDBP *sdbp;					// predictor tables and sampler
+    COUNTER deadVictims;			// victims predicted dead
+    COUNTER lruVictims;				// victims at the bottom of the LRU stack
+
+    // Perceptron & SDBP
+    COUNTER bypassedFills;			// misses not filled: predicted dead on arrival
+
+    // Plugin
+    const CRC_POLICY_OPS *plugin;	// hooks, see crc_policy.h
+    void    *pluginState;			// what the plugin's Create returned
 
   public:
 
     CACHE_REPLACEMENT_STATE( UINT32 _sets, UINT32 _assoc, UINT32 _pol );
+    ~CACHE_REPLACEMENT_STATE();
 
     INT32  GetVictimInSet( UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet, UINT32 assoc, Addr_t PC, Addr_t paddr, UINT32 accessType );
     void   UpdateReplacementState( UINT32 setIndex, INT32 updateWayID );
@@ -126,33 +226,253 @@ class CACHE_REPLACEMENT_STATE
     void   SetReplacementPolicy( UINT32 _pol ) { replPolicy = _pol; } 
     void   IncrementTimer() { mytimer++; } 
 
+    // Line size of the cache, for the policies that key state by line
+    // address (perceptron, SDBP). 64 bytes unless set.
+    void   SetLineSize( UINT32 linesize ) { lineShift = CRC_FloorLog2( linesize ); }
+
+    // Batched lookups prefetch the state an access to the set will touch
+    void   Prefetch( UINT32 setIndex, Addr_t PC )
+    {
+        if (meta != NULL)
+            CRC_Prefetch(SetMeta(setIndex));
+        if (replPolicy == CRC_REPL_LRU || replPolicy == CRC_REPL_EAF || replPolicy == CRC_REPL_SDBP)
+            lru.Prefetch(setIndex);
+        if (setDuelingType != NULL)
+            CRC_Prefetch(&setDuelingType[setIndex]);
+        if (SHCT != NULL)
+            CRC_Prefetch(&SHCT[SHiP_HASH_FUNC(PC)]);
+        if (predictor != NULL)
+            CRC_Prefetch(&predictor[SHiP_HASH_FUNC(PC)]);
+    }
+
+    // Reseeds the generator and redraws the leader sets. Call before the
+    // first access; the default seed comes from CRC_SEED in the environment.
+    void   SeedRandom( UINT64 seed );
+
+    // Sampled simulation: this state stands for a cache 2^shift times as
+    // large, fed one in 2^shift lines. Scales the leader sets and the EAF
+    // capacity to match. Call before the first access.
+    void   ScaleDown( UINT32 shift );
+
+    // Checkpoints (crc_checkpoint.h). LoadState takes whatever the
+    // checkpoint holds of the state this policy uses, even if written
+    // under another policy; the rest starts cold and is reported.
+    void   SaveState( CRC_CHECKPOINT_WRITER &writer );
+    void   LoadState( CRC_CHECKPOINT_READER &reader );
+
+    // Sharded replay: this state holds the shared predictor state (PSEL,
+    // SHCT, EAF, Hawkeye predictor, perceptron weights, SDBP tables) as of
+    // the last epoch; folds in what the shards learned since then and hands
+    // every shard the combined state
+    bool   HasSharedState() { return (setDuelingType != NULL) || (SHCT != NULL) || (EAF != NULL) || (predictor != NULL)
+                                     || (perceptron != NULL) || (sdbp != NULL); }
+    void   SynchronizeShared( CACHE_REPLACEMENT_STATE **shards, UINT32 numShards );
+
     void   UpdateReplacementState( UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine, 
                                    UINT32 tid, Addr_t PC, UINT32 accessType, bool cacheHit );
 
     ostream&   PrintStats( ostream &out);
 
+    // Zeroes the policy's statistics, not its state: CRC_CACHE calls this
+    // where its own counters restart (end of warm-up, region boundaries)
+    void   ResetStats();
+
+    // Policy hooks with the policy fixed at compile time. The cache engine
+    // specialized for a policy calls these so the dispatch chain folds away;
+    // POL == CRC_REPL_DYNAMIC gives the run time dispatch.
+    template <UINT32 POL>
+    INT32  GetVictimInSetT( UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet, UINT32 assoc, Addr_t PC, Addr_t paddr, UINT32 accessType );
+
+    // The cache also passes the address of the access, which the kit's
+    // UpdateReplacementState interface does not have
+    template <UINT32 POL>
+    void   UpdateReplacementStateT( UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine, 
+                                    UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType, bool cacheHit );
+
   private:
     
     void   InitReplacementState();
+    void   ChooseLeaderSets();
 
     INT32  Get_Random_Victim( UINT32 setIndex );
     INT32  Get_LRU_Victim( UINT32 setIndex );
     INT32  Get_RRIP_Victim( UINT32 setIndex );
+    INT32  Get_RRIP_Victim( UINT32 setIndex, UINT8 rrpvMax );
     INT32  Get_SHiP_Victim( UINT32 setIndex );
-    INT32  Get_EAF_Victim( UINT32 setIndex, Addr_t PhysicalAddr );
-    INT32  Get_EAF_RRIP_Victim( UINT32 setIndex, Addr_t PhysicalAddr );
-    UINT32 SHiP_HASH_FUNC (Addr_t PC);
+    INT32  Get_EAF_Victim( UINT32 setIndex, const LINE_STATE *vicSet );
+    INT32  Get_EAF_RRIP_Victim( UINT32 setIndex, const LINE_STATE *vicSet );
+    INT32  Get_Hawkeye_Victim( UINT32 setIndex );
+    INT32  Get_Perceptron_Victim( UINT32 tid, UINT32 setIndex, Addr_t PC, Addr_t paddr, UINT32 accessType );
+    INT32  Get_SDBP_Victim( UINT32 setIndex, Addr_t PC, Addr_t paddr );
+    UINT32 SHiP_HASH_FUNC (Addr_t PC)
+    {
+#if SHiP_HASH == SHiP_HASH_XOR_FOLD
+        Addr_t folded = 0;
+        for (; PC != 0; PC >>= sigBits)
+            folded ^= PC;
+        return (UINT32) (folded & shctMask);
+#elif SHiP_HASH == SHiP_HASH_CRC32
+        return CRC_Crc32(PC) & shctMask;
+#else
+        return (UINT32) (PC & shctMask);
+#endif
+    }
+
+    UINT8  *SetMeta( UINT32 setIndex ) { return &meta[ (size_t) setIndex * metaStride ]; }
+    UINT8  &RRVP( UINT32 setIndex, INT32 way ) { return SetMeta( setIndex )[ rrpvOffset + way ]; }
+    UINT16 &SHiPEntry( UINT32 setIndex, INT32 way ) { return ((UINT16 *) &SetMeta( setIndex )[ shipOffset ])[ way ]; }
+    UINT8  *PluginState( UINT32 setIndex ) { return &SetMeta( setIndex )[ pluginOffset ]; }
+    BITVECTOR &DeadWays( UINT32 setIndex ) { return *(BITVECTOR *) &SetMeta( setIndex )[ deadOffset ]; }
+
+    // Line address used as the EAF key
+    Addr_t LineKey( UINT32 setIndex, Addr_t tag ) { return (tag << setBits) | setIndex; }
 
     void   UpdateLRU( UINT32 setIndex, INT32 updateWayID );
     void   UpdateRRIP( UINT32 setIndex, INT32 updateWayID, bool cacheHit );
     void   UpdateRRIP( UINT32 setIndex, INT32 updateWayID, Addr_t PC, bool cacheHit );
     void   UpdateSHiP( UINT32 setIndex, INT32 updateWayID, Addr_t PC, bool cacheHit );
-    void   UpdateEAF( UINT32 setIndex, INT32 updateWayID, bool cacheHit );
-    void   UpdateEAF_RRIP( UINT32 setIndex, INT32 updateWayID, bool cacheHit );
+    void   UpdateEAF( UINT32 setIndex, INT32 updateWayID, Addr_t lineKey, bool cacheHit );
+    void   InsertEAF( UINT32 setIndex, INT32 updateWayID, Addr_t lineKey );
+    void   UpdateEAF_RRIP( UINT32 setIndex, INT32 updateWayID, Addr_t lineKey, bool cacheHit );
+    void   UpdateHawkeye( UINT32 setIndex, INT32 updateWayID, Addr_t tag, Addr_t PC, UINT32 accessType, bool cacheHit );
+    void   TrainHawkeye( UINT32 signature, bool friendly );
+    void   UpdatePerceptron( UINT32 setIndex, INT32 updateWayID, UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType, bool cacheHit );
+    void   UpdateSDBP( UINT32 setIndex, INT32 updateWayID, Addr_t PC, Addr_t paddr );
 
     void   SetDuelingMonitorDRRIP( UINT32 setIndex, bool cacheHit );
     void   SetDuelingMonitorEAF( UINT32 setIndex, bool cacheHit );
+    void   SetDuelingMonitorSDBP( UINT32 setIndex );
 };
 
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Victim selection dispatch. See GetVictimInSet in replacement_state.cpp     //
+// for the interface.                                                         //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+template <UINT32 POL>
+inline INT32 CACHE_REPLACEMENT_STATE::GetVictimInSetT( UINT32 tid, UINT32 setIndex, const LINE_STATE *vicSet, UINT32 assoc,
+                                                       Addr_t PC, Addr_t paddr, UINT32 accessType )
+{
+    const UINT32 policy = (POL == CRC_REPL_DYNAMIC) ? replPolicy : POL;
+
+    // If no invalid lines, then replace based on replacement policy
+    if( policy == CRC_REPL_LRU ) 
+    {
+        return Get_LRU_Victim( setIndex );
+    }
+    else if( policy == CRC_REPL_RANDOM )
+    {
+        return Get_Random_Victim( setIndex );
+    }
+    else if ( policy == CRC_REPL_DRRIP ) 
+    {
+    	// Victim Selection is Same Acorss all Dueling Policies
+    	return Get_RRIP_Victim(setIndex);
+    }
+    else if ( policy == CRC_REPL_SHIP ) 
+    {
+        // This is the same as SRRIP or above function
+        return Get_SHiP_Victim(setIndex);	
+    }
+    else if ( policy == CRC_REPL_EAF ) 
+    {
+        // Victim Selection is the same as LRU, but we need to update EAF
+        return Get_EAF_Victim( setIndex, vicSet );   
+    } 
+    else if( policy == CRC_REPL_EAF_RRIP )
+    {
+        // Victim Selection is the same as RRIP, but we need to update EAF
+        return Get_EAF_RRIP_Victim( setIndex, vicSet ); 
+    }
+    else if( policy == CRC_REPL_HAWKEYE )
+    {
+        // The line furthest from reuse; averse lines first
+        return Get_Hawkeye_Victim( setIndex );
+    }
+    else if( policy == CRC_REPL_PERCEPTRON )
+    {
+        // RRIP victim, or -1 to bypass a fill predicted dead
+        return Get_Perceptron_Victim( tid, setIndex, PC, paddr, accessType );
+    }
+    else if( policy == CRC_REPL_SDBP )
+    {
+        // A dead line, else LRU; -1 bypasses a fill predicted dead.
+        // Sets following LRU take the LRU line.
+        return Get_SDBP_Victim( setIndex, PC, paddr );
+    }
+    else if( policy == CRC_REPL_PLUGIN )
+    {
+        return plugin->GetVictim( pluginState, PluginState( setIndex ), tid, setIndex, vicSet, assoc, PC, paddr, accessType );
+    }
+
+    // We should never get here
+    assert(0);
+
+    return -1; // Returning -1 bypasses the LLC
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Replacement state update dispatch. See UpdateReplacementState in           //
+// replacement_state.cpp for the interface.                                   //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+template <UINT32 POL>
+inline void CACHE_REPLACEMENT_STATE::UpdateReplacementStateT( 
+    UINT32 setIndex, INT32 updateWayID, const LINE_STATE *currLine, 
+    UINT32 tid, Addr_t PC, Addr_t paddr, UINT32 accessType, bool cacheHit )
+{
+    const UINT32 policy = (POL == CRC_REPL_DYNAMIC) ? replPolicy : POL;
+
+    // What replacement policy?
+    if( policy == CRC_REPL_LRU ) 
+    {
+        UpdateLRU( setIndex, updateWayID );
+    }
+    else if( policy == CRC_REPL_RANDOM )
+    {
+        // Random replacement requires no replacement state update
+    }
+    else if ( policy == CRC_REPL_DRRIP ) 
+    {
+		//Monitoring Set Dueling
+		SetDuelingMonitorDRRIP(setIndex, cacheHit);
+		//Update RRIP (both SRRIP and BRRIP)
+		UpdateRRIP( setIndex, updateWayID, cacheHit );
+    }
+    else if ( policy == CRC_REPL_SHIP ) 
+    {
+    	UpdateSHiP( setIndex, updateWayID, PC, cacheHit );
+    }
+    else if ( policy == CRC_REPL_EAF ) 
+    {
+        //Monitoring Set Dueling
+        SetDuelingMonitorEAF(setIndex, cacheHit);
+        //Update both LRU and EAF
+        UpdateEAF ( setIndex, updateWayID, LineKey( setIndex, currLine->tag ), cacheHit );
+    }
+    else if( policy == CRC_REPL_EAF_RRIP )
+    {
+        UpdateEAF_RRIP ( setIndex, updateWayID, LineKey( setIndex, currLine->tag ), cacheHit );
+    }
+    else if( policy == CRC_REPL_HAWKEYE )
+    {
+        UpdateHawkeye( setIndex, updateWayID, currLine->tag, PC, accessType, cacheHit );
+    }
+    else if( policy == CRC_REPL_PERCEPTRON )
+    {
+        UpdatePerceptron( setIndex, updateWayID, tid, PC, paddr, accessType, cacheHit );
+    }
+    else if( policy == CRC_REPL_SDBP )
+    {
+        UpdateSDBP( setIndex, updateWayID, PC, paddr );
+    }
+    else if( policy == CRC_REPL_PLUGIN )
+    {
+        plugin->Update( pluginState, PluginState( setIndex ), setIndex, updateWayID, currLine, tid, PC, accessType, cacheHit );
+    }
+}
+
 
 #endif
@@ -0,0 +1,93 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Bounded lock-free queue with exactly one producer thread and one consumer  //
+// thread. The head and tail indices live on separate host cache lines and    //
+// each side caches the other's index, so a push or pop touches shared        //
+// memory only when the cached view says the queue is full or empty.          //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <sched.h>
+#include "utils.h"
+
+#define SPSC_LINE   64
+
+template <class T>
+class SPSC_QUEUE
+{
+  private:
+
+    T                   *slots;
+    COUNTER             mask;        // capacity - 1, capacity a power of two
+
+    // Producer side
+    COUNTER             tail           __attribute__(( aligned( SPSC_LINE ) ));
+    COUNTER             headCache;
+
+    // Consumer side
+    COUNTER             head           __attribute__(( aligned( SPSC_LINE ) ));
+    COUNTER             tailCache;
+
+  public:
+
+    SPSC_QUEUE( UINT32 capacity )
+    {
+        UINT32 size = 1U << CRC_CeilLog2( capacity );
+
+        slots     = new T[ size ];
+        mask      = size - 1;
+        tail      = headCache = 0;
+        head      = tailCache = 0;
+    }
+
+    ~SPSC_QUEUE() { delete [] slots; }
+
+    // Returns false if the queue is full
+    bool TryPush( const T &item )
+    {
+        if( tail - headCache > mask )
+        {
+            headCache = __atomic_load_n( &head, __ATOMIC_ACQUIRE );
+            if( tail - headCache > mask ) return false;
+        }
+
+        slots[ tail & mask ] = item;
+        __atomic_store_n( &tail, tail + 1, __ATOMIC_RELEASE );
+
+        return true;
+    }
+
+    // Returns false if the queue is empty
+    bool TryPop( T *item )
+    {
+        if( head == tailCache )
+        {
+            tailCache = __atomic_load_n( &tail, __ATOMIC_ACQUIRE );
+            if( head == tailCache ) return false;
+        }
+
+        *item = slots[ head & mask ];
+        __atomic_store_n( &head, head + 1, __ATOMIC_RELEASE );
+
+        return true;
+    }
+
+    // Blocking variants; they yield the CPU while waiting so that an
+    // oversubscribed host still makes progress
+    void Push( const T &item )
+    {
+        while( !TryPush( item ) ) sched_yield();
+    }
+
+    void Pop( T *item )
+    {
+        while( !TryPop( item ) ) sched_yield();
+    }
+};
+
+#endif
@@ -29,8 +29,11 @@ using namespace std;
 
 #ifdef CRC_KIT 
 
+#define UINT8       unsigned char
+#define UINT16      unsigned short
 #define UINT32      unsigned int
 #define INT32       int
+#define UINT64      unsigned long long
 #define ADDRINT     unsigned long long
 #define COUNTER     unsigned long long
 #define BITVECTOR   unsigned long long